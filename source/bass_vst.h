@@ -32,6 +32,46 @@
  *
  *  Version History:
  *
+ *  Version 2.4.2.0 (18/10/2026)
+ *
+ *      - BASS_VST_SANDBOX flag added to host plugins in a separate process
+ *      - BASS_VST_SetOption() and BASS_VST_GetOption() added
+ *      - Processing watchdog added, see BASS_VST_OPTION_WATCHDOG_BUDGET
+ *      - BASS_VST_GetStats() and BASS_VST_EnumHandles() added
+ *      - BASS_VST_SetConfig() and BASS_VST_GetConfig() added
+ *      - Lock profiling added, see BASS_VST_GetLockStats()
+ *      - The processing buffers are allocated when the plugin is created,
+ *        larger blocks are split, see BASS_VST_CONFIG_MAXBLOCK
+ *      - Plugins can be run with a fixed block size, see
+ *        BASS_VST_OPTION_FIXEDBLOCK
+ *      - Plugin delay compensation added, see BASS_VST_SetCompensation()
+ *      - The audio thread does not allocate memory any longer, MIDI events
+ *        sent to plugins without a channel fail with BASS_ERROR_NOTAVAIL
+ *      - The processing buffers of a plugin are allocated in one cache
+ *        aligned block, see BASS_VST_CONFIG_LARGEPAGES
+ *      - 64-bit processing converts the data directly from and to the
+ *        channel's data, see BASS_VST_OPTION_PREFERDOUBLE
+ *      - Only the channels in use are emptied before processing, see also
+ *        BASS_VST_OPTION_NOCLEAR
+ *      - The data for editors without a channel are forwarded by a separate
+ *        thread, see BASS_VST_CONFIG_FORWARD_INTERVAL
+ *      - Plugins can sleep while their input is silent, see
+ *        BASS_VST_OPTION_SLEEP
+ *      - Denormals are flushed to zero while plugins run, see
+ *        BASS_VST_OPTION_FLUSHDENORMALS
+ *      - NaN and infinite output is replaced by silence, see
+ *        BASS_VST_OPTION_NANGUARD
+ *      - Host transport and tempo map added, see BASS_VST_SetTransport()
+ *      - Plugins can be oversampled, see BASS_VST_OPTION_OVERSAMPLE
+ *      - Plugins can run at a sample rate other than the channel's, see
+ *        BASS_VST_OPTION_SAMPLERATE
+ *      - Sidechain inputs from another channel, see BASS_VST_SetSidechain()
+ *      - The outputs of instruments can be split into several streams, see
+ *        BASS_VST_ChannelCreateOutput()
+ *      - The time information is calculated once per block; it and the
+ *        other information asked for most often by plugins (sample rate,
+ *        block size, version, abilities) are given without locking
+ *
  *  Version 2.4.1.0 (23/8/2019)
  *
  *      - BASS_VST_Dispatcher() added
@@ -187,6 +227,10 @@ extern "C" {
  *                      behaviour in which case only the first channel is
  *                      affected by processing (0x00000001)
  *
+ * BASS_VST_SANDBOX     Load the plugin into a separate child process, so
+ *                      that a crashing or hanging plugin cannot take down
+ *                      your application; see the remarks below (0x00000400)
+ *
  * The priority parameter has the same meaning as for BASS_ChannelSetDSP() -
  * DSPs with higher priority are called before those with lower.
  *
@@ -203,6 +247,25 @@ extern "C" {
  * care to use the correct vstHandles in this case.
  *
  * Finally, you can use any number of VST effects on a channel.
+ *
+ * Sandboxed plugins (BASS_VST_SANDBOX) are currently supported on Linux only;
+ * on other systems, BASS_ERROR_NOTAVAIL is returned.  The child process is
+ * the helper executable bass_vst_sandbox, which must be installed in the
+ * same directory as libbass_vst.so (or set the environment variable
+ * BASS_VST_SANDBOX_EXE to its path); if it cannot be started,
+ * BASS_ERROR_NOTAVAIL is returned as well.  Audio is exchanged with the
+ * child process through shared memory, which costs one round trip per
+ * block.  Parameters, programs, chunks and MIDI events are forwarded to the
+ * plugin; new parameter values are delivered with the next block (or the
+ * next other call), BASS_VST_GetParam() returns them at once.  Chunks larger
+ * than 1 MB are transferred in pieces; if this fails, BASS_VST_GetChunk()
+ * and BASS_VST_SetChunk() fail with BASS_ERROR_MEM or, if the child process
+ * is gone, with BASS_ERROR_NOTAVAIL.  Editors cannot be embedded and
+ * hasEditor is always 0 in BASS_VST_INFO.  The processing waits for the
+ * child no longer than the block lasts (at least 1 ms); a block that is not
+ * ready by then is silence.  If the child process crashes or does not
+ * answer a request within 3 seconds, it is terminated and the plugin
+ * outputs silence from then on.
  */
 BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_ChannelSetDSP)
     (DWORD chHandle, const void* dllFile, DWORD flags, int priority);
@@ -219,6 +282,7 @@ BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_ChannelSetDSPEx)
 	char *pluginList, int pluginListSize, int pluginID);
 
 #define BASS_VST_KEEP_CHANS 0x00000001 /* flag that may be used for BASS_VST_ChannelSetDSP(), see the comments above */
+#define BASS_VST_SANDBOX    0x00000400 /* flag that may be used for BASS_VST_ChannelSetDSP() and BASS_VST_ChannelCreate(), see the comments above */
 
 
 
@@ -261,6 +325,9 @@ BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_ChannelRemoveDSP)
  * BASS_SAMPLE_FX       .
  * BASS_STREAM_DECODE
  *
+ * BASS_VST_SANDBOX     Load the plugin into a separate child process, see
+ *                      BASS_VST_ChannelSetDSP() for details (0x00000400)
+ *
  * On success, the function returns the new vstHandle that must be given to
  * the other functions.  The returned VST handle can also be given to the
  * typical BASS_Channel*(). For errors, 0 is returned and BASS_ErrorGetCode()
@@ -282,6 +349,41 @@ BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_ChannelCreateEx)
 
 
 
+/* BASS_VST_ChannelCreateOutput() creates a BASS stream playing the outputs
+ * firstOutput to firstOutput+chans-1 of a VST instrument created by
+ * BASS_VST_ChannelCreate(), eg. the single drums of a drum sampler with many
+ * outputs.  The instrument is rendered once for all its streams; each
+ * stream takes its outputs directly from the rendered data.  The stream
+ * returned by BASS_VST_ChannelCreate() continues to play the first outputs.
+ * Flags:
+ *
+ * BASS_SPEAKER_xxx     These flags will just work in the same way as they
+ * BASS_SAMPLE_FLOAT    work for other streams
+ * BASS_SAMPLE_SOFTWARE .
+ * BASS_SAMPLE_3D       .
+ * BASS_SAMPLE_FX       .
+ * BASS_STREAM_DECODE
+ * BASS_STREAM_AUTOFREE
+ *
+ * The streams have the sample rate of the instrument's stream and should be
+ * played together, eg. by the same mixer.  They may be pulled in different
+ * lengths; if a stream is not pulled at all (eg. paused), it loses its
+ * oldest data so that it does not block the others.  BASS_VST_OPTION_SLEEP
+ * is not used while there are output streams.
+ *
+ * The streams are freed by BASS_StreamFree() or together with the
+ * instrument.  On success, the function returns the new stream handle; for
+ * errors, 0 is returned and BASS_ErrorGetCode() will specify the reason.
+ *
+ *      // a drum sampler with 16 stereo outputs, one stream per drum
+ *      for( i = 1; i < 16; i++ )
+ *          drums[i] = BASS_VST_ChannelCreateOutput(vstHandle, i*2, 2, BASS_SAMPLE_FLOAT|BASS_STREAM_DECODE);
+ */
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_ChannelCreateOutput)
+	(DWORD vstHandle, DWORD firstOutput, DWORD chans, DWORD flags);
+
+
+
 /* BASS_VST_ChannelFree deletes a VST instrument channel created by
  * BASS_VST_ChannelCreate().  Note, that you cannot delete effects assigned to
  * channels this way; for this purpose, please use BASS_VST_ChannelRemoveDSP().
@@ -499,6 +601,153 @@ BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_GetBypass)
 
 
 
+/* With BASS_VST_SetOption() you can change some per-plugin settings,
+ * BASS_VST_GetOption() returns the current value of a setting or -1 on
+ * errors.  Options:
+ *
+ * BASS_VST_OPTION_WATCHDOG_BUDGET    The max. time the plugin may spend in
+ *                                    processing a block, given in percent of
+ *                                    the block duration; eg. 50 means a
+ *                                    plugin may use half of the real time.
+ *                                    0 disables the watchdog (default).
+ *
+ * BASS_VST_OPTION_WATCHDOG_OVERRUNS  If the plugin overruns its budget this
+ *                                    number of blocks in a row (default: 8),
+ *                                    it is bypassed as if BASS_VST_SetBypass()
+ *                                    was called and the callback set by
+ *                                    BASS_VST_SetCallback() receives a
+ *                                    BASS_VST_WATCHDOG_BYPASSED event.  Call
+ *                                    BASS_VST_SetBypass(vstHandle, FALSE) to
+ *                                    give the plugin another try.
+ *
+ * BASS_VST_OPTION_FIXEDBLOCK         Always call the plugin with this number
+ *                                    of samples, independent of the length
+ *                                    BASS processes at once; useful for
+ *                                    FFT-based plugins that work best with
+ *                                    eg. 1024 samples.  This adds a latency
+ *                                    of the given number of samples which is
+ *                                    included in initialDelay returned by
+ *                                    BASS_VST_GetInfo().  0 disables the
+ *                                    fixed block size (default).  Can only be
+ *                                    used for plugins assigned to a channel.
+ *
+ * BASS_VST_OPTION_BYPASSDELAY        If set to 1, the signal is delayed by the
+ *                                    plugin's latency while the plugin is
+ *                                    bypassed, so bypassing does not move the
+ *                                    signal in time.  Default is 0.
+ *
+ * BASS_VST_OPTION_PREFERDOUBLE       If set to 1, plugins supporting both,
+ *                                    32-bit and 64-bit processing, are called
+ *                                    with 64-bit floats.  Default is 0; plugins
+ *                                    supporting 64-bit processing only are
+ *                                    always called with 64-bit floats.
+ *
+ * BASS_VST_OPTION_NOCLEAR            Set to 1 if the plugin is known to write
+ *                                    all of its outputs in processReplacing();
+ *                                    the output buffers are then not emptied
+ *                                    before each call.  Default is 0 as some
+ *                                    plugins only add to the outputs.
+ *
+ * BASS_VST_OPTION_SLEEP              If set to 1, the plugin is not called
+ *                                    while its input is silent (see
+ *                                    BASS_VST_CONFIG_SLEEP_THRESHOLD) for
+ *                                    longer than its latency and its tail;
+ *                                    the output is silence then.  The plugin
+ *                                    wakes up with the first block that is
+ *                                    not silent or when MIDI events arrive.
+ *                                    Instruments sleep if no key is down and
+ *                                    their output was silent for longer than
+ *                                    their tail; they wake up with the next
+ *                                    MIDI event.
+ *                                    Default is 0, see also BASS_VST_GetStats().
+ *
+ * BASS_VST_OPTION_SLEEP_TAIL         The tail in milliseconds used for
+ *                                    BASS_VST_OPTION_SLEEP if the plugin does
+ *                                    not report its tail; 0-60000, default
+ *                                    2000.
+ *
+ * BASS_VST_OPTION_FLUSHDENORMALS     If set to 1 (default), the CPU flushes
+ *                                    denormals (tiny numbers as in decaying
+ *                                    reverb or filter tails, which are very
+ *                                    slow to compute) to zero while the
+ *                                    plugin runs; the floating point state of
+ *                                    the caller is restored afterwards.  Set
+ *                                    to 0 if a plugin relies on denormals.
+ *
+ * BASS_VST_OPTION_ANTIDENORMAL       For plugins resetting the floating point
+ *                                    state themselves: 1 adds a tiny DC offset
+ *                                    (-360 dB) to the inputs of the plugin,
+ *                                    2 adds tiny noise instead (eg. if the
+ *                                    plugin filters DC).  Default is 0.
+ *
+ * BASS_VST_OPTION_NANGUARD           If set to 1 (default), the output of the
+ *                                    plugin is checked for NaN and infinite
+ *                                    samples; if there are any, the block is
+ *                                    replaced by silence and the callback
+ *                                    receives a BASS_VST_NONFINITE_OUTPUT
+ *                                    event.  2 additionally resets the plugin
+ *                                    as BASS_VST_Resume() does, 0 disables
+ *                                    the check.
+ *
+ * BASS_VST_OPTION_OVERSAMPLE         Run the plugin at 2, 4 or 8 times the
+ *                                    sample rate of the channel, eg. for
+ *                                    distortion plugins that alias at 44.1
+ *                                    or 48 kHz; 1 disables the oversampling
+ *                                    (default).  The signal is filtered to
+ *                                    0.22 of the channel's sample rate (19.4
+ *                                    kHz at 44.1 kHz); the filters add a
+ *                                    latency of 47 (2x), 55 (4x) or 58 (8x)
+ *                                    samples which is included in
+ *                                    initialDelay returned by
+ *                                    BASS_VST_GetInfo().  The plugin is
+ *                                    suspended and resumed to change its
+ *                                    sample rate.  Can only be used for
+ *                                    plugins assigned to a channel.
+ *
+ * BASS_VST_OPTION_SAMPLERATE         Run the plugin at the given sample rate
+ *                                    in Hz, eg. for plugins that only work
+ *                                    correctly at 44.1 or 48 kHz; 0 runs the
+ *                                    plugin at the channel's rate (default).
+ *                                    The rate must be between 1/8 and 8
+ *                                    times the channel's rate.  The data are
+ *                                    resampled to the plugin's rate and back;
+ *                                    this adds a latency of typically 30 to
+ *                                    70 samples, depending on the rates,
+ *                                    which is included in initialDelay
+ *                                    returned by BASS_VST_GetInfo().  The
+ *                                    number of samples given to the plugin
+ *                                    varies from block to block, the block
+ *                                    size reported to the plugin is the
+ *                                    maximum.  Cannot be combined with
+ *                                    BASS_VST_OPTION_OVERSAMPLE, can only be
+ *                                    used for plugins assigned to a channel.
+ *
+ * Note, that the watchdog cannot interrupt a plugin that hangs completely;
+ * for this purpose, use the BASS_VST_SANDBOX flag.
+ */
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetOption)
+    (DWORD vstHandle, DWORD option, DWORD value);
+
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_GetOption)
+    (DWORD vstHandle, DWORD option);
+
+#define BASS_VST_OPTION_WATCHDOG_BUDGET     1
+#define BASS_VST_OPTION_WATCHDOG_OVERRUNS   2
+#define BASS_VST_OPTION_FIXEDBLOCK          3
+#define BASS_VST_OPTION_BYPASSDELAY         4
+#define BASS_VST_OPTION_PREFERDOUBLE        5
+#define BASS_VST_OPTION_NOCLEAR             6
+#define BASS_VST_OPTION_SLEEP               7
+#define BASS_VST_OPTION_SLEEP_TAIL          8
+#define BASS_VST_OPTION_FLUSHDENORMALS      9
+#define BASS_VST_OPTION_ANTIDENORMAL        10
+#define BASS_VST_OPTION_NANGUARD            11
+#define BASS_VST_OPTION_OVERSAMPLE          12
+#define BASS_VST_OPTION_SAMPLERATE          13
+
+
+
+
 /* BASS_VST_GetInfo() writes some information about a vstHandle to a
  * BASS_VST_INFO structure.
  *
@@ -529,7 +778,7 @@ typedef struct
     DWORD    vendorVersion;         /* vendor-specific version number */
     DWORD    chansIn;               /* max. number of possible input channels */
     DWORD    chansOut;              /* max. number of possible output channels */
-    DWORD    initialDelay;          /* for algorithms which need input in the first place, in samples */
+    DWORD    initialDelay;          /* for algorithms which need input in the first place, in samples; includes the latency added by BASS_VST, eg. by BASS_VST_OPTION_FIXEDBLOCK */
     DWORD    hasEditor;             /* can the BASS_VST_EmbedEditor() function be called? */
     DWORD    editorWidth;           /* initial/current width of the editor, also note BASS_VST_EDITOR_RESIZED; if the editor is not yet opened, this value may be 0 for some (very few) plugins! */
     DWORD    editorHeight;          /* same for the height */
@@ -573,7 +822,9 @@ BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_GetInfo)
  * skipping the channel parameter when calling BASS_VST_ChannelSetDSP()) and
  * the editor displays any spectrums, VU-meters or such, the data for this come
  * from the most recent channel with the same plugin and the same scope; the
- * scope can be set by BASS_VST_SetScope() to any ID, the default is 0.
+ * scope can be set by BASS_VST_SetScope() to any ID, the default is 0.  The
+ * editor gets the data from a separate thread, not from the audio thread, at
+ * the rate set by BASS_VST_CONFIG_FORWARD_INTERVAL.
  */
 BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_EmbedEditor)
 #ifdef _WIN32
@@ -609,6 +860,9 @@ typedef DWORD (CALLBACK VSTPROC)(DWORD vstHandle, DWORD action, DWORD param1, DW
 #define BASS_VST_PARAM_CHANGED  1   /* some parameters are changed by the editor opened by BASS_VST_EmbedEditor(), NOT posted if you call BASS_VST_SetParam(), param1=oldParamNum, param2=newParamNum */
 #define BASS_VST_EDITOR_RESIZED 2   /* the embedded editor window should be resized, the new width/height can be found in param1/param2 and in BASS_VST_GetInfo() */
 #define BASS_VST_AUDIO_MASTER   3   /* can be used to subclass the audioMaster callback, param1 is a pointer to a BASS_VST_AUDIO_MASTER_PARAM structure defined below */
+#define BASS_VST_WATCHDOG_BYPASSED 4 /* the plugin was bypassed as it overran its processing budget too often, see BASS_VST_OPTION_WATCHDOG_BUDGET; param1=processing time of the last block in microseconds, param2=block duration in microseconds; this event is sent from the audio thread */
+#define BASS_VST_LATENCY_CHANGED 5 /* the plugin reported a change of its latency, param1=new latency in samples as returned in initialDelay by BASS_VST_GetInfo(); sent from the idle timer */
+#define BASS_VST_NONFINITE_OUTPUT 6 /* the plugin emitted NaN or infinite samples which were replaced by silence, see BASS_VST_OPTION_NANGUARD; param1=number of such blocks so far, param2=1 if the plugin was reset; this event is sent from the audio thread */
 
 BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetCallback)
     (DWORD vstHandle, VSTPROC*, void* user);
@@ -693,6 +947,9 @@ BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetLanguage)
  * 0 and encode "event" as 0x00xxyyzz with xx=MIDI command, yy=MIDI databyte #1,
  * zz=MIDI databyte #2.
  *
+ * Events can only be sent to plugins assigned to a channel; for other plugins,
+ * both functions fail with BASS_ERROR_NOTAVAIL.
+ *
  * Example:
  *
  *      #include <bassmidi.h>
@@ -743,6 +1000,249 @@ BASS_VSTSCOPE QWORD BASS_VSTDEF(BASS_VST_Dispatcher)
 
 
 
+/* BASS_VST_GetStats() returns some statistics about the processing of a
+ * plugin, eg. to find out which plugin eats up the CPU.  All times are given
+ * in nanoseconds and are collected since the plugin was created.  The
+ * statistics are collected without locking the audio thread, so the values
+ * may be slightly inconsistent to each other.
+ *
+ * BASS_VST_EnumHandles() copies the handles of all existing plugins to the
+ * given array and returns the total number of plugins - which may be larger
+ * than maxHandles.  Call BASS_VST_EnumHandles(NULL, 0) to get the number of
+ * plugins only.  Example:
+ *
+ *      DWORD handles[64], i, count = BASS_VST_EnumHandles(handles, 64);
+ *      for( i = 0; i < count && i < 64; i++ )
+ *      {
+ *          BASS_VST_STATS stats;
+ *          if( BASS_VST_GetStats(handles[i], &stats) )
+ *              printf("%u: %u ns max\n", handles[i], stats.maxTime);
+ *      }
+ */
+#define BASS_VST_STATS_BLOCKSIZES 16
+
+typedef struct
+{
+    DWORD    blocks;                /* number of blocks processed */
+    QWORD    samples;               /* number of samples processed, per channel */
+    DWORD    lastTime;              /* time needed to process the last block */
+    DWORD    meanTime;              /* average time needed to process a block */
+    DWORD    p99Time;               /* 99% of the blocks were processed in this time or faster; approximated, may be up to 25% too high */
+    DWORD    maxTime;               /* max. time needed to process a block */
+    DWORD    blockSizes[BASS_VST_STATS_BLOCKSIZES]; /* block size histogram, blockSizes[n] is the number of blocks with 2^n to 2^(n+1)-1 samples, the last entry also counts all larger blocks */
+    QWORD    vstLockWait;           /* total time the audio thread waited for the plugin, eg. while it was used by an editor or by another thread */
+    DWORD    sleeps;                /* number of times the plugin went to sleep, see BASS_VST_OPTION_SLEEP */
+    QWORD    sleepSamples;          /* number of samples not processed as the plugin was sleeping */
+    BOOL     sleeping;              /* the plugin is sleeping currently */
+    DWORD    nonFiniteBlocks;       /* number of blocks with NaN or infinite output replaced by silence, see BASS_VST_OPTION_NANGUARD */
+} BASS_VST_STATS;
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_GetStats)
+	(DWORD vstHandle, BASS_VST_STATS* ret);
+
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_EnumHandles)
+	(DWORD* handles, DWORD maxHandles);
+
+
+
+/* The time information given to a plugin (tempo, position in quarter notes,
+ * bars, time signature etc.) is taken from a host transport kept for each
+ * plugin.  While playing, the position follows the samples processed by the
+ * plugin; if the position of the channel is changed, eg. by
+ * BASS_ChannelSetPosition(), the transport is relocated automatically.
+ * The nanoSeconds field given to the plugin is a monotonic wall clock.
+ *
+ * BASS_VST_SetTempoMap() sets the tempo and the time signature; each entry
+ * is valid from the given position in quarter notes up to the next entry.
+ * The first entry must start at 0, the positions must be ascending; a time
+ * signature entry also starts a new bar.  Call BASS_VST_SetTempoMap() with
+ * count=0 to use the default of 120 BPM and 4/4.  Example:
+ *
+ *      BASS_VST_TEMPO tempos[2] = { { 0.0, 120.0, 4, 4 },
+ *                                   { 64.0, 90.0, 3, 4 } };
+ *      BASS_VST_SetTempoMap(vstHandle, tempos, 2);
+ *
+ * BASS_VST_SetTransport() sets whether the transport is playing (default)
+ * and the cycle given in quarter notes.  If the transport is stopped, the
+ * position does not move, even if the plugin is still processing.  The
+ * cycle is only reported to the plugin, looping is up to the application,
+ * eg. by a BASS_SYNC_POS sync setting the position back.
+ * BASS_VST_GetTransport() returns the current state.
+ *
+ * BASS_VST_SetTransportPos() sets the position of the transport in seconds
+ * explicitly, eg. for plugins not assigned to a channel.  The new position
+ * is used from the next block on.
+ */
+typedef struct
+{
+    double   ppqPos;                /* start of the entry in quarter notes */
+    double   tempo;                 /* in BPM */
+    DWORD    timeSigNumerator;      /* eg. 3 for 3/4 */
+    DWORD    timeSigDenominator;    /* eg. 4 for 3/4 */
+} BASS_VST_TEMPO;
+
+typedef struct
+{
+    BOOL     playing;
+    BOOL     cycleActive;
+    double   cycleStart;            /* in quarter notes */
+    double   cycleEnd;              /* in quarter notes, must be larger than cycleStart if cycleActive is set */
+} BASS_VST_TRANSPORT;
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetTempoMap)
+	(DWORD vstHandle, const BASS_VST_TEMPO* tempos, DWORD count);
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetTransport)
+	(DWORD vstHandle, const BASS_VST_TRANSPORT* transport);
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_GetTransport)
+	(DWORD vstHandle, BASS_VST_TRANSPORT* ret);
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetTransportPos)
+	(DWORD vstHandle, double seconds);
+
+
+
+/* BASS_VST_SetSidechain() feeds inputs of the plugin with the data of
+ * another BASS channel, eg. the sidechain input of a compressor or a gate.
+ * The channels of sourceChannel are given to the inputs starting with
+ * firstInputIndex, normally the first input after the channels of the
+ * channel the plugin is assigned to - if the index is lower, the given
+ * inputs are replaced.  Inputs without data stay silent as before.
+ *
+ * The data are taken by a DSP on sourceChannel called after all other DSPs
+ * of it.  Both channels must have the same sample rate; they may be played
+ * by different devices - if their clocks drift apart, samples are dropped
+ * or repeated.  The source's data are used with the next block processed by
+ * the plugin, so the sidechain is delayed by up to one block if the source
+ * is processed after the plugin's channel.  If the source stops, the inputs
+ * get silent.  The sidechain does not wake a sleeping plugin, see
+ * BASS_VST_OPTION_SLEEP.
+ *
+ * Call BASS_VST_SetSidechain() with sourceChannel=0 to remove the
+ * sidechain; it is also removed if the plugin is freed.  The plugin must be
+ * assigned to a channel.
+ *
+ *      BASS_VST_SetSidechain(compressor, voiceChannel, 2);
+ */
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetSidechain)
+	(DWORD vstHandle, DWORD sourceChannel, DWORD firstInputIndex);
+
+
+
+/* With BASS_VST_SetConfig() you can change some global settings,
+ * BASS_VST_GetConfig() returns the current value of a setting or -1 on
+ * errors.  Options:
+ *
+ * BASS_VST_CONFIG_LOCK_STATS         Set to 1 to reset and collect the lock
+ *                                    statistics, see BASS_VST_GetLockStats(),
+ *                                    0 stops collecting (default).
+ *
+ * BASS_VST_CONFIG_MAXBLOCK           The max. number of samples given to a
+ *                                    plugin at once, 16-1048576, default 8192.
+ *                                    The buffers for this number of samples
+ *                                    are allocated and the block size is set
+ *                                    when a plugin is assigned to a channel,
+ *                                    so processing never allocates memory or
+ *                                    resets the plugin; larger blocks are
+ *                                    split.  Changes affect only plugins
+ *                                    created afterwards.
+ *
+ * BASS_VST_CONFIG_LARGEPAGES         Set to 1 to allocate bigger processing
+ *                                    buffers in large pages if supported by
+ *                                    the system (transparent huge pages on
+ *                                    Linux; on Windows, the process needs the
+ *                                    "Lock pages in memory" privilege).
+ *                                    Default 0, changes affect only plugins
+ *                                    created afterwards.
+ *
+ * BASS_VST_CONFIG_FORWARD_INTERVAL   The interval in milliseconds in which
+ *                                    editors without a channel get the latest
+ *                                    data of the channels of the same scope,
+ *                                    see BASS_VST_EmbedEditor(); 10-1000,
+ *                                    default 50.  The data are forwarded by a
+ *                                    separate thread, the audio thread only
+ *                                    copies them.
+ *
+ * BASS_VST_CONFIG_SLEEP_THRESHOLD    Input below this level is considered
+ *                                    silent for BASS_VST_OPTION_SLEEP; given
+ *                                    in dB below full scale, 20-200, default
+ *                                    96.
+ */
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetConfig)
+    (DWORD option, DWORD value);
+
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_GetConfig)
+    (DWORD option);
+
+#define BASS_VST_CONFIG_LOCK_STATS          1
+#define BASS_VST_CONFIG_MAXBLOCK            2
+#define BASS_VST_CONFIG_LARGEPAGES          3
+#define BASS_VST_CONFIG_FORWARD_INTERVAL    4
+#define BASS_VST_CONFIG_SLEEP_THRESHOLD     5
+
+
+
+/* BASS_VST_GetLockStats() returns how often the internal locks were
+ * acquired and how long the threads waited for them, summed up for all locks
+ * of the given class.  This helps to find the reason of dropouts.  The
+ * statistics are only collected if switched on by BASS_VST_CONFIG_LOCK_STATS
+ * or by setting the environment variable BASS_VST_LOCK_STATS before
+ * BASS_VST is loaded; in the latter case, the statistics are also written to
+ * stderr when BASS_VST is unloaded - or appended to the file given in the
+ * variable if its value is not "1".
+ *
+ * Some locks are only tried, eg. by the thread forwarding data to editors; a
+ * failed try is counted as a contended acquisition without any wait time.
+ */
+typedef struct
+{
+    QWORD    acquisitions;          /* number of times the lock was acquired */
+    QWORD    contended;             /* number of times the lock was held by another thread */
+    QWORD    waitTime;              /* total time waited for the lock, in nanoseconds */
+} BASS_VST_LOCK_STATS;
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_GetLockStats)
+    (DWORD lockClass, BASS_VST_LOCK_STATS* ret);
+
+#define BASS_VST_LOCK_HANDLES       0   /* the global lock for all handles */
+#define BASS_VST_LOCK_FORWARD       1   /* the global lock for forwarding data to editors */
+#define BASS_VST_LOCK_IDLE          2   /* the global lock for the idle timer */
+#define BASS_VST_LOCK_PLUGIN        3   /* the locks around each plugin */
+#define BASS_VST_LOCK_MIDI          4   /* the locks around each plugin's MIDI event queue */
+#define BASS_VST_LOCK_COMPENSATION  5   /* the locks around each compensation delay, see BASS_VST_SetCompensation() */
+#define BASS_VST_LOCK_CLASSES       6
+
+
+
+/* Plugin delay compensation: BASS_VST_GetChainLatency() returns the sum of the
+ * latencies of all plugins assigned to a channel, in samples.  Bypassed
+ * plugins are only counted if BASS_VST_OPTION_BYPASSDELAY is set for them.
+ *
+ * If you mix several channels with different chain latencies, call
+ * BASS_VST_SetCompensation(channelHandle, TRUE) for each of them.  BASS_VST
+ * then delays every registered channel by the difference between its chain
+ * latency and the largest chain latency of all registered channels, so the
+ * channels stay aligned.  The delays are adapted automatically if plugins are
+ * added, removed or bypassed or if they report a new latency (in this case,
+ * the BASS_VST_LATENCY_CHANGED event is sent, see BASS_VST_SetCallback()).
+ * BASS_VST_GetCompensation() returns the current delay of a registered
+ * channel in samples or -1 if the channel is not registered.
+ *
+ * The compensation is removed if the channel is freed or by calling
+ * BASS_VST_SetCompensation(channelHandle, FALSE).
+ */
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_GetChainLatency)
+    (DWORD channelHandle);
+
+BASS_VSTSCOPE BOOL BASS_VSTDEF(BASS_VST_SetCompensation)
+    (DWORD channelHandle, BOOL enable);
+
+BASS_VSTSCOPE DWORD BASS_VSTDEF(BASS_VST_GetCompensation)
+    (DWORD channelHandle);
+
+
+
 /* If any BASS_VST function fails, you can use BASS_ErrorGetCode() to obtain
  * the reason for failure.  The error codes are the one from bass.h plus the
  * error codes below.  If a function succeeded, BASS_ErrorGetCode() returns
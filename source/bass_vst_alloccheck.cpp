@@ -0,0 +1,257 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_alloccheck.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Debug check for memory allocations on the audio thread
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: this file is only compiled in if BASS_VST_ALLOC_CHECK is defined
+ *	(for CMake: -DBASS_VST_ALLOC_CHECK=ON); it is meant for debugging only.
+ *
+ *	The audio callbacks (doEffectProcess() and the compensation DSP) call
+ *	allocCheckEnter() and allocCheckLeave(); any malloc(), calloc(),
+ *	realloc() or free() in between - by BASS_VST, by a plugin or by a
+ *	callback of the application - is reported to stderr together with a
+ *	stack trace.  new and delete end up in malloc() and free() and are
+ *	caught the same way.
+ *
+ *	On Linux, the allocation functions of glibc are overridden; for this,
+ *	libbass_vst.so must be linked to the application (or be given in
+ *	LD_PRELOAD) so that it is searched before libc.  Use addr2line to
+ *	resolve the addresses of functions without exported symbols.
+ *
+ *	On Windows, a hook is installed by _CrtSetAllocHook(); this only works
+ *	with the debug CRT and only sees the allocations done by modules using
+ *	the same CRT as BASS_VST.  The stack trace is written to the debugger
+ *	output as a list of addresses.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+#ifdef BASS_VST_ALLOC_CHECK
+
+
+
+#define ALLOC_CHECK_FRAMES		32
+#define ALLOC_CHECK_MAX_REPORTS	100
+
+
+
+#ifdef _WIN32
+static THREAD_LOCAL int			s_depth;
+static THREAD_LOCAL int			s_reporting;
+#else
+// initial-exec: accessing the variables must not allocate memory itself
+static __thread int				s_depth __attribute__((tls_model("initial-exec")));
+static __thread int				s_reporting __attribute__((tls_model("initial-exec")));
+#endif
+static volatile long			s_reports;
+
+
+
+void allocCheckEnter()
+{
+	s_depth++;
+}
+
+
+
+void allocCheckLeave()
+{
+	s_depth--;
+}
+
+
+
+static long mayReport()
+{
+	// returns the number of the report or -1; the allocations done by the
+	// reporting itself are not reported
+	if( s_depth <= 0 || s_reporting )
+		return -1;
+
+	long report = InterlockedExchangeAdd(&s_reports, 1);
+	if( report > ALLOC_CHECK_MAX_REPORTS )
+		return -1;
+
+	return report;
+}
+
+
+
+/*****************************************************************************
+ *  Linux
+ *****************************************************************************/
+
+
+
+#if defined(__linux__) && defined(__GLIBC__)
+
+#include <execinfo.h>
+#include <unistd.h>
+
+extern "C" void*	__libc_malloc(size_t);
+extern "C" void*	__libc_calloc(size_t, size_t);
+extern "C" void*	__libc_realloc(void*, size_t);
+extern "C" void		__libc_free(void*);
+
+#define ALLOC_CHECK_EXPORT extern "C" __attribute__((visibility("default")))
+
+
+
+__attribute__((noinline)) static void reportAlloc(long report, const char* func, void* ptr, size_t bytes)
+{
+	char	msg[160];
+	void*	frames[ALLOC_CHECK_FRAMES];
+	int		len, cnt;
+
+	s_reporting = 1;
+
+		if( report == ALLOC_CHECK_MAX_REPORTS )
+			len = snprintf(msg, sizeof(msg), "BASS_VST: %d allocations on the audio thread reported, further allocations are not reported\n", ALLOC_CHECK_MAX_REPORTS);
+		else
+			len = snprintf(msg, sizeof(msg), "BASS_VST: %s(%p, %lu) on the audio thread:\n", func, ptr, (unsigned long)bytes);
+		if( len > 0 && write(2, msg, len < (int)sizeof(msg)? len : (int)sizeof(msg)-1) ) {}
+
+		if( report < ALLOC_CHECK_MAX_REPORTS )
+		{
+			cnt = backtrace(frames, ALLOC_CHECK_FRAMES);
+			if( cnt > 2 )
+				backtrace_symbols_fd(frames+2, cnt-2, 2); // skip reportAlloc() and the allocation function
+		}
+
+	s_reporting = 0;
+}
+
+
+
+ALLOC_CHECK_EXPORT void* malloc(size_t bytes) __THROW
+{
+	long report = mayReport();
+	if( report >= 0 )
+		reportAlloc(report, "malloc", NULL, bytes);
+	return __libc_malloc(bytes);
+}
+
+
+
+ALLOC_CHECK_EXPORT void* calloc(size_t num, size_t bytes) __THROW
+{
+	long report = mayReport();
+	if( report >= 0 )
+		reportAlloc(report, "calloc", NULL, num*bytes);
+	return __libc_calloc(num, bytes);
+}
+
+
+
+ALLOC_CHECK_EXPORT void* realloc(void* ptr, size_t bytes) __THROW
+{
+	long report = mayReport();
+	if( report >= 0 )
+		reportAlloc(report, "realloc", ptr, bytes);
+	return __libc_realloc(ptr, bytes);
+}
+
+
+
+ALLOC_CHECK_EXPORT void free(void* ptr) __THROW
+{
+	long report = ptr? mayReport() : -1;
+	if( report >= 0 )
+		reportAlloc(report, "free", ptr, 0);
+	__libc_free(ptr);
+}
+
+
+
+void allocCheckInit()
+{
+	// backtrace() loads libgcc on the first call which allocates memory
+	void* frame;
+	backtrace(&frame, 1);
+}
+
+
+
+/*****************************************************************************
+ *  Windows
+ *****************************************************************************/
+
+
+
+#elif defined(_WIN32) && defined(_DEBUG)
+
+
+
+static void reportAlloc(long report, const char* func, void* ptr, size_t bytes)
+{
+	char	msg[160];
+	void*	frames[ALLOC_CHECK_FRAMES];
+	int		i, cnt;
+
+	s_reporting = 1;
+
+		if( report == ALLOC_CHECK_MAX_REPORTS )
+		{
+			_snprintf(msg, sizeof(msg)-1, "BASS_VST: %d allocations on the audio thread reported, further allocations are not reported\n", ALLOC_CHECK_MAX_REPORTS);
+			msg[sizeof(msg)-1] = 0;
+			OutputDebugStringA(msg);
+		}
+		else
+		{
+			_snprintf(msg, sizeof(msg)-1, "BASS_VST: %s(%p, %lu) on the audio thread:\n", func, ptr, (unsigned long)bytes);
+			msg[sizeof(msg)-1] = 0;
+			OutputDebugStringA(msg);
+
+			cnt = CaptureStackBackTrace(2/*skip reportAlloc() and the hook*/, ALLOC_CHECK_FRAMES, frames, NULL);
+			for( i = 0; i < cnt; i++ )
+			{
+				_snprintf(msg, sizeof(msg)-1, "    %p\n", frames[i]);
+				msg[sizeof(msg)-1] = 0;
+				OutputDebugStringA(msg);
+			}
+		}
+
+	s_reporting = 0;
+}
+
+
+
+static int __cdecl allocHook(int allocType, void* ptr, size_t bytes, int blockType, long requestNumber, const unsigned char* filename, int lineNumber)
+{
+	// _CRT_BLOCK are allocations of the CRT itself, the hook must not care about them
+	long report = blockType != _CRT_BLOCK? mayReport() : -1;
+	if( report >= 0 )
+		reportAlloc(report, allocType==_HOOK_ALLOC? "malloc" : (allocType==_HOOK_REALLOC? "realloc" : "free"), ptr, bytes);
+	return TRUE;
+}
+
+
+
+void allocCheckInit()
+{
+	_CrtSetAllocHook(allocHook);
+}
+
+
+
+#else
+#pragma message("BASS_VST_ALLOC_CHECK is not supported for this platform or without the debug CRT")
+void allocCheckInit()
+{
+}
+#endif
+
+
+
+#endif /* BASS_VST_ALLOC_CHECK */
@@ -0,0 +1,433 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_forward.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Forwarding the data of a channel to the editors of the same scope
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: plugins without a channel but with an opened editor get the input
+ *	of all channels of the same scope (see BASS_VST_SetScope()), so that VU
+ *	meters, analyzers etc. show something.  The audio thread only copies its
+ *	input to the ring of the plugin (forwardWrite()) and never waits for the
+ *	editors nor for s_forwardCritical; the editors are called by a separate
+ *	thread every BASS_VST_CONFIG_FORWARD_INTERVAL milliseconds with the
+ *	latest block from each ring.
+ *
+ *	The ring has a single writer which never waits for the reader: the
+ *	reader checks after copying whether the data were overwritten in the
+ *	meantime and skips the block then.  The rings are (re)allocated by
+ *	checkForwarding() only, holding s_forwardCritical (which excludes the
+ *	forwarding thread) and the plugin's vstCritical_ (which excludes the
+ *	audio thread).
+ *
+ *	The thread runs only while there is something to forward; it is not
+ *	joined but detached, stopping it just increases s_forwardGeneration.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+
+
+#define FORWARD_RING_BLOCKS		4	// the ring holds at least 4 blocks
+#define FORWARD_SLEEP_STEP		10	// ms, the thread checks for being stopped in this interval
+
+
+
+struct FORWARD_RING
+{
+	BUFFER_ARENA		arena;
+
+	// the ring, written by the audio thread
+	long				numChans;		// the inputs of the source plugin
+	long				frames;			// a power of 2
+	float*				chans[MAX_CHANS];
+	volatile long		writePos;		// samples written so far, wraps around
+
+	// used by the forwarding thread only: the buffers given to the receivers,
+	// with room for doubles as buffersIn/buffersOut
+	long				readPos;
+	long				blockSize;		// the block size of the source plugin
+	long				numIn;
+	long				numOut;
+	float*				in[MAX_CHANS];
+	float*				out[MAX_CHANS];
+};
+
+
+
+DWORD					s_forwardInterval = DEFAULT_FORWARD_INTERVAL;
+
+static sjhash			s_forwardSources; // the handles of all plugins with a ring, protected by s_forwardCritical
+static bool				s_forwardThreadRunning = false;
+static volatile long	s_forwardGeneration = 0; // a thread runs as long as this is the value it was started with
+static volatile long	s_forwardThreadsAlive = 0;
+
+
+
+void initForwarding()
+{
+	sjhashInit(&s_forwardSources, SJHASH_INT, /*keytype*/ 0/*copyKey*/);
+}
+
+
+
+/*****************************************************************************
+ *  the rings
+ *****************************************************************************/
+
+
+
+static void freeRing(FORWARD_RING* ring)
+{
+	if( ring )
+	{
+		arenaFree(&ring->arena);
+		free(ring);
+	}
+}
+
+
+
+bool forwardPrepare(BASS_VST_PLUGIN* source)
+{
+	// called by checkForwarding() with s_forwardCritical held; the receivers get at
+	// most effBlockSize samples at once, as the source
+	long numChans = source->numActiveInputs;
+	long blockSize = source->effBlockSize;
+	if( numChans <= 0 || blockSize <= 0 )
+	{
+		forwardRemove(source);
+		return false;
+	}
+
+	long numIn = numChans, numOut = 1, i;
+	for( i = 0; i < source->forwardDataToOtherCnt; i++ )
+	{
+		BASS_VST_PLUGIN* other_ = refHandle(source->forwardDataToOtherVstHandles[i]);
+			if( other_ )
+			{
+				if( other_->aeffect->numInputs > numIn )
+					numIn = other_->aeffect->numInputs;
+				if( other_->aeffect->numOutputs > numOut )
+					numOut = other_->aeffect->numOutputs;
+			}
+		unrefHandle(source->forwardDataToOtherVstHandles[i]);
+	}
+	if( numIn > MAX_CHANS )
+		numIn = MAX_CHANS;
+	if( numOut > MAX_CHANS )
+		numOut = MAX_CHANS;
+
+	// is the ring still fine?
+	FORWARD_RING* ring = source->forwardRing;
+	if( ring == NULL
+	 || ring->numChans < numChans
+	 || ring->blockSize != blockSize
+	 || ring->numIn < numIn
+	 || ring->numOut < numOut )
+	{
+		long frames = 1;
+		while( frames < blockSize * FORWARD_RING_BLOCKS )
+			frames <<= 1;
+
+		ring = (FORWARD_RING*)calloc(1, sizeof(FORWARD_RING));
+		if( ring == NULL )
+		{
+			forwardRemove(source);
+			return false;
+		}
+
+		size_t ringStride = arenaStride(frames*sizeof(float));
+		size_t stride = arenaStride(blockSize*sizeof(float)*BUFFER_HEADROOM_MULT);
+		if( !arenaAlloc(&ring->arena, ringStride*numChans + stride*(numIn+numOut)) )
+		{
+			free(ring);
+			forwardRemove(source);
+			return false;
+		}
+
+		BYTE* p = ring->arena.mem;
+		for( i = 0; i < numChans; i++, p += ringStride )
+			ring->chans[i] = (float*)p;
+
+		for( i = 0; i < numIn; i++, p += stride )
+			ring->in[i] = (float*)p;
+
+		for( i = 0; i < numOut; i++, p += stride )
+			ring->out[i] = (float*)p;
+
+		ring->numChans = numChans;
+		ring->frames = frames;
+		ring->blockSize = blockSize;
+		ring->numIn = numIn;
+		ring->numOut = numOut;
+
+		// the audio thread uses the ring only with the plugin locked
+		enterVstCritical(source);
+			FORWARD_RING* oldRing = source->forwardRing;
+			source->forwardRing = ring;
+		leaveVstCritical(source);
+
+		freeRing(oldRing);
+	}
+
+	sjhashInsert(&s_forwardSources, NULL, (int)source->vstHandle, (void*)1/*pData - 0 = remove*/);
+	return true;
+}
+
+
+
+void forwardRemove(BASS_VST_PLUGIN* source)
+{
+	// called by checkForwarding() with s_forwardCritical held
+	enterVstCritical(source);
+		FORWARD_RING* oldRing = source->forwardRing;
+		source->forwardRing = NULL;
+	leaveVstCritical(source);
+
+	freeRing(oldRing);
+
+	sjhashInsert(&s_forwardSources, NULL, (int)source->vstHandle, (void*)0/*pData - 0 = remove*/);
+}
+
+
+
+void forwardFree(BASS_VST_PLUGIN* source)
+{
+	// called by destroyHandle(), nobody else uses the plugin any longer
+	freeRing(source->forwardRing);
+	source->forwardRing = NULL;
+}
+
+
+
+void forwardWrite(BASS_VST_PLUGIN* this_, long numSamples, bool isDouble)
+{
+	// called by the audio thread with the plugin locked: copy the input of the
+	// plugin to the ring, older data are overwritten without waiting for the reader
+	FORWARD_RING* ring = this_->forwardRing;
+	long numChans = ring->numChans < this_->numActiveInputs? ring->numChans : this_->numActiveInputs;
+	long done = 0, todo, offset, c, i;
+	if( numSamples > ring->frames )
+		done = numSamples - ring->frames;
+
+	unsigned long pos = (unsigned long)ring->writePos + done;
+	while( done < numSamples )
+	{
+		offset = (long)(pos & (ring->frames-1));
+		todo = numSamples - done;
+		if( todo > ring->frames - offset )
+			todo = ring->frames - offset;
+
+		for( c = 0; c < numChans; c++ )
+		{
+			if( isDouble )
+			{
+				const double* src = &((double*)this_->buffersIn[c])[done];
+				float* dest = &ring->chans[c][offset];
+				for( i = 0; i < todo; i++ )
+					dest[i] = (float)src[i];
+			}
+			else
+			{
+				memcpy(&ring->chans[c][offset], &this_->buffersIn[c][done], todo*sizeof(float));
+			}
+		}
+
+		done += todo;
+		pos += todo;
+	}
+
+	// publish the samples; this is a full barrier, the reader sees the data before the position
+	InterlockedExchangeAdd(&ring->writePos, numSamples);
+}
+
+
+
+static long readRing(FORWARD_RING* ring, long maxSamples)
+{
+	// called by the forwarding thread: copy the latest samples not read before
+	// to ring->in; returns the number of samples or 0 if there is nothing (valid)
+	unsigned long end = (unsigned long)InterlockedExchangeAdd(&ring->writePos, 0);
+	long numSamples = (long)(end - (unsigned long)ring->readPos);
+	ring->readPos = (long)end;
+	if( numSamples <= 0 )
+		return 0;
+
+	if( numSamples > maxSamples )
+		numSamples = maxSamples;
+
+	unsigned long pos = end - numSamples;
+	long done = 0, todo, offset, c;
+	while( done < numSamples )
+	{
+		offset = (long)(pos & (ring->frames-1));
+		todo = numSamples - done;
+		if( todo > ring->frames - offset )
+			todo = ring->frames - offset;
+
+		for( c = 0; c < ring->numChans; c++ )
+			memcpy(&ring->in[c][done], &ring->chans[c][offset], todo*sizeof(float));
+
+		done += todo;
+		pos += todo;
+	}
+
+	for( c = ring->numChans; c < ring->numIn; c++ )
+		memset(ring->in[c], 0, numSamples*sizeof(float));
+
+	// did the writer overwrite the data while we were copying?  The writer may be
+	// in the middle of another block which is not yet published.
+	unsigned long check = (unsigned long)InterlockedExchangeAdd(&ring->writePos, 0);
+	if( check - (end - numSamples) > (unsigned long)(ring->frames - ring->blockSize) )
+		return 0;
+
+	return numSamples;
+}
+
+
+
+/*****************************************************************************
+ *  the forwarding thread
+ *****************************************************************************/
+
+
+
+static void forwardDo()
+{
+	lockEnter(&s_forwardCritical, BASS_VST_LOCK_FORWARD);
+
+		sjhashElem* elem = sjhashFirst(&s_forwardSources);
+		while( elem )
+		{
+			DWORD sourceHandle = (DWORD)elem->nKey;
+			BASS_VST_PLUGIN* source = refHandle(sourceHandle);
+				FORWARD_RING* ring = source? source->forwardRing : NULL;
+				long numSamples = 0, i;
+				if( ring )
+				{
+					// the block size may have been decreased since the ring was allocated
+					numSamples = readRing(ring, ring->blockSize < source->effBlockSize? ring->blockSize : source->effBlockSize);
+				}
+
+				for( i = 0; numSamples > 0 && i < source->forwardDataToOtherCnt; i++ )
+				{
+					BASS_VST_PLUGIN* other_ = refHandle(source->forwardDataToOtherVstHandles[i]);
+						if( other_
+						 && other_->aeffect->numInputs <= ring->numIn
+						 && other_->aeffect->numOutputs <= ring->numOut )
+						{
+							if( tryEnterVstCritical(other_) )
+							{
+								callProcess(other_, ring->in, ring->out, numSamples, false, true);
+								leaveVstCritical(other_);
+							}
+						}
+					unrefHandle(source->forwardDataToOtherVstHandles[i]);
+				}
+			unrefHandle(sourceHandle);
+
+			elem = sjhashNext(elem);
+		}
+
+	LeaveCriticalSection(&s_forwardCritical);
+}
+
+
+
+static void sleepMs(long ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	usleep(ms*1000);
+#endif
+}
+
+
+
+#ifdef _WIN32
+static DWORD WINAPI forwardThread(LPVOID generation__)
+#else
+static void* forwardThread(void* generation__)
+#endif
+{
+	long generation = (long)(size_t)generation__;
+	while( s_forwardGeneration == generation )
+	{
+		long waited;
+		for( waited = 0; waited < (long)s_forwardInterval && s_forwardGeneration == generation; waited += FORWARD_SLEEP_STEP )
+			sleepMs(FORWARD_SLEEP_STEP);
+
+		if( s_forwardGeneration == generation )
+			forwardDo();
+	}
+
+	InterlockedExchangeAdd(&s_forwardThreadsAlive, -1);
+	return 0;
+}
+
+
+
+void forwardUpdateThread()
+{
+	// called by checkForwarding() with s_forwardCritical held: start the thread if there
+	// is something to forward, stop it otherwise
+	bool needed = (sjhashCount(&s_forwardSources) > 0);
+	if( needed == s_forwardThreadRunning )
+		return;
+
+	long generation = InterlockedExchangeAdd(&s_forwardGeneration, 1) + 1;
+	s_forwardThreadRunning = false;
+	if( !needed )
+		return; // the thread ends itself
+
+	InterlockedExchangeAdd(&s_forwardThreadsAlive, 1);
+#ifdef _WIN32
+	HANDLE thread = CreateThread(NULL, 0, forwardThread, (LPVOID)(size_t)generation, 0, NULL);
+	if( thread )
+	{
+		CloseHandle(thread);
+		s_forwardThreadRunning = true;
+	}
+#else
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if( pthread_create(&thread, &attr, forwardThread, (void*)(size_t)generation) == 0 )
+		s_forwardThreadRunning = true;
+	pthread_attr_destroy(&attr);
+#endif
+
+	if( !s_forwardThreadRunning )
+		InterlockedExchangeAdd(&s_forwardThreadsAlive, -1);
+}
+
+
+
+void exitForwarding()
+{
+	// stop the thread and wait a little for it to end - the application should have
+	// freed all plugins before, however, our code must not be running any longer
+	InterlockedExchangeAdd(&s_forwardGeneration, 1);
+	s_forwardThreadRunning = false;
+
+	long waited;
+	for( waited = 0; s_forwardThreadsAlive > 0 && waited < 2000; waited++ )
+		sleepMs(1);
+
+	sjhashClear(&s_forwardSources);
+}
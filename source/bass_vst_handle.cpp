@@ -73,7 +73,7 @@ BASS_VST_PLUGIN* createHandle(DWORD type, DWORD requestedHandleValue)
 	this_->type = type;
 
 	// make sure, the handle value is okay
-	EnterCriticalSection(&s_handleCritical);
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
 
 	// calculate the handle to use - either use the given one or an incrementing number (not "this_" pointer because that could be reused or be non-unique in 64-bit)
 	if (requestedHandleValue == 0)
@@ -103,6 +103,12 @@ BASS_VST_PLUGIN* createHandle(DWORD type, DWORD requestedHandleValue)
 	InitializeCriticalSection(&this_->vstCritical_);
 	InitializeCriticalSection(&this_->midiCritical_);
 
+	this_->watchdogMaxOverruns = WATCHDOG_DEFAULT_OVERRUNS;
+	this_->sleepDefaultTail = SLEEP_DEFAULT_TAIL;
+	this_->flushDenormals = true;
+	this_->nanGuard = NAN_GUARD_SILENCE;
+	transportInit(this_);
+
 	this_->handleUsage = 1;
 
 	return this_;
@@ -120,14 +126,20 @@ static void destroyHandle(BASS_VST_PLUGIN* this_)
 	this_->needsIdle = 0;
 	updateIdleTimers(this_);
 
-	// free VSTi stream
+	// free VSTi stream and the streams of its outputs
 	if (this_->type == VSTinstrument)
+	{
 		BASS_StreamFree(this_->channelHandle);
+		outputsFree(this_);
+	}
 
 	// ... remove the plugin from the channel
 	if( this_->channelHandle && this_->dspHandle )
 		BASS_ChannelRemoveDSP(this_->channelHandle, this_->dspHandle);
 
+	// ... remove the sidechain from its source
+	sidechainFree(this_);
+
 	// ... stop process
 	if( this_->effStartProcessCalled )
 		closeProcess(this_);
@@ -140,41 +152,43 @@ static void destroyHandle(BASS_VST_PLUGIN* this_)
 		leaveVstCritical(this_);
 	}
 
-	// ... call effClose
-	if( this_->effOpenCalled )
+	// ... call effClose; from now on, the plugin must not reach the instance by resvd2
+	if( this_->aeffect )
+		this_->aeffect->resvd2 = 0;
+
+	if( this_->effOpenCalled && this_->aeffect )
 	{
 		enterVstCritical(this_);
 			this_->aeffect->dispatcher(this_->aeffect, effClose, 0, 0, NULL, 0.0);
 		leaveVstCritical(this_);
 	}
 
-	// unload the library delayed - otherwise we get some curious crashes here and there ...
-	// if the library is aleady pending, increase the unload counter
-	EnterCriticalSection(&s_idleCritical);
-	long oldVal = (long)sjhashFind(&s_unloadPendingInstances, this_->hinst, 0);
+	if( isSandboxed(this_) )
+	{
+		// ... terminate the child process hosting the plugin
+		if( this_->aeffect )
+			sandboxClose(this_->aeffect);
+	}
+	else if( this_->hinst )
+	{
+		// unload the library delayed - otherwise we get some curious crashes here and there ...
+		// if the library is aleady pending, increase the unload counter
+		lockEnter(&s_idleCritical, BASS_VST_LOCK_IDLE);
+		long oldVal = (long)sjhashFind(&s_unloadPendingInstances, this_->hinst, 0);
 
-		sjhashInsert(&s_unloadPendingInstances, this_->hinst, 0,
-			(void*)(oldVal+1)/*pData*/);
+			sjhashInsert(&s_unloadPendingInstances, this_->hinst, 0,
+				(void*)(oldVal+1)/*pData*/);
 
-		s_unloadPendingCountdown = IDLE_UNLOAD_PENDING_COUNTDOWN;
-		createIdleTimers();
-	LeaveCriticalSection(&s_idleCritical);
+			s_unloadPendingCountdown = IDLE_UNLOAD_PENDING_COUNTDOWN;
+			createIdleTimers();
+		LeaveCriticalSection(&s_idleCritical);
+	}
 
 	// delete "easy" data
 	DeleteCriticalSection(&this_->vstCritical_);
 	DeleteCriticalSection(&this_->midiCritical_);
 
-	if( this_->midiEventsCurr )
-	{
-		for( int i=0; i<MAX_MIDI_EVENTS; i++ ) { if( this_->midiEventsCurr->events[i] ) free( this_->midiEventsCurr->events[i] ); }
-		free(this_->midiEventsCurr);
-	}
-
-	if( this_->midiEventsPrev )
-	{
-		for( int i=0; i<MAX_MIDI_EVENTS; i++ ) { if( this_->midiEventsPrev->events[i] ) free( this_->midiEventsPrev->events[i] ); }
-		free(this_->midiEventsPrev);
-	}
+	freeMidiEvents(this_);
 
 	if( this_->defaultValues )
 		free(this_->defaultValues);
@@ -188,8 +202,19 @@ static void destroyHandle(BASS_VST_PLUGIN* this_)
 	if (this_->tempChunkData)
 		free(this_->tempChunkData);
 
-	freeChansBuffers(this_);
-	freeTempBuffer(this_);
+	if( this_->tempProgramNameBuf )
+		free(this_->tempProgramNameBuf);
+
+	if( this_->forwardDataToOtherVstHandles )
+		free(this_->forwardDataToOtherVstHandles);
+
+	freeProcessBuffers(this_);
+	freeFixedBlockBuffers(this_);
+	freeOversampling(this_);
+	freeResampling(this_);
+	forwardFree(this_);
+	transportFree(this_);
+	delayLineFree(&this_->bypassDelay);
 
 	free(this_);
 }
@@ -205,7 +230,7 @@ static void destroyHandle(BASS_VST_PLUGIN* this_)
 BASS_VST_PLUGIN* refHandle(DWORD handle)
 {
 	BASS_VST_PLUGIN* this_ = NULL;
-	EnterCriticalSection(&s_handleCritical);
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
 		this_ = (BASS_VST_PLUGIN*)sjhashFind(&s_handleHash, NULL, /*pKey, not needed*/ (int)handle/*nKey*/);
 		if( this_ )
 			this_->handleUsage++;
@@ -222,7 +247,7 @@ BOOL unrefHandle(DWORD handle)
 
 	BASS_VST_PLUGIN* ptrToDestroy = NULL;
 
-	EnterCriticalSection(&s_handleCritical);
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
 		BASS_VST_PLUGIN* this_ = (BASS_VST_PLUGIN*)sjhashFind(&s_handleHash, NULL, /*pKey, not needed*/ (int)handle/*nKey*/);
 		if( this_ )
 		{
@@ -246,6 +271,75 @@ BOOL unrefHandle(DWORD handle)
 
 
 
+DWORD enumHandles(DWORD* handles, DWORD maxHandles)
+{
+	DWORD count = 0;
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
+		sjhashElem* elem = sjhashFirst(&s_handleHash);
+		while( elem )
+		{
+			BASS_VST_PLUGIN* this_ = (BASS_VST_PLUGIN*)sjhashData(elem);
+			if( count < maxHandles )
+				handles[count] = this_->vstHandle;
+			count++;
+			elem = sjhashNext(elem);
+		}
+	LeaveCriticalSection(&s_handleCritical);
+
+	return count;
+}
+
+
+
+long getChainLatency(DWORD channelHandle)
+{
+	// bypassed plugins only add their latency if they use a bypass delay; the plugins are
+	// referenced under s_handleCritical and read under their own critical sections, so
+	// the audio threads do not wait for the handles while a plugin is processing
+	BASS_VST_PLUGIN** plugins = NULL;
+	long latency = 0, count = 0, i;
+
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
+		if( sjhashCount(&s_handleHash) > 0 )
+			plugins = (BASS_VST_PLUGIN**)malloc(sjhashCount(&s_handleHash) * sizeof(BASS_VST_PLUGIN*));
+		if( plugins )
+		{
+			sjhashElem* elem = sjhashFirst(&s_handleHash);
+			while( elem )
+			{
+				BASS_VST_PLUGIN* this_ = (BASS_VST_PLUGIN*)sjhashData(elem);
+				if( this_->channelHandle == channelHandle )
+				{
+					this_->handleUsage++;
+					plugins[count++] = this_;
+				}
+				elem = sjhashNext(elem);
+			}
+		}
+	LeaveCriticalSection(&s_handleCritical);
+
+	for( i = 0; i < count; i++ )
+	{
+		BASS_VST_PLUGIN* this_ = plugins[i];
+		enterVstCritical(this_);
+			if( this_->aeffect && this_->effStartProcessCalled )
+			{
+				if( !this_->doBypass )
+					latency += getTotalLatency(this_);
+				else
+					latency += this_->bypassDelay.frames;
+			}
+		leaveVstCritical(this_);
+		unrefHandle(this_->vstHandle);
+	}
+
+	if( plugins )
+		free(plugins);
+	return latency;
+}
+
+
+
 #ifdef _WIN32
 BOOL tryEnterVstCritical(BASS_VST_PLUGIN* this_)
 {
@@ -262,18 +356,22 @@ BOOL tryEnterVstCritical(BASS_VST_PLUGIN* this_)
 
 	if( m_pfnTryEnterCriticalSection )
 	{
-		return m_pfnTryEnterCriticalSection(&this_->vstCritical_);
+		BOOL success = m_pfnTryEnterCriticalSection(&this_->vstCritical_);
+		lockTried(BASS_VST_LOCK_PLUGIN, success);
+		return success;
 	}
 	else
 	{
-		EnterCriticalSection(&this_->vstCritical_);
+		lockEnter(&this_->vstCritical_, BASS_VST_LOCK_PLUGIN);
 		return TRUE;
 	}
 }
 #else
 BOOL tryEnterVstCritical(BASS_VST_PLUGIN* this_)
 {
-	return !pthread_mutex_trylock(&this_->vstCritical_);
+	BOOL success = !pthread_mutex_trylock(&this_->vstCritical_);
+	lockTried(BASS_VST_LOCK_PLUGIN, success);
+	return success;
 }
 #endif
 
@@ -281,7 +379,7 @@ BOOL tryEnterVstCritical(BASS_VST_PLUGIN* this_)
 
 void enterVstCritical(BASS_VST_PLUGIN* this_)
 {
-	EnterCriticalSection(&this_->vstCritical_);
+	lockEnter(&this_->vstCritical_, BASS_VST_LOCK_PLUGIN);
 }
 
 
@@ -346,11 +444,12 @@ int validateLastValues(BASS_VST_PLUGIN* this_)
 
 void checkForwarding()
 {
-	sjhash oldForwardReceivers;
+	sjhash oldForwardReceivers, forwardSources;
 	sjhashInit(&oldForwardReceivers, SJHASH_POINTER, /*keytype*/ 0/*copyKey*/);
+	sjhashInit(&forwardSources, SJHASH_POINTER, /*keytype*/ 0/*copyKey*/);
 
-	EnterCriticalSection(&s_forwardCritical);
-	EnterCriticalSection(&s_handleCritical);
+	lockEnter(&s_forwardCritical, BASS_VST_LOCK_FORWARD);
+	lockEnter(&s_handleCritical, BASS_VST_LOCK_HANDLES);
 
 		// collect all "old" forward receivers
 		BASS_VST_PLUGIN* this_;
@@ -389,9 +488,15 @@ void checkForwarding()
 					if( other_->channelHandle != 0
 					 && other_->editorScope == this_->editorScope )
 					{
-						other_->forwardDataToOtherVstHandles[other_->forwardDataToOtherCnt] = this_->vstHandle;
-						if( other_->forwardDataToOtherCnt < MAX_FWD-1 ) // if the buffer (128(!) handles) is full, this will only result in display problems of VU meters, nothing really to worry about ...
-							other_->forwardDataToOtherCnt++;
+						if( other_->forwardDataToOtherVstHandles == NULL )
+							other_->forwardDataToOtherVstHandles = (DWORD*)malloc(MAX_FWD*sizeof(DWORD));
+
+						if( other_->forwardDataToOtherVstHandles )
+						{
+							other_->forwardDataToOtherVstHandles[other_->forwardDataToOtherCnt] = this_->vstHandle;
+							if( other_->forwardDataToOtherCnt < MAX_FWD-1 ) // if the buffer (128(!) handles) is full, this will only result in display problems of VU meters, nothing really to worry about ...
+								other_->forwardDataToOtherCnt++;
+						}
 
 						if( sjhashInsert(&oldForwardReceivers, this_, 0,
 							(void*)0/*pData - 0 = remove*/) == 0 )
@@ -421,9 +526,49 @@ void checkForwarding()
 			elemThis = sjhashNext(elemThis);
 		}
 
+		// collect the plugins whose rings are to be (re)allocated or freed; this locks
+		// the plugins and must be done without s_handleCritical as the audio thread
+		// may lock the handles while processing
+		elemThis = sjhashFirst(&s_handleHash);
+		while( elemThis )
+		{
+			this_ = (BASS_VST_PLUGIN*)sjhashData(elemThis);
+
+			if( this_->forwardDataToOtherCnt > 0 || this_->forwardRing )
+			{
+				this_->handleUsage++; // as refHandle(), released by unrefHandle() below
+				sjhashInsert(&forwardSources, this_, 0, (void*)1/*pData - 0 = remove*/);
+			}
+
+			elemThis = sjhashNext(elemThis);
+		}
 
 	LeaveCriticalSection(&s_handleCritical);
+
+		elemThis = sjhashFirst(&forwardSources);
+		while( elemThis )
+		{
+			this_ = (BASS_VST_PLUGIN*)sjhashKey(elemThis);
+
+			if( this_->forwardDataToOtherCnt > 0 )
+			{
+				if( !forwardPrepare(this_) )
+					this_->forwardDataToOtherCnt = 0;
+			}
+			else
+			{
+				forwardRemove(this_);
+			}
+			unrefHandle(this_->vstHandle);
+
+			elemThis = sjhashNext(elemThis);
+		}
+
+		// start or stop the forwarding thread
+		forwardUpdateThread();
+
 	LeaveCriticalSection(&s_forwardCritical);
 
 	sjhashClear(&oldForwardReceivers);
+	sjhashClear(&forwardSources);
 }
@@ -17,6 +17,11 @@
 
 
 #include "bass_vst_impl.h"
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#elif !defined(_WIN32)
+#include <time.h>
+#endif
 
 
 
@@ -68,26 +73,36 @@ static void checkForChangedParam(BASS_VST_PLUGIN* this_)
 
 void idleDo()
 {
-	static bool s_inHere = false;
-	if( !s_inHere )
+	// the timers may call us from different threads (and recursively while the
+	// plugin pumps messages), so the check and the set must be atomic
+	static volatile long s_inHere = 0;
+	if( InterlockedCompareExchange(&s_inHere, 1, 0) == 0 )
 	{
-		s_inHere = true;
-		EnterCriticalSection(&s_idleCritical);
-
 #ifndef __linux__
-            assert( _CrtCheckMemory() );
+		assert( _CrtCheckMemory() );
 #endif
-			BASS_VST_PLUGIN* this_;
-			DWORD vstHandle;
-			bool removeElem;
-			sjhashElem *elem = sjhashFirst(&s_idleHash), *next;
-			while( elem )
+		// the plugins are called without s_idleCritical: they call updateIdleTimers()
+		// from audioMaster while the audio thread holds their vstCritical_, so the
+		// handles are collected in batches first (no malloc, on Linux we may be in
+		// a signal handler); plugins added meanwhile are served by the next call
+		DWORD handles[IDLE_BATCH];
+		BASS_VST_PLUGIN* plugins[IDLE_BATCH];
+		int numHandles, numKept = 0, i;
+		do
+		{
+			numHandles = 0;
+			lockEnter(&s_idleCritical, BASS_VST_LOCK_IDLE);
+				sjhashElem* elem = sjhashFirst(&s_idleHash);
+				for( i = 0; elem && i < numKept; i++ )
+					elem = sjhashNext(elem);
+				for( ; elem && numHandles < IDLE_BATCH; elem = sjhashNext(elem) )
+					handles[numHandles++] = (DWORD)sjhashKeysize(elem);
+			LeaveCriticalSection(&s_idleCritical);
+
+			for( i = 0; i < numHandles; i++ )
 			{
-				next = sjhashNext(elem);
-				removeElem = false;
-
-				vstHandle = (DWORD)sjhashKeysize(elem);
-				this_ = refHandle(vstHandle);
+				DWORD vstHandle = handles[i];
+				BASS_VST_PLUGIN* this_ = plugins[i] = refHandle(vstHandle);
 				if( this_ )
 				{
 					if( this_->needsIdle & NEEDS_IDLE_OUTSIDE_EDIT )
@@ -109,36 +124,65 @@ void idleDo()
 						checkForChangedParam(this_);
 					}
 
-					if( this_->needsIdle == 0 )
-						removeElem = true;
+					if( this_->needsIdle & NEEDS_LATENCY_UPDATE )
+					{
+						// the plugin's latency may have changed
+						this_->needsIdle &= ~NEEDS_LATENCY_UPDATE;
+						updateLatency(this_);
+						if( this_->callback )
+							this_->callback(vstHandle, BASS_VST_LATENCY_CHANGED, getTotalLatency(this_), 0, this_->callbackUserData);
+					}
+
+					if( this_->needsIdle & NEEDS_PARAM_UPDATE )
+					{
+						// the parameters of a sandboxed plugin may have changed, see audioMasterUpdateDisplay
+						this_->needsIdle &= ~NEEDS_PARAM_UPDATE;
+						enterVstCritical(this_);
+							int oldParamCount = this_->numLastValues;
+							int newParamCount = validateLastValues(this_);
+						leaveVstCritical(this_);
+						if( this_->callback )
+							this_->callback(vstHandle, BASS_VST_PARAM_CHANGED, oldParamCount, newParamCount, this_->callbackUserData);
+					}
 
-					unrefHandle(vstHandle);
-				}
-				else
-				{
-#ifndef __linux__
-                    assert( _CrtCheckMemory() );
-#endif
-					removeElem = true;
 				}
+			}
 
-				// any more idle needed for this effect?
-				if( removeElem )
+			// any more idle needed for the effects? needsIdle is checked under the lock as
+			// updateIdleTimers() is called after setting it; the references are released
+			// without the lock as the last one destroys the plugin
+			lockEnter(&s_idleCritical, BASS_VST_LOCK_IDLE);
+				for( i = 0; i < numHandles; i++ )
 				{
-					sjhashInsert(&s_idleHash, NULL, /*pKey, not needed*/ (int)vstHandle, /*nKey (keySize)*/ 
-						(void*)0/*pData - 0 = remove*/);
+					if( plugins[i] == NULL || plugins[i]->needsIdle == 0 )
+					{
+						sjhashInsert(&s_idleHash, NULL, /*pKey, not needed*/ (int)handles[i], /*nKey (keySize)*/ 
+							(void*)0/*pData - 0 = remove*/);
+					}
+					else
+					{
+						numKept++;
+					}
 				}
+			LeaveCriticalSection(&s_idleCritical);
 
-				elem = next;
+			for( i = 0; i < numHandles; i++ )
+			{
+				if( plugins[i] )
+					unrefHandle(handles[i]);
 			}
-			
+		}
+		while( numHandles == IDLE_BATCH );
+
+		lockEnter(&s_idleCritical, BASS_VST_LOCK_IDLE);
+
 			// unload pending instances
 			if( sjhashCount(&s_unloadPendingInstances) )
 			{
 				s_unloadPendingCountdown--;
 				if( s_unloadPendingCountdown <= 0 )
 				{
-					elem = sjhashFirst(&s_unloadPendingInstances);
+					sjhashElem* elem = sjhashFirst(&s_unloadPendingInstances);
 					while( elem )
 					{
 						HINSTANCE inst = (HINSTANCE)sjhashKey(elem);
@@ -171,7 +215,7 @@ void idleDo()
 			}			
 
 		LeaveCriticalSection(&s_idleCritical);
-		s_inHere = false;
+		InterlockedExchange(&s_inHere, 0);
 	}
 }
 
@@ -179,7 +223,7 @@ void idleDo()
 
 void updateIdleTimers(BASS_VST_PLUGIN* this_)
 {
-	EnterCriticalSection(&s_idleCritical);
+	lockEnter(&s_idleCritical, BASS_VST_LOCK_IDLE);
 
 		sjhashInsert(&s_idleHash, NULL, /*pKey, not needed*/ (int)this_->vstHandle, /*nKey*/ 
 			(void*)this_->needsIdle/*pData - 0 = remove*/);
@@ -201,9 +245,32 @@ void updateIdleTimers(BASS_VST_PLUGIN* this_)
 
 
 /*****************************************************************************
- *  low-level OS-based timers
+ *  low-level OS-based timers and clocks
  *****************************************************************************/
 
+QWORD getTimeNs()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER s_freq;
+	LARGE_INTEGER now;
+	if( s_freq.QuadPart == 0 )
+		QueryPerformanceFrequency(&s_freq);
+	QueryPerformanceCounter(&now);
+	return (QWORD)((double)now.QuadPart * 1000000000.0 / (double)s_freq.QuadPart);
+#elif __APPLE__
+	static mach_timebase_info_data_t s_timebase;
+	if( s_timebase.denom == 0 )
+		mach_timebase_info(&s_timebase);
+	return mach_absolute_time() * s_timebase.numer / s_timebase.denom;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+
 #ifdef __APPLE__
 #include <Carbon/Carbon.h>
 static EventLoopTimerRef s_idleTimerHandle = 0;
@@ -82,7 +82,12 @@ static void mainInit()
 	}
 	s_bassfunc = bassfunc;
 
+	lockStatsInit();
+	allocCheckInit();
+
 	initHandleHandling();
+	initForwarding();
+	initLatencyHandling();
 
 	InitializeCriticalSection(&s_idleCritical);
 	sjhashInit(&s_idleHash, SJHASH_INT, /*keytype*/ 0/*copyKey*/);
@@ -105,11 +110,15 @@ static void mainExit()
 
 	killIdleTimers();
 
+	exitForwarding();
 	exitHandleHandling();			
+	exitLatencyHandling();
 	
 	DeleteCriticalSection(&s_idleCritical);
 	sjhashClear(&s_idleHash);
 	sjhashClear(&s_unloadPendingInstances);
+
+	lockStatsExit();
 }
 
 
@@ -158,12 +167,10 @@ BOOL APIENTRY DllMain(HANDLE hModule, DWORD ul_reason_for_call, LPVOID lpReserve
 
 
 
-// type of the plugin's main entry function
-typedef AEffect *(*dllMainEntryFuncType) (audioMasterCallback);
-
 // s_inConstructionVstHandle is a little hack as this_ is not yet valid
-// when audioMasterCurrentId is called
-static DWORD s_inConstructionVstHandle = 0;
+// when audioMasterCurrentId is called; thread-local as plugins may be loaded
+// by different threads at the same time
+static THREAD_LOCAL DWORD s_inConstructionVstHandle = 0;
 static long s_language = kVstLangEnglish;
 
 
@@ -183,58 +190,104 @@ static long getSampleRate(BASS_VST_PLUGIN* this_)
 
 
 
-static void calcVstTimeInfo(BASS_VST_PLUGIN* this_, VstIntPtr toCalc)
+// give the user the chance to handle an audioMaster opcode, see BASS_VST_AUDIO_MASTER;
+// returns true if the opcode was handled, the result is written to ret then
+static bool userAudioMaster(DWORD vstHandle, VSTPROC* callback, void* callbackUserData, AEffect* aeffect,
+							VstInt32 opcode, VstInt32 index, VstIntPtr value, void* ptr, float opt, VstIntPtr* ret)
 {
-	this_->vstTimeInfo.flags = kVstTransportPlaying;
-	this_->vstTimeInfo.sampleRate = getSampleRate(this_);
-
-	if( toCalc & kVstNanosValid )
-	{
-#ifdef _WIN32
-		this_->vstTimeInfo.nanoSeconds = (double)timeGetTime() * 1000000.0L;
+	BASS_VST_AUDIO_MASTER_PARAM amp;
+	amp.aeffect		= aeffect;
+	amp.opcode		= opcode;
+	amp.index		= index;
+	amp.value		= value;
+	amp.ptr			= ptr;
+	amp.opt			= opt;
+	amp.doDefault	= 1;
+#if VST_64BIT_PLATFORM
+	*ret = callback(vstHandle, BASS_VST_AUDIO_MASTER, (DWORD)(intptr_t)&amp, (DWORD)((intptr_t)&amp>>32), callbackUserData);
 #else
-		this_->vstTimeInfo.nanoSeconds = (double)clock() * 1000000.0L;
+	*ret = callback(vstHandle, BASS_VST_AUDIO_MASTER, (DWORD)(intptr_t)&amp, 0, callbackUserData);
 #endif
-		this_->vstTimeInfo.flags |= kVstNanosValid;
-	}
-	
-	if( toCalc & kVstTimeSigValid )
-	{
-		this_->vstTimeInfo.timeSigNumerator   = 4;
-		this_->vstTimeInfo.timeSigDenominator = 4;
-		this_->vstTimeInfo.flags |= kVstTimeSigValid;
-	}
+	return amp.doDefault == 0;
+}
 
-	if( toCalc & (kVstTempoValid|kVstPpqPosValid) )
-	{
-		this_->vstTimeInfo.tempo = 120;
-		this_->vstTimeInfo.flags |= kVstTempoValid;
-	}
 
-	if( toCalc & kVstPpqPosValid )
-	{
-		double dPos = this_->vstTimeInfo.samplePos / this_->vstTimeInfo.sampleRate;
-		this_->vstTimeInfo.ppqPos = dPos * this_->vstTimeInfo.tempo / 60.L;
-		this_->vstTimeInfo.flags |= kVstPpqPosValid;
-	}
-	
-	if( toCalc & kVstSmpteValid )
-	{
-		static const double fSmpteDiv[] = {24.f,25.f,24.f,30.f,29.97f,30.f};
-		this_->vstTimeInfo.smpteFrameRate = kVstSmpte24fps;
 
-		double dPos = this_->vstTimeInfo.samplePos / this_->vstTimeInfo.sampleRate;
-		double dOffsetInSecond = dPos - floor(dPos);
-		this_->vstTimeInfo.smpteOffset = (long)(dOffsetInSecond * fSmpteDiv[this_->vstTimeInfo.smpteFrameRate] * 80.L);
-		this_->vstTimeInfo.flags |= kVstSmpteValid;
-	}
+// the answers to audioMasterCanDo; canDo() finds the only possible entry by a perfect
+// hash over the length, the first and the last but one character of the string - the
+// table has to be checked if strings are added
+#define CAN_DO_HASH(len, first, lastButOne)	(((len) + ((first)|0x20) + ((lastButOne)|0x20)) & 15)
+static const char* const s_canDo[16] =
+{
+	NULL,
+	"sendvstmidievent",		// ... esp. MIDI event for VSTi
+	"shellcategory",
+	"closefileselector",	// we support audioMasterCloseFileSelector
+	"sendvstevents",		// we can (and will!) send events to the plugin ...
+	"acceptIOChanges",		// we adapt the delay compensation on audioMasterIOChanged
+	"startstopprocess",		// we calls effStartProcess and effStopProcess
+	NULL,
+	"sendvsttimeinfo",		// on request, we can send timing information to the plugin (see transportUpdate())
+	"supplyidle",
+	NULL,
+	NULL,
+	"sizewindow",
+	NULL,
+	"openfileselector",		// we support audioMasterOpenFileSelector
+	NULL,
+};
+
+
+
+static bool canDo(const char* what)
+{
+	if( what == NULL )
+		return false;
+	size_t len = strlen(what);
+	if( len < 2 )
+		return false;
+	const char* entry = s_canDo[CAN_DO_HASH(len, (unsigned char)what[0], (unsigned char)what[len-2])];
+	return entry && strcasecmp(what, entry) == 0;
+}
+
+
+
+// the opcodes called most often are answered from values cached by the plugin's
+// instance, they need neither a lock nor a BASS call
+static bool isCachedOpcode(VstInt32 opcode)
+{
+	return opcode == audioMasterGetTime
+		|| opcode == audioMasterGetSampleRate
+		|| opcode == audioMasterGetBlockSize
+		|| opcode == audioMasterVersion
+		|| opcode == audioMasterCanDo;
+}
 
-	if( toCalc & kVstCyclePosValid )
+
+
+static VstIntPtr answerCachedOpcode(BASS_VST_PLUGIN* this_, VstInt32 opcode, void* ptr)
+{
+	switch( opcode )
 	{
-		this_->vstTimeInfo.cycleStartPos = 0;
-		this_->vstTimeInfo.cycleEndPos = 0;
-		this_->vstTimeInfo.flags |= kVstCyclePosValid;
+		case audioMasterGetTime:				// the snapshot of the current or last block, see transportUpdate();
+			return (VstIntPtr)transportTimeInfo(this_); // valid at least until the next block
+
+		case audioMasterGetSampleRate:			// the sample rate is updated with each block, too
+			return (VstIntPtr)transportTimeInfo(this_)->sampleRate;
+
+		case audioMasterGetBlockSize:			// 0 if not yet assigned to a channel
+			return getPluginBlockSize(this_, this_->fixedBlockSize? this_->fixedBlockSize : this_->effBlockSize);
+
+		case audioMasterVersion:				// VST Version supported (for example 2200 for VST 2.2) --
+			return kVstVersion;					// 2 for VST 2.00, 2100 for VST 2.1, 2200 for VST 2.2 etc.
+												// We use 2.4 although we do not support all features
+												// as some plugins relies on this without checking :-(
+												// (eg. TripleComp crashes if the version is set to 2)
+
+		case audioMasterCanDo:					// string in ptr
+			return canDo((const char*)ptr)? 1 : 0;
 	}
+	return 0;
 }
 
 
@@ -251,6 +304,21 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 {
 	VstIntPtr ret = 0;
 
+	// fast path for the opcodes called most often: resvd2 points to the instance from
+	// loading the plugin until effClose is dispatched, see loadVstLibrary(),
+	// closeVstLibrary() and destroyHandle(); both clear resvd2 before effClose and
+	// before the instance is freed - so we need neither the handle lookup nor any lock.
+	// Calls during or after effClose take the slow path below.
+	BASS_VST_PLUGIN* instance_ = aeffect_? (BASS_VST_PLUGIN*)aeffect_->resvd2 : NULL;
+	if( instance_ && isCachedOpcode(opcode) )
+	{
+		if( instance_->callback
+		 && userAudioMaster(instance_->vstHandle, instance_->callback, instance_->callbackUserData, aeffect_,
+				opcode, index, value, ptr, opt, &ret) )
+			return ret;
+		return answerCachedOpcode(instance_, opcode, ptr);
+	}
+
 	DWORD vstHandle = (aeffect_ && aeffect_->resvd1)?		// litte bug fix for 2.4.0.2: we also check for aeffect_->resvd1 now, so we will _always_ get a handle as 
 			(DWORD)aeffect_->resvd1 : s_inConstructionVstHandle;	// s_inConstructionVstHandle is always valid until aeffect_->resvd1 is set.
 	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
@@ -264,21 +332,9 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 	{
 		VSTPROC*		callback = this_->callback;
 		void*			callbackUserData = this_->callbackUserData;
-		BASS_VST_AUDIO_MASTER_PARAM amp;
-		amp.aeffect		= this_->aeffect;
-		amp.opcode		= opcode;
-		amp.index		= index;
-		amp.value		= value;
-		amp.ptr			= ptr;
-		amp.opt			= opt;
-		amp.doDefault	= 1;
+		AEffect*		aeffect = this_->aeffect;
 		unrefHandle(vstHandle);
-#if VST_64BIT_PLATFORM
-		ret = callback(vstHandle, BASS_VST_AUDIO_MASTER, (DWORD)(intptr_t)&amp, (DWORD)((intptr_t)&amp>>32), callbackUserData);
-#else
-		ret = callback(vstHandle, BASS_VST_AUDIO_MASTER, (DWORD)(intptr_t)&amp, 0, callbackUserData);
-#endif
-		if( amp.doDefault == 0 )
+		if( userAudioMaster(vstHandle, callback, callbackUserData, aeffect, opcode, index, value, ptr, opt, &ret) )
 			return ret;
 		ret = 0;
 		this_ = refHandle(vstHandle); // reallocate the handle
@@ -286,6 +342,14 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 			return 0;
 	}
 
+	// while loading, the cached opcodes come here
+	if( isCachedOpcode(opcode) )
+	{
+		ret = answerCachedOpcode(this_, opcode, ptr);
+		unrefHandle(vstHandle);
+		return ret;
+	}
+
 
 	switch( opcode )
 	{
@@ -296,12 +360,6 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 			break;								// however, we do not rely on this as some plugins do not send this message.
 												// Instead, we poll for parameter changes in our idle routine.
 
-		case audioMasterVersion:				// VST Version supported (for example 2200 for VST 2.2) --
-			ret = kVstVersion;					// 2 for VST 2.00, 2100 for VST 2.1, 2200 for VST 2.2 etc.
-			break;								// We use 2.4 although we do not support all features
-												// as some plugins relies on this without checking :-(
-												// (eg. TripleComp crashes if the version is set to 2)
-
 		case audioMasterCurrentId:				// Returns the unique id of a plug that's currently loading
 //			ret = vstHandle;
 			ret = this_->pluginID;
@@ -329,7 +387,13 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 		////////////////////////////////////////////////////////////
 
 		case audioMasterUpdateDisplay: // the plug-in reported an update (e.g. after a program load/rename or any other param change)
-			if (this_->effStartProcessCalled)
+			if (this_->effStartProcessCalled && isSandboxed(this_))
+			{
+				// replayed by the proxy while the caller holds vstCritical_, see bass_vst_sandbox.cpp
+				this_->needsIdle |= NEEDS_PARAM_UPDATE;
+				updateIdleTimers(this_);
+			}
+			else if (this_->effStartProcessCalled)
 			{
 				enterVstCritical(this_);
 					int oldParamCount = this_->numLastValues;
@@ -340,17 +404,18 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 			}
 			break;
 
-		case audioMasterGetTime:
-			calcVstTimeInfo(this_, value);
-			ret =(VstIntPtr)&this_->vstTimeInfo;// the structure needs to be valid "a moment"; it is overwritten on the next call to audioMasterGetTime
-			break;
-		
 		case __audioMasterNeedIdleDeprecated:	// plug needs idle calls (outside its editor window) (although this is deprecated it is heavily used by VST 2.3 and sooner)
 			this_->needsIdle |= NEEDS_IDLE_OUTSIDE_EDIT;
 			updateIdleTimers(this_);
 			ret = 1;
 			break;
 			
+		case audioMasterIOChanged:				// the plugin's latency or number of channels may have changed -
+			this_->needsIdle |= NEEDS_LATENCY_UPDATE; // this may be sent while processing, so the update is done
+			updateIdleTimers(this_);			// in the next idle call
+			ret = 1;
+			break;
+
 		case audioMasterSizeWindow:				// index: width, value: height
 			if( this_->callback )
 			{
@@ -358,10 +423,6 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 			}
 			break;
 
-		case audioMasterGetSampleRate:
-			ret = getSampleRate(this_);
-			break;
-
 		case audioMasterGetVendorString:		// fills <ptr> with a string identifying the vendor (max 64 char)
 			strcpy((char*)ptr, "Bjoern Petersen Software Design and Development"/*max 64 char!*/);
 			ret = true;
@@ -376,21 +437,6 @@ static VstIntPtr audioMasterCallbackImpl(AEffect* aeffect_, // on load, aeffect_
 			ret = BASS_VST_VERSION_HEX;
 			break;
 
-		case audioMasterCanDo:					// string in ptr, see below
-			if( strcasecmp((char*)ptr, "supplyidle")==0
-			 || strcasecmp((char*)ptr, "sendvstevents")==0		// we can (and will!) send events to the plugin ...
-			 || strcasecmp((char*)ptr, "sendvstmidievent")==0	// ... esp. MIDI event for VSTi
-			 || strcasecmp((char*)ptr, "sendvsttimeinfo")==0	// on request, we can send timing information to the plugin (see this_->vstTimeInfo)
-			 || strcasecmp((char*)ptr, "openfileselector")==0	// we support audioMasterOpenFileSelector?
-			 || strcasecmp((char*)ptr, "closefileselector")==0	// we support audioMasterCloseFileSelector?
-			 || strcasecmp((char*)ptr, "sizewindow")==0
-			 || strcasecmp((char*)ptr, "startstopprocess")==0 	// we calls effStartProcess  and effStopProcess
-				|| strcasecmp((char*)ptr, "shellcategory") == 0)
-			{
-				ret = 1;
-			}
-			break;
-
 		case audioMasterGetLanguage:			// see enum
 			ret = s_language;
 			break;
@@ -455,6 +501,23 @@ static void CALLBACK onChannelDestroy(HSYNC handle, DWORD channel, DWORD data, U
 		unrefHandle(vstHandle);   // second call to free the channel at all
 
 		checkForwarding();
+		updateCompensation();
+	}
+}
+
+
+
+static void CALLBACK onChannelSetPos(HSYNC /*handle*/, DWORD channel, DWORD /*data*/, USERPTR vstHandle__)
+{
+	// the transport follows the position of the channel, see BASS_VST_SetTransportPos()
+	DWORD vstHandle = (DWORD)(intptr_t)vstHandle__; // double cast to stop Xcode complaining
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ )
+	{
+		QWORD pos = BASS_ChannelGetPosition(channel, BASS_POS_BYTE);
+		if( pos != (QWORD)-1 )
+			transportRelocate(this_, BASS_ChannelBytes2Seconds(channel, pos));
+		unrefHandle(vstHandle);
 	}
 }
 
@@ -466,10 +529,27 @@ static int ExceptionHandler(void)
 
 static void closeVstLibrary(BASS_VST_PLUGIN* this_)
 {
+	// the plugin may call us until closed, but the instance is freed then
+	if (this_->aeffect)
+		this_->aeffect->resvd2 = 0;
+
+	if (isSandboxed(this_))
+	{
+		if (this_->aeffect)
+		{
+			this_->aeffect->dispatcher(this_->aeffect, effClose, 0, 0, NULL, 0.0);
+			sandboxClose(this_->aeffect);
+			this_->aeffect = NULL;
+		}
+		this_->effOpenCalled = false;
+		return;
+	}
+
 	if (this_->hinst != NULL)
 	{
 		if (this_->aeffect)
 			this_->aeffect->dispatcher(this_->aeffect, effClose, 0, 0, NULL, 0.0);
+		this_->effOpenCalled = false;
 #ifdef _WIN32
 		FreeLibrary(this_->hinst);
 #elif __linux__
@@ -490,6 +570,20 @@ static BOOL loadVstLibrary(BASS_VST_PLUGIN* this_, const void* dllFile, DWORD cr
 	// init some values
 	this_->createFlags						= createFlags;
 
+	// sandboxed plugins are loaded by a child process, we only get a proxy
+	if (isSandboxed(this_))
+	{
+		DWORD error = BASS_OK;
+		this_->pluginID = pluginID;
+		this_->aeffect = sandboxOpen(dllFile, pluginID, audioMasterCallbackImpl, &error);
+		if (this_->aeffect == NULL)
+		{
+			SET_ERROR(error);
+			return false;
+		}
+		goto PluginLoaded;
+	}
+
 	// load the library
 	//__try
 	try
@@ -562,6 +656,8 @@ static BOOL loadVstLibrary(BASS_VST_PLUGIN* this_, const void* dllFile, DWORD cr
 	s_inConstructionVstHandle = this_->vstHandle;
 	this_->pluginID = pluginID;
 	this_->aeffect = (dllMainEntryFuncPtr)(audioMasterCallbackImpl);
+
+PluginLoaded:
 	if(  this_->aeffect == NULL 
 		 ||  this_->aeffect->magic != kEffectMagic
 	     || (this_->aeffect->__processDeprecated == NULL && this_->aeffect->processReplacing == NULL && !canDoubleReplacing(this_))
@@ -616,6 +712,8 @@ static BOOL loadVstLibrary(BASS_VST_PLUGIN* this_, const void* dllFile, DWORD cr
 		}
 	}
 	this_->aeffect->resvd1 = (long)this_->vstHandle;
+	transportUpdate(this_, getSampleRate(this_)); // the time info until the first block is processed, answered by the fast path from now on
+	this_->aeffect->resvd2 = (VstIntPtr)this_; // the fast path of audioMasterCallbackImpl()
 	s_inConstructionVstHandle = 0;
 
 	// check if there are enough inputs / outputs
@@ -716,6 +814,9 @@ BOOL BASS_VSTDEF(BASS_VST_CheckPreset)(const void* dllFile, DWORD createFlags)
 {
 	dllMainEntryFuncType dllMainEntryFuncPtr;
 	HINSTANCE			hinst;
+#ifndef _WIN32
+	(void)createFlags; // BASS_UNICODE is only used on Windows
+#endif
 
 	// load the library
 	//__try
@@ -1244,10 +1345,14 @@ DWORD BASS_VSTDEF(BASS_VST_ChannelSetDSPEx)(DWORD channelHandle, const void* dll
 		{
 			goto Error; // error already logged by BASS
 		}
+
+		// relocate the transport if the position is changed, not needed for function
+		BASS_ChannelSetSync(channelHandle, BASS_SYNC_SETPOS|BASS_SYNC_MIXTIME, 0, onChannelSetPos, (USERPTR)(intptr_t)this_->vstHandle);
 	}
 
 	// success
 	checkForwarding();
+	updateCompensation();
 	RETURN_SUCCESS(this_->vstHandle);
 
 Error:
@@ -1265,6 +1370,7 @@ BOOL BASS_VSTDEF(BASS_VST_ChannelRemoveDSP)(DWORD channelHandle, DWORD vstHandle
 		RETURN_ERROR( BASS_ERROR_HANDLE );
 
 	checkForwarding();
+	updateCompensation();
 
 	RETURN_SUCCESS( true );
 }
@@ -1295,7 +1401,7 @@ DWORD BASS_VSTDEF(BASS_VST_ChannelCreateEx)(DWORD freq, DWORD chans, const void*
 
 	// get the slot, load the library
 	{
-		DWORD vstHandle = BASS_StreamCreate(freq, chans, createFlags, doInstrumentProcess, 0);
+		DWORD vstHandle = BASS_StreamCreate(freq, chans, createFlags&~BASS_VST_SANDBOX, doInstrumentProcess, 0);
 		if (vstHandle == 0)
 			goto Error; // error already logged by BASS
 
@@ -1310,6 +1416,7 @@ DWORD BASS_VSTDEF(BASS_VST_ChannelCreateEx)(DWORD freq, DWORD chans, const void*
 
 	// set a sync to free resources
 	BASS_ChannelSetSync(this_->vstHandle, BASS_SYNC_FREE, 0, onChannelDestroy, (USERPTR)this_->vstHandle);
+	BASS_ChannelSetSync(this_->vstHandle, BASS_SYNC_SETPOS|BASS_SYNC_MIXTIME, 0, onChannelSetPos, (USERPTR)(intptr_t)this_->vstHandle);
 
 	this_->channelHandle = this_->vstHandle;
 	if (!loadVstLibrary(this_, dllFile, createFlags, pluginList, pluginListSize, pluginID))
@@ -1325,6 +1432,7 @@ DWORD BASS_VSTDEF(BASS_VST_ChannelCreateEx)(DWORD freq, DWORD chans, const void*
 	}
 
 	// success -- checkForwarding() is not needed as forwarding only affects the VSTeffects
+	updateCompensation();
 	RETURN_SUCCESS(this_->vstHandle);
 
 Error:
@@ -1336,6 +1444,29 @@ Error:
 
 
 
+DWORD BASS_VSTDEF(BASS_VST_ChannelCreateOutput)(DWORD vstHandle, DWORD firstOutput, DWORD chans, DWORD flags)
+{
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	// outputsCreate() takes care of the locking
+	DWORD error = BASS_OK;
+	HSTREAM stream = outputsCreate(this_, (long)firstOutput, (long)chans, flags, &error);
+
+	unrefHandle(vstHandle);
+
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
+	if( stream == 0 )
+		return 0; // error already set by BASS
+
+	RETURN_SUCCESS( stream );
+}
+
+
+
 BOOL BASS_VSTDEF(BASS_VST_ChannelFree)(DWORD vstHandle)
 {
 	// forward to BASS (BASS_VST resources freed in FREE sync callback)
@@ -1456,27 +1587,19 @@ float BASS_VSTDEF(BASS_VST_GetParam)(DWORD vstHandle, int paramIndex)
     
 BOOL BASS_VSTDEF(BASS_VST_SetParam)(DWORD vstHandle, int paramIndex, float value)
 {
-	bool leaveIdleCritical = false;
-
 	BASS_VST_PLUGIN* this_ = refHandle_checkParamIndex(vstHandle, paramIndex);
 	if( this_ == NULL )
 		RETURN_ERROR( BASS_ERROR_HANDLE );
 
-	if( this_->editorIsOpen && paramIndex < this_->numLastValues)
-	{
-		EnterCriticalSection(&s_idleCritical);
-		this_->lastValues[paramIndex] = value;
-		leaveIdleCritical = true;
-	}
-
 	enterVstCritical(this_);
+
+		// checkForChangedParam() compares under vstCritical_ too, so our own change is not reported
+		if( this_->editorIsOpen && paramIndex < this_->numLastValues)
+			this_->lastValues[paramIndex] = value;
+
 		this_->aeffect->setParameter(this_->aeffect, paramIndex, value);
-	leaveVstCritical(this_);
 
-	if( leaveIdleCritical )
-	{
-		LeaveCriticalSection(&s_idleCritical);
-	}
+	leaveVstCritical(this_);
 
 	unrefHandle(vstHandle);
 
@@ -1515,10 +1638,16 @@ char* BASS_VSTDEF(BASS_VST_GetChunk)(DWORD vstHandle, BOOL isPreset, DWORD* leng
 			}
 		}
 
+		// sandboxed plugins transfer the chunk from the child process, which may fail
+		DWORD error = isSandboxed(this_)? sandboxChunkError(this_->aeffect) : BASS_OK;
+
 	leaveVstCritical(this_);
 
 	unrefHandle(vstHandle);
 
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
 	RETURN_SUCCESS( this_->tempChunkData );
 }
 
@@ -1538,11 +1667,15 @@ DWORD BASS_VSTDEF(BASS_VST_SetChunk)(DWORD vstHandle, BOOL isPreset, const char*
 	enterVstCritical(this_);
 
 		int size = (int)this_->aeffect->dispatcher(this_->aeffect, effSetChunk, isPreset ? 1 : 0, length, (void*)chunk, 0.0f);
+		DWORD error = isSandboxed(this_)? sandboxChunkError(this_->aeffect) : BASS_OK;
 
 	leaveVstCritical(this_);
 
 	unrefHandle(vstHandle);
 
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
 	RETURN_SUCCESS( size );
 }
 
@@ -1632,7 +1765,19 @@ const char* BASS_VSTDEF(BASS_VST_GetProgramName)(DWORD vstHandle, int programInd
 	if( this_ == NULL )
 		RETURN_ERROR( BASS_ERROR_HANDLE );
 
+	if( this_->tempProgramNameBuf == NULL )
+	{
+		// allocated on the first call; another thread may do the same
+		char* buf = (char*)calloc(TEMP_PROGRAM_NAME_BYTES, 1);
+		if( buf && InterlockedCompareExchangePointer((void**)&this_->tempProgramNameBuf, buf, NULL) != NULL )
+			free(buf);
+	}
 	char* programName = this_->tempProgramNameBuf;
+	if( programName == NULL )
+	{
+		unrefHandle(vstHandle);
+		RETURN_ERROR( BASS_ERROR_MEM );
+	}
 
 	enterVstCritical(this_);
 
@@ -1849,7 +1994,7 @@ BOOL BASS_VSTDEF(BASS_VST_GetInfo)(DWORD vstHandle, BASS_VST_INFO* info)
 		info->hostVstVersion	= kVstVersion;
 		info->chansIn			= this_->aeffect->numInputs;
 		info->chansOut			= this_->aeffect->numOutputs;
-		info->initialDelay		= this_->aeffect->initialDelay;
+		info->initialDelay		= getTotalLatency(this_);
 		info->aeffect			= this_->aeffect;
 		info->isInstrument		= this_->type==VSTinstrument? 1 : 0;
 		info->dspHandle			= this_->dspHandle;
@@ -2051,11 +2196,13 @@ BOOL BASS_VSTDEF(BASS_VST_SetBypass)(DWORD vstHandle, BOOL newDoBypass)
 			{	
 				this_->doBypass = TRUE;
 				this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+				delayLineClear(&this_->bypassDelay);
 			}
 			else
 			{
 				this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
 				this_->doBypass = FALSE;
+				this_->watchdogOverruns = 0;
 			}
 		}
 
@@ -2064,6 +2211,7 @@ BOOL BASS_VSTDEF(BASS_VST_SetBypass)(DWORD vstHandle, BOOL newDoBypass)
 	unrefHandle(vstHandle);
 
 	checkForwarding();
+	updateCompensation();
 
 	RETURN_SUCCESS( true );
 }
@@ -2087,6 +2235,422 @@ BOOL BASS_VSTDEF(BASS_VST_GetBypass)(DWORD vstHandle)
 
 
 
+BOOL BASS_VSTDEF(BASS_VST_SetOption)(DWORD vstHandle, DWORD option, DWORD value)
+{
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	DWORD error = BASS_OK;
+
+	if( option == BASS_VST_OPTION_FIXEDBLOCK )
+	{
+		// this option allocates memory and resets the plugin, setFixedBlockSize() takes care of the locking;
+		// the oversampling buffers must be large enough for the fixed blocks
+		error = setFixedBlockSize(this_, (long)value);
+		if( error == BASS_OK && this_->oversampler.factor )
+			error = setOversampling(this_, this_->oversampler.factor);
+		if( error == BASS_OK && this_->resampler.pluginRate )
+			error = setPluginSampleRate(this_, this_->resampler.pluginRate);
+		if( error == BASS_OK && !updateLatency(this_) )
+			error = BASS_ERROR_MEM;
+		unrefHandle(vstHandle);
+		if( error != BASS_OK )
+			RETURN_ERROR( error );
+		RETURN_SUCCESS( true );
+	}
+
+	if( option == BASS_VST_OPTION_OVERSAMPLE )
+	{
+		// same as BASS_VST_OPTION_FIXEDBLOCK, setOversampling() takes care of the locking
+		error = setOversampling(this_, (long)value);
+		if( error == BASS_OK && !updateLatency(this_) )
+			error = BASS_ERROR_MEM;
+		unrefHandle(vstHandle);
+		if( error != BASS_OK )
+			RETURN_ERROR( error );
+		RETURN_SUCCESS( true );
+	}
+
+	if( option == BASS_VST_OPTION_SAMPLERATE )
+	{
+		// same as BASS_VST_OPTION_FIXEDBLOCK, setPluginSampleRate() takes care of the locking
+		error = setPluginSampleRate(this_, (long)value);
+		if( error == BASS_OK && !updateLatency(this_) )
+			error = BASS_ERROR_MEM;
+		unrefHandle(vstHandle);
+		if( error != BASS_OK )
+			RETURN_ERROR( error );
+		RETURN_SUCCESS( true );
+	}
+
+	if( option == BASS_VST_OPTION_BYPASSDELAY )
+	{
+		enterVstCritical(this_);
+			this_->bypassDelayOn = value? TRUE : FALSE;
+		leaveVstCritical(this_);
+		if( !updateLatency(this_) )
+			error = BASS_ERROR_MEM;
+		unrefHandle(vstHandle);
+		if( error != BASS_OK )
+			RETURN_ERROR( error );
+		RETURN_SUCCESS( true );
+	}
+
+	enterVstCritical(this_);
+
+		switch( option )
+		{
+			case BASS_VST_OPTION_WATCHDOG_BUDGET:
+				this_->watchdogBudget = value;
+				this_->watchdogOverruns = 0;
+				break;
+
+			case BASS_VST_OPTION_WATCHDOG_OVERRUNS:
+				this_->watchdogMaxOverruns = value? value : 1;
+				break;
+
+			case BASS_VST_OPTION_PREFERDOUBLE:
+				this_->preferDouble = value? true : false;
+				break;
+
+			case BASS_VST_OPTION_NOCLEAR:
+				this_->noClear = value? true : false;
+				break;
+
+			case BASS_VST_OPTION_SLEEP:
+				this_->sleepOn = value? true : false;
+				this_->sleeping = false;
+				this_->silentSamples = 0;
+				if( this_->sleepOn )
+					this_->sleepTail = (long)this_->aeffect->dispatcher(this_->aeffect, effGetTailSize, 0, 0, NULL, 0.0);
+				break;
+
+			case BASS_VST_OPTION_SLEEP_TAIL:
+				if( value > SLEEP_MAX_TAIL )
+					error = BASS_ERROR_ILLPARAM;
+				else
+					this_->sleepDefaultTail = value;
+				break;
+
+			case BASS_VST_OPTION_FLUSHDENORMALS:
+				this_->flushDenormals = value? true : false;
+				break;
+
+			case BASS_VST_OPTION_ANTIDENORMAL:
+				if( value > ANTI_DENORMAL_NOISE )
+					error = BASS_ERROR_ILLPARAM;
+				else
+					this_->antiDenormal = (BYTE)value;
+				break;
+
+			case BASS_VST_OPTION_NANGUARD:
+				if( value > NAN_GUARD_RESET )
+					error = BASS_ERROR_ILLPARAM;
+				else
+					this_->nanGuard = (BYTE)value;
+				break;
+
+			default:
+				error = BASS_ERROR_ILLPARAM;
+				break;
+		}
+
+	leaveVstCritical(this_);
+
+	unrefHandle(vstHandle);
+
+	if( error == BASS_OK )
+		RETURN_SUCCESS( true )
+	else
+		RETURN_ERROR( error )
+}
+
+
+
+DWORD BASS_VSTDEF(BASS_VST_GetOption)(DWORD vstHandle, DWORD option)
+{
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+	{
+		SET_ERROR( BASS_ERROR_HANDLE );
+		return (DWORD)-1;
+	}
+
+	DWORD value = (DWORD)-1;
+
+	enterVstCritical(this_);
+
+		switch( option )
+		{
+			case BASS_VST_OPTION_WATCHDOG_BUDGET:	value = this_->watchdogBudget;		break;
+			case BASS_VST_OPTION_WATCHDOG_OVERRUNS:	value = this_->watchdogMaxOverruns;	break;
+			case BASS_VST_OPTION_FIXEDBLOCK:		value = this_->fixedBlockSize;		break;
+			case BASS_VST_OPTION_BYPASSDELAY:		value = this_->bypassDelayOn? 1 : 0;	break;
+			case BASS_VST_OPTION_PREFERDOUBLE:		value = this_->preferDouble? 1 : 0;	break;
+			case BASS_VST_OPTION_NOCLEAR:			value = this_->noClear? 1 : 0;		break;
+			case BASS_VST_OPTION_SLEEP:				value = this_->sleepOn? 1 : 0;		break;
+			case BASS_VST_OPTION_SLEEP_TAIL:		value = this_->sleepDefaultTail;	break;
+			case BASS_VST_OPTION_FLUSHDENORMALS:	value = this_->flushDenormals? 1 : 0;	break;
+			case BASS_VST_OPTION_ANTIDENORMAL:		value = this_->antiDenormal;		break;
+			case BASS_VST_OPTION_NANGUARD:			value = this_->nanGuard;			break;
+			case BASS_VST_OPTION_OVERSAMPLE:		value = oversampleFactor(this_);	break;
+			case BASS_VST_OPTION_SAMPLERATE:		value = this_->resampler.pluginRate;	break;
+		}
+
+	leaveVstCritical(this_);
+
+	unrefHandle(vstHandle);
+
+	if( value == (DWORD)-1 )
+	{
+		SET_ERROR( BASS_ERROR_ILLPARAM );
+		return (DWORD)-1;
+	}
+
+	RETURN_SUCCESS( value );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_GetStats)(DWORD vstHandle, BASS_VST_STATS* ret)
+{
+	if( ret == NULL )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	statsGet(this_, ret);
+
+	unrefHandle(vstHandle);
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+DWORD BASS_VSTDEF(BASS_VST_EnumHandles)(DWORD* handles, DWORD maxHandles)
+{
+	DWORD count = enumHandles(handles, handles? maxHandles : 0);
+	RETURN_SUCCESS( count );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetTempoMap)(DWORD vstHandle, const BASS_VST_TEMPO* tempos, DWORD count)
+{
+	if( count && tempos == NULL )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	DWORD error = transportSetTempoMap(this_, tempos, count);
+
+	unrefHandle(vstHandle);
+
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetTransport)(DWORD vstHandle, const BASS_VST_TRANSPORT* transport)
+{
+	if( transport == NULL )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	DWORD error = transportSet(this_, transport);
+
+	unrefHandle(vstHandle);
+
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_GetTransport)(DWORD vstHandle, BASS_VST_TRANSPORT* ret)
+{
+	if( ret == NULL )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	transportGet(this_, ret);
+
+	unrefHandle(vstHandle);
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetTransportPos)(DWORD vstHandle, double seconds)
+{
+	if( !(seconds >= 0.0) )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	transportRelocate(this_, seconds);
+
+	unrefHandle(vstHandle);
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetSidechain)(DWORD vstHandle, DWORD sourceChannel, DWORD firstInputIndex)
+{
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	// sidechainSet() takes care of the locking
+	DWORD error = sidechainSet(this_, sourceChannel, (long)firstInputIndex);
+
+	unrefHandle(vstHandle);
+
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_GetLockStats)(DWORD lockClass, BASS_VST_LOCK_STATS* ret)
+{
+	if( lockClass >= BASS_VST_LOCK_CLASSES || ret == NULL )
+		RETURN_ERROR( BASS_ERROR_ILLPARAM );
+
+	lockStatsGet(lockClass, ret);
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetConfig)(DWORD option, DWORD value)
+{
+	switch( option )
+	{
+		case BASS_VST_CONFIG_LOCK_STATS:
+			if( value )
+				lockStatsReset();
+			s_lockStatsOn = value? true : false;
+			break;
+
+		case BASS_VST_CONFIG_MAXBLOCK:
+			if( value < MIN_MAX_BLOCK_SIZE || value > MAX_MAX_BLOCK_SIZE )
+				RETURN_ERROR( BASS_ERROR_ILLPARAM );
+			s_maxBlockSize = value;
+			break;
+
+		case BASS_VST_CONFIG_LARGEPAGES:
+			s_largePages = value? true : false;
+			break;
+
+		case BASS_VST_CONFIG_FORWARD_INTERVAL:
+			if( value < MIN_FORWARD_INTERVAL || value > MAX_FORWARD_INTERVAL )
+				RETURN_ERROR( BASS_ERROR_ILLPARAM );
+			s_forwardInterval = value;
+			break;
+
+		case BASS_VST_CONFIG_SLEEP_THRESHOLD:
+			if( value < MIN_SLEEP_THRESHOLD || value > MAX_SLEEP_THRESHOLD )
+				RETURN_ERROR( BASS_ERROR_ILLPARAM );
+			s_sleepThreshold = (float)pow(10.0, -(double)value/20.0);
+			s_sleepThresholdDb = value;
+			break;
+
+		default:
+			RETURN_ERROR( BASS_ERROR_ILLPARAM );
+	}
+
+	RETURN_SUCCESS( TRUE );
+}
+
+
+
+DWORD BASS_VSTDEF(BASS_VST_GetConfig)(DWORD option)
+{
+	switch( option )
+	{
+		case BASS_VST_CONFIG_LOCK_STATS:
+			RETURN_SUCCESS( s_lockStatsOn? 1 : 0 );
+
+		case BASS_VST_CONFIG_MAXBLOCK:
+			RETURN_SUCCESS( (DWORD)s_maxBlockSize );
+
+		case BASS_VST_CONFIG_LARGEPAGES:
+			RETURN_SUCCESS( s_largePages? 1 : 0 );
+
+		case BASS_VST_CONFIG_FORWARD_INTERVAL:
+			RETURN_SUCCESS( s_forwardInterval );
+
+		case BASS_VST_CONFIG_SLEEP_THRESHOLD:
+			RETURN_SUCCESS( s_sleepThresholdDb );
+	}
+
+	SET_ERROR( BASS_ERROR_ILLPARAM );
+	return (DWORD)-1;
+}
+
+
+
+DWORD BASS_VSTDEF(BASS_VST_GetChainLatency)(DWORD channelHandle)
+{
+	RETURN_SUCCESS( (DWORD)getChainLatency(channelHandle) );
+}
+
+
+
+BOOL BASS_VSTDEF(BASS_VST_SetCompensation)(DWORD channelHandle, BOOL enable)
+{
+	if( channelHandle == 0 )
+		RETURN_ERROR( BASS_ERROR_HANDLE );
+
+	DWORD error = setCompensation(channelHandle, enable);
+	if( error != BASS_OK )
+		RETURN_ERROR( error );
+
+	RETURN_SUCCESS( true );
+}
+
+
+
+DWORD BASS_VSTDEF(BASS_VST_GetCompensation)(DWORD channelHandle)
+{
+	long frames = getCompensation(channelHandle);
+	if( frames < 0 )
+	{
+		SET_ERROR( BASS_ERROR_HANDLE );
+		return (DWORD)-1;
+	}
+
+	RETURN_SUCCESS( (DWORD)frames );
+}
+
+
+
 BOOL BASS_VSTDEF(BASS_VST_SetLanguage)(const char* lang)
 {
 	char buffer[16];
@@ -2107,20 +2671,35 @@ BOOL BASS_VSTDEF(BASS_VST_SetLanguage)(const char* lang)
 
 static void queueEventRaw(BASS_VST_PLUGIN* this_, char midi0, char midi1, char midi2, const void* sysexDump, size_t sysexBytes, DWORD* error)
 {
-	// prepare
-	EnterCriticalSection(&this_->midiCritical_);
+	// the event lists are allocated by openProcess(); memory for sysex events is allocated
+	// and freed outside of midiCritical_ as the audio thread waits for it in callProcess()
+	VstMidiSysexEvent*	sysex = NULL;
+	VstEvent*			unused = NULL;
+	VstInt32			deltaFrames = 0;
+
+	if( sysexDump )
+	{
+		size_t bytesNeeded = sizeof(VstMidiSysexEvent) + sysexBytes;
+		sysex = (VstMidiSysexEvent*)malloc(bytesNeeded); 
+		if( sysex == NULL ) { *error = BASS_ERROR_MEM; return; }
+
+		memset(sysex, 0, bytesNeeded);
+		sysex->type			=	kVstSysExType;
+		sysex->byteSize		=	sizeof(VstMidiSysexEvent) - 8;
+		sysex->deltaFrames	=	deltaFrames;
+		sysex->dumpBytes	=	(VstInt32)sysexBytes;
+		sysex->sysexDump	=	((char*)sysex) + sizeof(VstMidiSysexEvent);
+		memcpy(sysex->sysexDump, sysexDump, sysexBytes);
+		unused = (VstEvent*)sysex;
+	}
+
+	lockEnter(&this_->midiCritical_, BASS_VST_LOCK_MIDI);
 		
 		VstEvent**	eSlot = NULL;
-		VstInt32 deltaFrames = 0;
 
-		// initialize MIDI structures
+		// no event lists: the plugin is not assigned to a channel, the events would never be processed
 		if( this_->midiEventsCurr == NULL )
-		{
-			size_t bytesNeeded = sizeof(VstEvents) + MAX_MIDI_EVENTS*sizeof(VstEvent*);
-			this_->midiEventsCurr = (VstEvents*)malloc(bytesNeeded);
-			if( this_->midiEventsCurr == NULL ) { *error = BASS_ERROR_MEM; goto Error; }
-			memset(this_->midiEventsCurr, 0, bytesNeeded);
-		}
+			{ *error = BASS_ERROR_NOTAVAIL; goto Error; }
 
 		// find out the slot for the event
 		if( this_->midiEventsCurr->numEvents >= MAX_MIDI_EVENTS )
@@ -2129,40 +2708,20 @@ static void queueEventRaw(BASS_VST_PLUGIN* this_, char midi0, char midi1, char m
 		eSlot = &this_->midiEventsCurr->events[this_->midiEventsCurr->numEvents];
 	
 		// set up the current event ...
-		if( sysexDump )
+		if( sysex )
 		{
-			// ... SYSEX event: allocate
-			size_t bytesNeeded = sizeof(VstMidiSysexEvent) + sysexBytes;
-			VstMidiSysexEvent* e = (VstMidiSysexEvent*)malloc(bytesNeeded); 
-			if( e == NULL ) { *error = BASS_ERROR_MEM; goto Error; }
-
-			if( *eSlot ) free(*eSlot);
-			*eSlot = (VstEvent*)e;
-
-			// ... and setup
-			memset(e, 0, bytesNeeded);
-			e->type			=	kVstSysExType;
-			e->byteSize		=	sizeof(VstMidiSysexEvent) - 8;
-			e->deltaFrames	=	deltaFrames;
-			e->dumpBytes	=	(VstInt32)sysexBytes;
-			e->sysexDump	=	((char*)e) + sizeof(VstMidiSysexEvent);
-			memcpy(e->sysexDump, sysexDump, sysexBytes);
+			// ... SYSEX event: exchange with the slot, a previous sysex event is freed below
+			unused = isPooledMidiEvent(this_->midiEventsCurr, *eSlot)? NULL : *eSlot;
+			*eSlot = (VstEvent*)sysex;
 
 			this_->midiEventsCurr->numEvents ++;
 		}
 		else
 		{
-			// ... normal MIDI event: allocate
+			// ... normal MIDI event: use the slot (either preallocated or a previous sysex event)
+			assert( sizeof(VstMidiSysexEvent) >= sizeof(VstMidiEvent) ); // this assumption makes it possible to re-use sysex events as midi events
 			VstMidiEvent* e = (VstMidiEvent*)*eSlot;
-			if( e == NULL )
-			{
-				assert( sizeof(VstMidiSysexEvent) >= sizeof(VstMidiEvent) ); // this assumption makes it possible to re-use sysex events as midi events
-				e = (VstMidiEvent*)malloc(sizeof(VstMidiEvent));
-				if( e == NULL ) { *error = BASS_ERROR_MEM; goto Error; }
-				*eSlot = (VstEvent*)e;
-			}
 
-			// ... and setup
 			memset(e, 0, sizeof(VstMidiEvent));
 			e->type			=	kVstMidiType;
 			e->byteSize		=	sizeof(VstMidiEvent) - 8; // = 24
@@ -2178,6 +2737,9 @@ static void queueEventRaw(BASS_VST_PLUGIN* this_, char midi0, char midi1, char m
 	// unprepare
 Error:
 	LeaveCriticalSection(&this_->midiCritical_);
+
+	if( unused )
+		free(unused);
 }
 
 
@@ -36,6 +36,11 @@
 #define EnterCriticalSection			pthread_mutex_lock
 #define LeaveCriticalSection			pthread_mutex_unlock
 #define DeleteCriticalSection			pthread_mutex_destroy	
+#define InterlockedCompareExchange(a, exchange, comperand) __sync_val_compare_and_swap(a, comperand, exchange)
+#define InterlockedExchange				__sync_lock_test_and_set
+#define InterlockedExchangeAdd			__sync_fetch_and_add
+#define InterlockedCompareExchangePointer(a, exchange, comperand) __sync_val_compare_and_swap(a, comperand, exchange)
+#define THREAD_LOCAL					__thread
 typedef CFBundleRef HINSTANCE;
 #elif __linux__
 #include <dlfcn.h>
@@ -46,10 +51,16 @@ typedef CFBundleRef HINSTANCE;
 #define EnterCriticalSection			pthread_mutex_lock
 #define LeaveCriticalSection			pthread_mutex_unlock
 #define DeleteCriticalSection			pthread_mutex_destroy
+#define InterlockedCompareExchange(a, exchange, comperand) __sync_val_compare_and_swap(a, comperand, exchange)
+#define InterlockedExchange				__sync_lock_test_and_set
+#define InterlockedExchangeAdd			__sync_fetch_and_add
+#define InterlockedCompareExchangePointer(a, exchange, comperand) __sync_val_compare_and_swap(a, comperand, exchange)
+#define THREAD_LOCAL					__thread
 typedef void* HINSTANCE;
 #else
 #include <windows.h>
 #include <crtdbg.h>
+#define THREAD_LOCAL					__declspec(thread)
 #endif
 
 #include <assert.h>
@@ -101,6 +112,192 @@ typedef void* HINSTANCE;
 #define USERPTR DWORD
 #endif
 
+// type of the plugin's main entry function
+typedef AEffect *(*dllMainEntryFuncType) (audioMasterCallback);
+
+
+
+/*****************************************************************************
+ *  Statistics
+ *****************************************************************************/
+
+// written by the audio thread only, read without locking, see bass_vst_stats.cpp
+#define STATS_TIME_BUCKETS 128 // 4 buckets per octave of nanoseconds
+
+typedef struct
+{
+	DWORD				blocks;
+	QWORD				samples;
+	QWORD				totalNs;
+	DWORD				lastNs;
+	DWORD				maxNs;
+	DWORD				timeHistogram[STATS_TIME_BUCKETS];
+	DWORD				blockSizes[BASS_VST_STATS_BLOCKSIZES];
+	QWORD				vstLockWaitNs;
+	DWORD				sleeps;
+	QWORD				sleepSamples;
+	DWORD				nonFiniteBlocks;
+} PROCESS_STATS;
+
+
+
+/*****************************************************************************
+ *  Buffer arenas, see bass_vst_process.cpp
+ *****************************************************************************/
+
+typedef struct
+{
+	BYTE*				mem;				// 64-byte aligned
+	size_t				bytes;
+	bool				largePages;			// allocated by VirtualAlloc(MEM_LARGE_PAGES)
+} BUFFER_ARENA;
+
+// we allcate silently the double number of bytes to be prepared for double processing ...
+#define					BUFFER_HEADROOM_MULT 2
+
+size_t					arenaStride(size_t bytes); // the distance of two channels in an arena
+bool					arenaAlloc(BUFFER_ARENA*, size_t bytes);
+void					arenaFree(BUFFER_ARENA*);
+
+
+
+/*****************************************************************************
+ *  Editor forwarding, see bass_vst_forward.cpp
+ *****************************************************************************/
+
+typedef struct FORWARD_RING FORWARD_RING;
+
+
+
+/*****************************************************************************
+ *  Sidechain inputs, see bass_vst_sidechain.cpp
+ *****************************************************************************/
+
+typedef struct SIDECHAIN SIDECHAIN;
+
+
+
+/*****************************************************************************
+ *  Output streams of instruments, see bass_vst_outputs.cpp
+ *****************************************************************************/
+
+typedef struct OUTPUT_SPLIT OUTPUT_SPLIT;
+
+// the events of rendered blocks, reported to the callback outside of the critical section
+typedef struct
+{
+	bool				watchdogBypassed;
+	QWORD				processNs;
+	QWORD				blockNs;
+	bool				nonFinite;
+	bool				nanReset;
+} PROCESS_EVENTS;
+
+
+
+/*****************************************************************************
+ *  Delay lines, see bass_vst_latency.cpp
+ *****************************************************************************/
+
+typedef struct
+{
+	BYTE*				buffer;
+	long				frameBytes;			// bytes per sample incl. all channels
+	long				frames;				// the delay in samples
+	long				pos;
+} DELAY_LINE;
+
+
+/*****************************************************************************
+ *  Oversampling, see bass_vst_oversample.cpp
+ *****************************************************************************/
+
+#define					OVERSAMPLE_MAX_STAGES 3
+
+typedef struct
+{
+	long				factor;				// 2, 4 or 8; 0=off
+	long				numStages;
+	long				numInputs;			// the number of buffers in in/out, same as numActiveInputs/Outputs
+	long				numOutputs;
+	long				blockSize;			// the max. number of samples at the channel's rate
+	double				latency;			// in samples at the channel's rate
+	float**				in;					// MAX_CHANS pointers each, the plugin's buffers at the higher rate
+	float**				out;
+	float*				work[3];			// for one stage and channel
+	float*				upHistory;			// the filter states per channel and stage
+	float*				downHistory;
+	BUFFER_ARENA		arena;
+} OVERSAMPLER;
+
+
+
+/*****************************************************************************
+ *  Plugin sample rate, see bass_vst_resample.cpp
+ *****************************************************************************/
+
+typedef struct
+{
+	long				numTaps;			// a multiple of 4
+	double				step;				// input samples per output sample
+	float*				table;				// RESAMPLE_PHASES+1 rows of numTaps coefficients
+} RESAMPLE_FILTER;
+
+typedef struct
+{
+	long				pluginRate;			// 0=off
+	long				channelRate;
+	double				ratio;				// pluginRate/channelRate
+	long				numInputs;			// the number of buffers in in/out, same as numActiveInputs/Outputs
+	long				numOutputs;
+	long				blockSize;			// the max. number of samples at the channel's rate
+	long				pluginBlockSize;	// the max. number of samples at the plugin's rate
+	long				latency;			// in samples at the channel's rate
+	long				histCapacity;		// per channel
+	RESAMPLE_FILTER		toPlugin;
+	RESAMPLE_FILTER		fromPlugin;
+	double				inPos;				// the position of the next output in the history, in input samples
+	double				outPos;
+	long				inHistLen;
+	long				outHistLen;
+	float*				inHistory;			// histCapacity samples per channel
+	float*				outHistory;
+	float*				work;
+	float**				in;					// MAX_CHANS pointers each, the plugin's buffers at its rate
+	float**				out;
+	BUFFER_ARENA		arena;
+} RESAMPLER;
+
+
+
+/*****************************************************************************
+ *  Transport, see bass_vst_transport.cpp
+ *****************************************************************************/
+
+typedef struct
+{
+	double				ppqPos;
+	double				seconds;			// the start of the entry, calculated from the entries before
+	double				tempo;
+	long				timeSigNumerator;
+	long				timeSigDenominator;
+} TEMPO_ENTRY;
+
+typedef struct
+{
+	bool				playing;
+	bool				cycleActive;
+	bool				changed;			// kVstTransportChanged is reported with the next block
+	double				cycleStart;			// in quarter notes
+	double				cycleEnd;
+	TEMPO_ENTRY*		tempoMap;			// NULL for 120 BPM, 4/4
+	long				tempoCount;
+	long				tempoCursor;		// the entry used for the last block
+	double				samplePos;			// the start of the next block
+	volatile long		relocatePending;	// relocateSeconds is to be applied with the next block
+	double				relocateSeconds;
+} TRANSPORT;
+
 
 /*****************************************************************************
  *  Plugins
@@ -108,6 +305,10 @@ typedef void* HINSTANCE;
 
 typedef struct
 {
+	/* hot stuff: everything used by the audio thread for each block is placed at the
+	 * start of the structure, so a block touches only a few cache lines; bigger
+	 * arrays are allocated on demand.  The control stuff follows below. */
+
 	// are we an effect or an instrument?
 	DWORD				type;
 	#define				VSTeffect		0
@@ -124,52 +325,98 @@ typedef struct
 	// unchanneled effect and for VST instruments.
 	HDSP				dspHandle;
 
-	// the underlying DLL
-	DWORD				createFlags;
-	HINSTANCE			hinst;
-
 	// the underlying VST object
 	AEffect*			aeffect;
 	#define				canDoubleReplacing(a) ( ((a)->aeffect->flags&effFlagsCanDoubleReplacing)!=0 && (a)->aeffect->processDoubleReplacing!=NULL )
+	#define				canFloatProcessing(a) ( (a)->aeffect->processReplacing!=NULL || (a)->aeffect->__processDeprecated!=NULL )
+	#define				useDoubleReplacing(a) ( canDoubleReplacing(a) && ((a)->preferDouble || !canFloatProcessing(a)) )
 
-	// handing parameters and programs
-	int 				numDefaultValues;  // we cache this value as some plugins change aeffect->numParams :-(
-	float*				defaultValues;     // only set at loading time caching the initial param values
-	int 				numLastValues;
-	float*				lastValues;
-	float*				tempProgramValueBuf;
-	char				tempProgramNameBuf[128]; // normally kVstMaxProgNameLen+1 (=24+1) should be enough, be a little safer
-	char*				tempChunkData;
+	// do not use directly! always use the BASS_VST_LOCKER!
+	long				handleUsage;
 
-	// process handling
-	#define				MAX_CHANS 32
-	float*				buffersIn[MAX_CHANS];
-	float*				buffersOut[MAX_CHANS];
-	long				bytesPerInOutBuffer;
+	// bypass handling
+	BOOL				doBypass;
 
-	float*				bufferTemp;
-	long				bytesTempBuffer;
+	// see BASS_VST_OPTION_PREFERDOUBLE and BASS_VST_OPTION_NOCLEAR
+	bool				preferDouble;
+	bool				noClear;
 
 	bool				effOpenCalled;
 	bool				effStartProcessCalled;
 
 	long				effBlockSize;
-	
-	// bypass handling
-	BOOL				doBypass;
+	long				maxBlockSize;		// the buffers are allocated for this number of samples, see BASS_VST_CONFIG_MAXBLOCK
 
-	// idle stuff
-	#define				NEEDS_EDIT_IDLE			0x01
-	#define				NEEDS_IDLE_OUTSIDE_EDIT 0x02
-	int					needsIdle;
+	// process handling - buffersIn, buffersOut (MAX_CHANS pointers each, NULL if no
+	// channel is assigned) and bufferTemp point into bufferArena
+	#define				MAX_CHANS 32
+	float**				buffersIn;
+	float**				buffersOut;
+	long				bytesPerInOutBuffer;
+	long				numActiveInputs;	// the channels used, max. of the plugin's and the channel's
+	long				numActiveOutputs;
 
-	// editor stuff
-	bool				editorIsOpen;
-	DWORD				editorScope;
+	float*				bufferTemp;
+	long				bytesTempBuffer;
 
-	// callbacks
-	VSTPROC*			callback;
-	void*				callbackUserData;
+	BUFFER_ARENA		bufferArena;
+
+	// fixed block size adapter, see BASS_VST_OPTION_FIXEDBLOCK; 0=off
+	long				fixedBlockSize;
+	long				fixedBlockPos;
+	float**				fixedIn;			// point into fixedArena as buffersIn/buffersOut
+	float**				fixedOut;
+	BUFFER_ARENA		fixedArena;
+
+	// delay line used while bypassed, see BASS_VST_OPTION_BYPASSDELAY
+	DELAY_LINE			bypassDelay;
+
+	// see BASS_VST_OPTION_OVERSAMPLE
+	OVERSAMPLER			oversampler;
+	#define				oversampleFactor(a) ( (a)->oversampler.factor? (a)->oversampler.factor : 1 )
+
+	// see BASS_VST_OPTION_SAMPLERATE; cannot be combined with the oversampling
+	RESAMPLER			resampler;
+	#define				pluginRateRatio(a) ( (a)->oversampler.factor? (double)(a)->oversampler.factor : ((a)->resampler.pluginRate? (a)->resampler.ratio : 1.0) )
+
+	// watchdog, see BASS_VST_OPTION_WATCHDOG_*
+	DWORD				watchdogBudget;			// max. processing time in percent of the block duration, 0=off
+	DWORD				watchdogMaxOverruns;
+	DWORD				watchdogOverruns;		// subsequent overruns so far
+	#define				WATCHDOG_DEFAULT_OVERRUNS 8
+
+	// denormal protection, see BASS_VST_OPTION_FLUSHDENORMALS and BASS_VST_OPTION_ANTIDENORMAL
+	bool				flushDenormals;
+	BYTE				antiDenormal;
+	#define				ANTI_DENORMAL_DC	1
+	#define				ANTI_DENORMAL_NOISE	2
+	DWORD				antiDenormalSeed;
+
+	// see BASS_VST_OPTION_NANGUARD
+	BYTE				nanGuard;
+	#define				NAN_GUARD_SILENCE	1
+	#define				NAN_GUARD_RESET		2
+
+	// sleep mode, see BASS_VST_OPTION_SLEEP and checkSleep()
+	bool				sleepOn;
+	bool				sleeping;
+	long				sleepTail;				// as returned by effGetTailSize, 0=unknown, 1=no tail
+	DWORD				sleepDefaultTail;		// in ms, used if the plugin does not report its tail
+	QWORD				silentSamples;			// input (output for instruments) samples below the threshold in a row
+	DWORD				heldNoteBits[16][4];	// the keys down per MIDI channel, only tracked for instruments
+	long				heldNotes;				// the instrument does not sleep while keys are down
+	#define				SLEEP_DEFAULT_TAIL 2000
+	#define				SLEEP_MAX_TAIL 60000
+
+	// our input is copied here if editors of the same scope get our data, see bass_vst_forward.cpp
+	FORWARD_RING*		forwardRing;
+
+	// the inputs fed by another channel, see BASS_VST_SetSidechain(); the ring is written
+	// by a DSP on the source channel without locking
+	SIDECHAIN*			sidechain;
+
+	// instruments only: the outputs rendered once for several streams, see BASS_VST_ChannelCreateOutput()
+	OUTPUT_SPLIT*		outputSplit;
 
 	// pending MIDI events, they're sended just before processReplacing is called
 	#define				MAX_MIDI_EVENTS 2048
@@ -177,23 +424,62 @@ typedef struct
 	VstEvents*			midiEventsPrev;
 	CRITICAL_SECTION	midiCritical_;
 
-	
-	// static vstTimeInfo structre, "static" as the pointer may be needed "a little bit longer"
-	VstTimeInfo			vstTimeInfo;
+	CRITICAL_SECTION	vstCritical_;
 
-	// misc
-	#define				MAX_FWD 128
-	DWORD				forwardDataToOtherVstHandles[MAX_FWD];
-	int					forwardDataToOtherCnt;
+	// the time info returned by audioMasterGetTime, calculated once per block from the
+	// transport; the audio thread writes the other snapshot than the one published in
+	// vstTimeInfoIndex, so a returned pointer stays valid for the next block, too
+	VstTimeInfo			vstTimeInfo[2];
+	volatile long		vstTimeInfoIndex;
+	TRANSPORT			transport;
 
-	CRITICAL_SECTION	vstCritical_;
+	// processing statistics, see BASS_VST_GetStats(); only a few fields and one histogram
+	// bucket are written per block
+	PROCESS_STATS		stats;
 
-	// do not use directly! always use the BASS_VST_LOCKER!
-	long				handleUsage;
+	/* cold stuff: control */
+
+	// the underlying DLL; for sandboxed plugins, hinst is NULL and aeffect is a proxy (see bass_vst_sandbox.cpp)
+	DWORD				createFlags;
+	HINSTANCE			hinst;
+	#define				isSandboxed(a) ( ((a)->createFlags&BASS_VST_SANDBOX)!=0 )
 
 	// pluginID for shell plugin
 	long				pluginID;
 
+	BOOL				bypassDelayOn;
+
+	// handing parameters and programs
+	int 				numDefaultValues;  // we cache this value as some plugins change aeffect->numParams :-(
+	float*				defaultValues;     // only set at loading time caching the initial param values
+	int 				numLastValues;
+	float*				lastValues;
+	float*				tempProgramValueBuf;
+	char*				tempProgramNameBuf; // allocated on demand, TEMP_PROGRAM_NAME_BYTES
+	#define				TEMP_PROGRAM_NAME_BYTES 128 // normally kVstMaxProgNameLen+1 (=24+1) should be enough, be a little safer
+	char*				tempChunkData;
+
+	// idle stuff
+	#define				NEEDS_EDIT_IDLE			0x01
+	#define				NEEDS_IDLE_OUTSIDE_EDIT 0x02
+	#define				NEEDS_LATENCY_UPDATE	0x04	// the plugin sent audioMasterIOChanged
+	#define				NEEDS_PARAM_UPDATE		0x08	// a sandboxed plugin sent audioMasterUpdateDisplay
+	int					needsIdle;
+
+	// editor stuff
+	bool				editorIsOpen;
+	DWORD				editorScope;
+
+	// editors of the same scope getting our data, see checkForwarding(); MAX_FWD handles
+	// allocated on demand, used by the forwarding thread
+	#define				MAX_FWD 128
+	DWORD*				forwardDataToOtherVstHandles;
+	int					forwardDataToOtherCnt;
+
+	// callbacks
+	VSTPROC*			callback;
+	void*				callbackUserData;
+
 	//// vst plugin path
 	//char pluginPath[2048];
 } BASS_VST_PLUGIN;
@@ -207,6 +493,8 @@ void				exitHandleHandling();
 BASS_VST_PLUGIN*	createHandle(DWORD type, DWORD handle); // initalized the reference counting to 1; if handle is 0, a new handle is created
 BASS_VST_PLUGIN*	refHandle(DWORD handle);
 BOOL				unrefHandle(DWORD handle);	// if a handle has no more references, it is destroyed!
+DWORD				enumHandles(DWORD* handles, DWORD maxHandles); // returns the number of all handles, copies up to maxHandles
+long				getChainLatency(DWORD channelHandle); // sum of the latencies of all plugins assigned to the channel
 
 BOOL				tryEnterVstCritical(BASS_VST_PLUGIN*);
 void				enterVstCritical(BASS_VST_PLUGIN*);
@@ -222,32 +510,138 @@ void					updateIdleTimers(BASS_VST_PLUGIN*); // call this if needsIdle has chang
 void					createIdleTimers();
 void					killIdleTimers();
 
+QWORD					getTimeNs(); // monotonic, high resolution
+
 #define					IDLE_FREQ 50 /*ms = 20Hz*/
 #define					IDLE_UNLOAD_PENDING_COUNTDOWN (10000/*10 seconds*/ / IDLE_FREQ)
+#define					IDLE_BATCH 64 /*plugins served per lock of s_idleCritical*/
 
 
 
 // buffers
-void					freeChansBuffers(BASS_VST_PLUGIN*);
-void					freeTempBuffer(BASS_VST_PLUGIN*);
+void					freeProcessBuffers(BASS_VST_PLUGIN*);
+void					freeMidiEvents(BASS_VST_PLUGIN*);
+bool					isPooledMidiEvent(VstEvents*, VstEvent*);
+
+extern long				s_maxBlockSize;
+#define					DEFAULT_MAX_BLOCK_SIZE 8192
+#define					MIN_MAX_BLOCK_SIZE 16
+#define					MAX_MAX_BLOCK_SIZE 1048576
+extern bool				s_largePages; // see BASS_VST_CONFIG_LARGEPAGES
+extern DWORD			s_sleepThresholdDb; // see BASS_VST_CONFIG_SLEEP_THRESHOLD
+extern float			s_sleepThreshold; // the same as a linear amplitude
+#define					DEFAULT_SLEEP_THRESHOLD 96
+#define					MIN_SLEEP_THRESHOLD 20
+#define					MAX_SLEEP_THRESHOLD 200
 
 bool					openProcess(BASS_VST_PLUGIN*, BASS_VST_PLUGIN* info_);
+DWORD					setFixedBlockSize(BASS_VST_PLUGIN*, long blockSize); // returns a BASS error code
+void					freeFixedBlockBuffers(BASS_VST_PLUGIN*);
+long					getTotalLatency(BASS_VST_PLUGIN*); // in samples, incl. the latency added by BASS_VST
+long					getPluginBlockSize(BASS_VST_PLUGIN*, long blockSize); // the max. block size at the plugin's rate
 bool					closeProcess(BASS_VST_PLUGIN*);
+void					callProcess(BASS_VST_PLUGIN*, float** buffersIn, float** buffersOut, long numSamples, bool isDouble, bool forwarding);
 void CALLBACK			doEffectProcess(HDSP handle, DWORD channel, void* buffer, DWORD length, USERPTR user);
 DWORD CALLBACK			doInstrumentProcess(HSTREAM vstHandle, void* buffer, DWORD length, USERPTR user);
+void					processOutputs(BASS_VST_PLUGIN*, long numSamples, DWORD freq, PROCESS_EVENTS* events); // by outputsProcess() only
 
 int						validateLastValues(BASS_VST_PLUGIN*);
 
 
-// forwarding
+// forwarding, the audio thread never takes s_forwardCritical
 void					checkForwarding();
 extern CRITICAL_SECTION	s_forwardCritical;
+void					initForwarding();
+void					exitForwarding();
+bool					forwardPrepare(BASS_VST_PLUGIN* source); // by checkForwarding() only
+void					forwardRemove(BASS_VST_PLUGIN* source); // by checkForwarding() only
+void					forwardFree(BASS_VST_PLUGIN* source);
+void					forwardWrite(BASS_VST_PLUGIN*, long numSamples, bool isDouble); // by the audio thread
+void					forwardUpdateThread(); // by checkForwarding() only
+
+extern DWORD			s_forwardInterval; // see BASS_VST_CONFIG_FORWARD_INTERVAL
+#define					DEFAULT_FORWARD_INTERVAL 50 /*ms*/
+#define					MIN_FORWARD_INTERVAL 10
+#define					MAX_FORWARD_INTERVAL 1000
 
 // misc
 void					callMainsChanged(BASS_VST_PLUGIN* this_, long blockSize);
 long					fileSelOpen(BASS_VST_PLUGIN* this_, VstFileSelect* vstFs);
 void					fileSelClose(BASS_VST_PLUGIN* this_, VstFileSelect* vstFs);
 
+// sandboxed plugins
+AEffect*				sandboxOpen(const void* dllFile, long pluginID, audioMasterCallback hostCallback, DWORD* error);
+void					sandboxClose(AEffect*);
+DWORD					sandboxChunkError(AEffect*); // BASS error code of the last effGetChunk or effSetChunk
+
+// delay compensation, see bass_vst_latency.cpp
+void					initLatencyHandling();
+void					exitLatencyHandling();
+void					delayLineFree(DELAY_LINE*);
+void					delayLineClear(DELAY_LINE*);
+void					delayLineProcess(DELAY_LINE*, void* data, DWORD bytes);
+bool					updateLatency(BASS_VST_PLUGIN*); // call this if the latency of a plugin or a chain has changed
+void					updateCompensation();
+DWORD					setCompensation(DWORD channelHandle, BOOL enable); // returns a BASS error code
+long					getCompensation(DWORD channelHandle); // -1 if not registered
+
+// oversampling, see bass_vst_oversample.cpp
+DWORD					setOversampling(BASS_VST_PLUGIN*, long factor); // returns a BASS error code
+void					freeOversampling(BASS_VST_PLUGIN*);
+void					oversampleProcess(BASS_VST_PLUGIN*, float** buffersIn, float** buffersOut, long numSamples); // float buffers only
+
+// plugin sample rate, see bass_vst_resample.cpp
+DWORD					setPluginSampleRate(BASS_VST_PLUGIN*, long pluginRate); // returns a BASS error code
+void					freeResampling(BASS_VST_PLUGIN*);
+void					resampleProcess(BASS_VST_PLUGIN*, float** buffersIn, float** buffersOut, long numSamples); // float buffers only
+
+// sidechain inputs, see bass_vst_sidechain.cpp
+DWORD					sidechainSet(BASS_VST_PLUGIN*, DWORD sourceChannel, long firstInput); // returns a BASS error code
+void					sidechainFree(BASS_VST_PLUGIN*);
+void					sidechainRead(BASS_VST_PLUGIN*, long numSamples, bool isDouble); // by the audio thread, before processing
+void					sidechainRelease(BASS_VST_PLUGIN*); // by the audio thread, after processing
+void					sidechainSkip(BASS_VST_PLUGIN*, long numSamples); // by the audio thread, if not processing
+
+// output streams of instruments, see bass_vst_outputs.cpp
+HSTREAM					outputsCreate(BASS_VST_PLUGIN*, long firstOutput, long numChans, DWORD flags, DWORD* error); // error=BASS_OK if set by BASS
+bool					outputsProcess(DWORD vstHandle, HSTREAM stream, void* buffer, DWORD length); // false if the outputs are not split
+void					outputsFree(BASS_VST_PLUGIN*);
+
+// transport, see bass_vst_transport.cpp
+void					transportInit(BASS_VST_PLUGIN*);
+void					transportFree(BASS_VST_PLUGIN*);
+void					transportUpdate(BASS_VST_PLUGIN*, double sampleRate); // by the audio thread, before each block
+void					transportAdvance(BASS_VST_PLUGIN*, long numSamples); // by the audio thread, after each block, numSamples at the channel's rate
+#define					transportTimeInfo(this_) (&(this_)->vstTimeInfo[(this_)->vstTimeInfoIndex]) // the current snapshot
+DWORD					transportSetTempoMap(BASS_VST_PLUGIN*, const BASS_VST_TEMPO* tempos, DWORD count); // returns a BASS error code
+DWORD					transportSet(BASS_VST_PLUGIN*, const BASS_VST_TRANSPORT*); // returns a BASS error code
+void					transportGet(BASS_VST_PLUGIN*, BASS_VST_TRANSPORT* ret);
+void					transportRelocate(BASS_VST_PLUGIN*, double seconds); // from any thread
+
+// statistics, see bass_vst_stats.cpp
+void					statsAddBlock(BASS_VST_PLUGIN*, long numSamples, QWORD processNs);
+void					statsGet(BASS_VST_PLUGIN*, BASS_VST_STATS* ret);
+
+extern volatile bool	s_lockStatsOn;
+void					lockEnter(CRITICAL_SECTION*, int lockClass); // EnterCriticalSection() for the locks of BASS_VST_LOCK_*
+void					lockTried(int lockClass, BOOL success);
+void					lockStatsReset();
+void					lockStatsGet(int lockClass, BASS_VST_LOCK_STATS* ret);
+void					lockStatsInit();
+void					lockStatsExit(); // dumps the statistics if requested by the environment
+
+// real-time safety check: if compiled with BASS_VST_ALLOC_CHECK, memory allocations on a
+// thread between allocCheckEnter() and allocCheckLeave() are reported, see bass_vst_alloccheck.cpp
+#ifdef BASS_VST_ALLOC_CHECK
+void					allocCheckInit();
+void					allocCheckEnter();
+void					allocCheckLeave();
+#else
+#define					allocCheckInit()
+#define					allocCheckEnter()
+#define					allocCheckLeave()
+#endif
+
 // Effect bank files.
 int					EffGetChunk(BASS_VST_PLUGIN* this_, void **ptr, bool isPreset = false);
 int					EffSetChunk(BASS_VST_PLUGIN* this_, void *data, long byteSize, bool isPreset = false);
@@ -0,0 +1,431 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_latency.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Plugin delay compensation
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the latency of a chain is the sum of the latencies of all plugins
+ *	assigned to a channel (see getTotalLatency()).  A bypassed plugin does
+ *	not add any latency - unless BASS_VST_OPTION_BYPASSDELAY is set; in this
+ *	case, the signal is delayed by a simple delay line while the plugin is
+ *	bypassed, so switching the bypass does not move the signal in time.
+ *
+ *	Channels registered by BASS_VST_SetCompensation() get an additional DSP
+ *	with the lowest priority that delays the channel by the difference
+ *	between its chain latency and the largest chain latency of all
+ *	registered channels - so all registered channels stay aligned.
+ *
+ *	The delay lines work on the raw channel data, so they do not care about
+ *	the sample format.  They are allocated when the latencies change, never
+ *	by the audio thread.  Changes reported by the plugins via
+ *	audioMasterIOChanged and automatic bypasses are handled in the idle
+ *	routine as they happen while processing.
+ *
+ *	The compensation DSP gets its COMPENSATION entry as the user data and
+ *	only takes the entry's own delayCritical_, so the channels do not wait
+ *	for each other nor for s_compensationCritical.  An entry is freed only
+ *	after its DSP is removed or its channel is freed.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+
+
+/*****************************************************************************
+ *  delay lines
+ *****************************************************************************/
+
+
+
+static bool delayLineCreate(DELAY_LINE* d, long frameBytes, long frames)
+{
+	memset(d, 0, sizeof(DELAY_LINE));
+	if( frameBytes <= 0 || frames <= 0 )
+		return true; // no delay needed
+
+	if( (d->buffer = (BYTE*)calloc(frames, frameBytes)) == NULL )
+		return false;
+
+	d->frameBytes = frameBytes;
+	d->frames = frames;
+	return true;
+}
+
+
+
+void delayLineFree(DELAY_LINE* d)
+{
+	if( d->buffer )
+		free(d->buffer);
+	memset(d, 0, sizeof(DELAY_LINE));
+}
+
+
+
+void delayLineClear(DELAY_LINE* d)
+{
+	if( d->buffer )
+		memset(d->buffer, 0, d->frames * d->frameBytes);
+	d->pos = 0;
+}
+
+
+
+void delayLineProcess(DELAY_LINE* d, void* data, DWORD bytes)
+{
+	// the ring buffer holds the last d->frames frames; swapping them with the
+	// given data outputs the old frames and remembers the new ones
+	BYTE  temp[1024];
+	BYTE* p = (BYTE*)data;
+	long  frames, todo, todoBytes, n;
+
+	if( d->buffer == NULL )
+		return;
+
+	frames = bytes / d->frameBytes;
+	while( frames > 0 )
+	{
+		todo = d->frames - d->pos;
+		if( todo > frames )
+			todo = frames;
+
+		BYTE* r = d->buffer + d->pos * d->frameBytes;
+		todoBytes = todo * d->frameBytes;
+		while( todoBytes > 0 )
+		{
+			n = todoBytes < (long)sizeof(temp)? todoBytes : (long)sizeof(temp);
+			memcpy(temp, r, n);
+			memcpy(r, p, n);
+			memcpy(p, temp, n);
+			r += n;
+			p += n;
+			todoBytes -= n;
+		}
+
+		frames -= todo;
+		d->pos += todo;
+		if( d->pos == d->frames )
+			d->pos = 0;
+	}
+}
+
+
+
+static long getFrameBytes(DWORD channelHandle, bool isDsp)
+{
+	// the size of one sample of all channels as given to a DSP or to a STREAMPROC
+	BASS_CHANNELINFO channelInfo;
+	if( !BASS_ChannelGetInfo(channelHandle, &channelInfo) || channelInfo.chans <= 0 )
+		return 0;
+
+	long bytesPerSample = 2;
+	if( (channelInfo.flags&BASS_SAMPLE_FLOAT) || (isDsp && BASS_GetConfig(BASS_CONFIG_FLOATDSP)) )
+		bytesPerSample = sizeof(float);
+	else if( channelInfo.flags&BASS_SAMPLE_8BITS )
+		bytesPerSample = 1;
+
+	return bytesPerSample * channelInfo.chans;
+}
+
+
+
+/*****************************************************************************
+ *  bypass delay
+ *****************************************************************************/
+
+
+
+static bool updateBypassDelay(BASS_VST_PLUGIN* this_)
+{
+	DELAY_LINE newDelay, oldDelay;
+	long frames = 0, frameBytes = 0;
+	bool on;
+
+	enterVstCritical(this_);
+		on = this_->bypassDelayOn && this_->channelHandle;
+		if( on )
+			frames = getTotalLatency(this_);
+	leaveVstCritical(this_);
+
+	if( on )
+		frameBytes = getFrameBytes(this_->channelHandle, this_->type==VSTeffect);
+
+	if( frames == this_->bypassDelay.frames && frameBytes == this_->bypassDelay.frameBytes )
+		return true; // nothing changed
+
+	if( !delayLineCreate(&newDelay, frameBytes, frames) )
+		return false;
+
+	enterVstCritical(this_);
+		oldDelay = this_->bypassDelay;
+		this_->bypassDelay = newDelay;
+	leaveVstCritical(this_);
+
+	delayLineFree(&oldDelay);
+	return true;
+}
+
+
+
+/*****************************************************************************
+ *  compensation across channels
+ *****************************************************************************/
+
+
+
+typedef struct
+{
+	DWORD				channelHandle;
+	HDSP				dspHandle;
+	HSYNC				syncHandle;
+	CRITICAL_SECTION	delayCritical_;	// excludes the DSP while the delay line is exchanged
+	DELAY_LINE			delay;
+} COMPENSATION;
+
+#define					COMPENSATION_DSP_PRIORITY (-0x7FFFFFFF) // run after all other DSPs
+
+static CRITICAL_SECTION	s_compensationCritical;
+static sjhash			s_compensationHash; // channelHandle -> COMPENSATION*
+
+
+
+static void freeCompensation(COMPENSATION* c)
+{
+	// the DSP must be removed or the channel freed before
+	delayLineFree(&c->delay);
+	DeleteCriticalSection(&c->delayCritical_);
+	free(c);
+}
+
+
+
+void initLatencyHandling()
+{
+	InitializeCriticalSection(&s_compensationCritical);
+	sjhashInit(&s_compensationHash, SJHASH_INT, /*keytype*/ 0/*copyKey*/);
+}
+
+
+
+void exitLatencyHandling()
+{
+	// the channels are already freed by BASS at this moment
+	sjhashElem* elem = sjhashFirst(&s_compensationHash);
+	while( elem )
+	{
+		freeCompensation((COMPENSATION*)sjhashData(elem));
+		elem = sjhashNext(elem);
+	}
+	sjhashClear(&s_compensationHash);
+	DeleteCriticalSection(&s_compensationCritical);
+}
+
+
+
+static void CALLBACK doCompensation(HDSP /*dspHandle*/, DWORD /*channelHandle*/, void* buffer, DWORD length, USERPTR user)
+{
+	COMPENSATION* c = (COMPENSATION*)user;
+	allocCheckEnter();
+	lockEnter(&c->delayCritical_, BASS_VST_LOCK_COMPENSATION);
+		delayLineProcess(&c->delay, buffer, length);
+	LeaveCriticalSection(&c->delayCritical_);
+	allocCheckLeave();
+}
+
+
+
+void updateCompensation()
+{
+	// BASS functions are not called while holding s_compensationCritical as the
+	// DSP may wait for a delayCritical_ taken under it while BASS holds a lock
+	// on the channel
+	DWORD*	channels = NULL;
+	double*	seconds = NULL;
+	long*	frameBytes = NULL;
+	DWORD*	freqs = NULL;
+	double	maxSeconds = 0.0;
+	int		i, count = 0;
+
+	EnterCriticalSection(&s_compensationCritical);
+		if( sjhashCount(&s_compensationHash) > 0 )
+		{
+			channels = (DWORD*)malloc(sjhashCount(&s_compensationHash) * sizeof(DWORD));
+			if( channels )
+			{
+				sjhashElem* elem = sjhashFirst(&s_compensationHash);
+				while( elem )
+				{
+					channels[count++] = ((COMPENSATION*)sjhashData(elem))->channelHandle;
+					elem = sjhashNext(elem);
+				}
+			}
+		}
+	LeaveCriticalSection(&s_compensationCritical);
+
+	if( count == 0 )
+		goto Cleanup;
+
+	seconds = (double*)malloc(count * sizeof(double));
+	frameBytes = (long*)malloc(count * sizeof(long));
+	freqs = (DWORD*)malloc(count * sizeof(DWORD));
+	if( seconds == NULL || frameBytes == NULL || freqs == NULL )
+		goto Cleanup;
+
+	// get the chain latencies in seconds as the channels may use different sample rates
+	for( i = 0; i < count; i++ )
+	{
+		BASS_CHANNELINFO channelInfo;
+		seconds[i] = 0.0;
+		freqs[i] = 0;
+		frameBytes[i] = getFrameBytes(channels[i], true);
+		if( BASS_ChannelGetInfo(channels[i], &channelInfo) && channelInfo.freq )
+		{
+			freqs[i] = channelInfo.freq;
+			seconds[i] = (double)getChainLatency(channels[i]) / (double)channelInfo.freq;
+			if( seconds[i] > maxSeconds )
+				maxSeconds = seconds[i];
+		}
+	}
+
+	// set the compensation delays
+	for( i = 0; i < count; i++ )
+	{
+		long frames = (long)((maxSeconds - seconds[i]) * freqs[i] + 0.5);
+		DELAY_LINE newDelay, oldDelay;
+		if( !delayLineCreate(&newDelay, frameBytes[i], frames) )
+			continue;
+
+		memset(&oldDelay, 0, sizeof(DELAY_LINE));
+		EnterCriticalSection(&s_compensationCritical);
+			COMPENSATION* c = (COMPENSATION*)sjhashFind(&s_compensationHash, NULL, (int)channels[i]);
+			if( c && (c->delay.frames != newDelay.frames || c->delay.frameBytes != newDelay.frameBytes) )
+			{
+				lockEnter(&c->delayCritical_, BASS_VST_LOCK_COMPENSATION);
+					oldDelay = c->delay;
+					c->delay = newDelay;
+				LeaveCriticalSection(&c->delayCritical_);
+			}
+			else
+			{
+				oldDelay = newDelay; // unchanged or removed meanwhile
+			}
+		LeaveCriticalSection(&s_compensationCritical);
+
+		delayLineFree(&oldDelay);
+	}
+
+Cleanup:
+	if( channels )		free(channels);
+	if( seconds )		free(seconds);
+	if( frameBytes )	free(frameBytes);
+	if( freqs )			free(freqs);
+}
+
+
+
+static COMPENSATION* removeCompensation(DWORD channelHandle)
+{
+	EnterCriticalSection(&s_compensationCritical);
+		COMPENSATION* c = (COMPENSATION*)sjhashFind(&s_compensationHash, NULL, (int)channelHandle);
+		if( c )
+			sjhashInsert(&s_compensationHash, NULL, (int)channelHandle, 0/*pData = remove*/);
+	LeaveCriticalSection(&s_compensationCritical);
+	return c;
+}
+
+
+
+static void CALLBACK onCompensatedChannelFree(HSYNC /*handle*/, DWORD channelHandle, DWORD /*data*/, USERPTR /*user*/)
+{
+	// the channel is already deleted by BASS, do not call any BASS function for it
+	COMPENSATION* c = removeCompensation(channelHandle);
+	if( c )
+	{
+		freeCompensation(c);
+		updateCompensation();
+	}
+}
+
+
+
+DWORD setCompensation(DWORD channelHandle, BOOL enable)
+{
+	COMPENSATION* c;
+
+	if( enable )
+	{
+		EnterCriticalSection(&s_compensationCritical);
+			c = (COMPENSATION*)sjhashFind(&s_compensationHash, NULL, (int)channelHandle);
+		LeaveCriticalSection(&s_compensationCritical);
+		if( c )
+			return BASS_OK; // already registered
+
+		if( (c = (COMPENSATION*)calloc(1, sizeof(COMPENSATION))) == NULL )
+			return BASS_ERROR_MEM;
+
+		c->channelHandle = channelHandle;
+		InitializeCriticalSection(&c->delayCritical_);
+		c->dspHandle = BASS_ChannelSetDSP(channelHandle, doCompensation, (USERPTR)c, COMPENSATION_DSP_PRIORITY);
+		if( c->dspHandle == 0 )
+		{
+			freeCompensation(c);
+			return BASS_ERROR_HANDLE;
+		}
+		c->syncHandle = BASS_ChannelSetSync(channelHandle, BASS_SYNC_FREE, 0, onCompensatedChannelFree, NULL);
+
+		EnterCriticalSection(&s_compensationCritical);
+			sjhashInsert(&s_compensationHash, NULL, (int)channelHandle, c);
+		LeaveCriticalSection(&s_compensationCritical);
+	}
+	else
+	{
+		if( (c = removeCompensation(channelHandle)) == NULL )
+			return BASS_ERROR_HANDLE;
+
+		BASS_ChannelRemoveDSP(channelHandle, c->dspHandle);
+		if( c->syncHandle )
+			BASS_ChannelRemoveSync(channelHandle, c->syncHandle);
+		freeCompensation(c);
+	}
+
+	updateCompensation();
+	return BASS_OK;
+}
+
+
+
+long getCompensation(DWORD channelHandle)
+{
+	long frames = -1;
+	EnterCriticalSection(&s_compensationCritical);
+		COMPENSATION* c = (COMPENSATION*)sjhashFind(&s_compensationHash, NULL, (int)channelHandle);
+		if( c )
+			frames = c->delay.frames;
+	LeaveCriticalSection(&s_compensationCritical);
+	return frames;
+}
+
+
+
+/*****************************************************************************
+ *  common
+ *****************************************************************************/
+
+
+
+bool updateLatency(BASS_VST_PLUGIN* this_)
+{
+	bool ok = updateBypassDelay(this_);
+	updateCompensation();
+	return ok;
+}
@@ -0,0 +1,430 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_outputs.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Splitting the outputs of an instrument into several streams
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the instrument renders all of its outputs to a shared ring of
+ *	planar buffers; each stream (the instrument's own one and those created
+ *	by BASS_VST_ChannelCreateOutput()) has its own read position and
+ *	interleaves its outputs directly from the ring to the buffer given by
+ *	BASS.  A block is rendered when the first stream needs it, the other
+ *	streams take the same samples later - so the streams may be pulled with
+ *	different lengths, eg. if they were started at different times.
+ *
+ *	While rendering, buffersOut point into the ring (see processOutputs()),
+ *	so the plugin writes its outputs directly there.  As callProcess() may
+ *	convert the outputs to doubles in place, twice the block has to be free
+ *	in the ring and each channel has the room for one block behind the ring.
+ *	Streams that are not pulled (eg. paused ones) would block the others;
+ *	if the ring is full, they lose their oldest samples.
+ *
+ *	Everything is done holding the plugin's vstCritical_; BASS functions are
+ *	only called outside of it.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+
+
+#define OUTPUT_RING_MS			1000	// the ring holds at least one second ...
+#define OUTPUT_RING_BLOCKS		4		// ... and 4 blocks
+#define MAX_OUTPUT_STREAMS		MAX_CHANS
+
+
+
+typedef struct
+{
+	HSTREAM				stream;
+	long				firstOutput;
+	long				numChans;
+	unsigned long		readPos;		// samples read so far, wraps around
+} OUTPUT_STREAM;
+
+struct OUTPUT_SPLIT
+{
+	BUFFER_ARENA		arena;
+	long				numChans;		// numActiveOutputs of the plugin
+	long				frames;			// a power of 2
+	float*				chans[MAX_CHANS];
+	unsigned long		renderPos;		// samples rendered so far, wraps around
+
+	long				numStreams;		// the first one is the instrument's own stream
+	OUTPUT_STREAM		streams[MAX_OUTPUT_STREAMS];
+};
+
+
+
+static void freeSplit(OUTPUT_SPLIT* split)
+{
+	if( split )
+	{
+		arenaFree(&split->arena);
+		free(split);
+	}
+}
+
+
+
+static OUTPUT_SPLIT* allocSplit(BASS_VST_PLUGIN* this_, DWORD freq, DWORD chans)
+{
+	long frames = 1, c;
+	while( frames < (long)(freq * OUTPUT_RING_MS / 1000) || frames < this_->effBlockSize * OUTPUT_RING_BLOCKS )
+		frames <<= 1;
+
+	OUTPUT_SPLIT* split = (OUTPUT_SPLIT*)calloc(1, sizeof(OUTPUT_SPLIT));
+	if( split == NULL )
+		return NULL;
+
+	size_t stride = arenaStride((frames + this_->effBlockSize)*sizeof(float));
+	if( !arenaAlloc(&split->arena, stride*this_->numActiveOutputs) )
+	{
+		free(split);
+		return NULL;
+	}
+
+	BYTE* p = split->arena.mem;
+	for( c = 0; c < this_->numActiveOutputs; c++, p += stride )
+		split->chans[c] = (float*)p;
+
+	split->numChans = this_->numActiveOutputs;
+	split->frames = frames;
+
+	// the instrument's own stream plays the first outputs as before
+	split->numStreams = 1;
+	split->streams[0].stream = this_->channelHandle;
+	split->streams[0].firstOutput = 0;
+	split->streams[0].numChans = chans;
+	return split;
+}
+
+
+
+/*****************************************************************************
+ *  rendering and reading, audio threads
+ *****************************************************************************/
+
+
+
+static void renderBlock(BASS_VST_PLUGIN* this_, OUTPUT_SPLIT* split, long numSamples, DWORD freq, PROCESS_EVENTS* events)
+{
+	// make room for twice the block, see above; streams lagging behind lose their oldest samples
+	long s, c;
+	for( s = 0; s < split->numStreams; s++ )
+	{
+		OUTPUT_STREAM* st = &split->streams[s];
+		if( (long)(split->renderPos + 2*numSamples - st->readPos) > split->frames )
+			st->readPos = split->renderPos + 2*numSamples - split->frames;
+	}
+
+	long offset = (long)(split->renderPos & (split->frames-1));
+	float* saved[MAX_CHANS];
+	for( c = 0; c < split->numChans; c++ )
+	{
+		saved[c] = this_->buffersOut[c];
+		this_->buffersOut[c] = &split->chans[c][offset];
+	}
+
+	processOutputs(this_, numSamples, freq, events);
+
+	for( c = 0; c < split->numChans; c++ )
+		this_->buffersOut[c] = saved[c];
+
+	split->renderPos += numSamples;
+}
+
+
+
+static void readStream(BASS_VST_PLUGIN* this_, OUTPUT_SPLIT* split, OUTPUT_STREAM* st, void* buffer, long numSamples,
+					   const BASS_CHANNELINFO* info, PROCESS_EVENTS* events)
+{
+	long chans = (long)info->chans, done = 0, todo, offset, c, i;
+	bool isFloat = (info->flags&BASS_SAMPLE_FLOAT) != 0;
+	while( done < numSamples )
+	{
+		long available = (long)(split->renderPos - st->readPos);
+		if( available <= 0 )
+		{
+			// the first stream needing the block renders it for all
+			todo = numSamples - done;
+			if( todo > this_->effBlockSize )
+				todo = this_->effBlockSize;
+			offset = (long)(split->renderPos & (split->frames-1));
+			if( todo > split->frames - offset )
+				todo = split->frames - offset;
+			renderBlock(this_, split, todo, info->freq, events);
+			continue;
+		}
+
+		offset = (long)(st->readPos & (split->frames-1));
+		todo = numSamples - done;
+		if( todo > available )
+			todo = available;
+		if( todo > split->frames - offset )
+			todo = split->frames - offset;
+
+		// interleave our outputs directly from the shared ones
+		for( c = 0; c < chans && c < st->numChans && st->firstOutput + c < split->numChans; c++ )
+		{
+			const float* src = &split->chans[st->firstOutput + c][offset];
+			if( isFloat )
+			{
+				float* dest = &((float*)buffer)[done*chans + c];
+				for( i = 0; i < todo; i++ )
+					dest[i*chans] = src[i];
+			}
+			else
+			{
+				signed short* dest = &((signed short*)buffer)[done*chans + c];
+				for( i = 0; i < todo; i++ )
+				{
+					float sample = src[i] * 32767.0F;
+					if( sample < -32768.0F ) sample = -32768.0F;
+					if( sample >  32767.0F ) sample =  32767.0F;
+					dest[i*chans] = (signed short)sample;
+				}
+			}
+		}
+
+		st->readPos += todo;
+		done += todo;
+	}
+}
+
+
+
+bool outputsProcess(DWORD vstHandle, HSTREAM stream, void* buffer, DWORD length)
+{
+	// called by the streams with the buffer already emptied; returns false if the
+	// outputs are not split, the instrument's stream processes as usual then
+	BASS_CHANNELINFO	info;
+	PROCESS_EVENTS		events;
+	bool				handled = false;
+	long				s;
+
+	memset(&events, 0, sizeof(events));
+	allocCheckEnter();
+
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ == NULL )
+		goto Cleanup;
+
+	if( this_->outputSplit && BASS_ChannelGetInfo(stream, &info) && info.chans > 0 )
+	{
+		handled = true;
+		enterVstCritical(this_);
+			OUTPUT_SPLIT* split = this_->outputSplit;
+			if( split
+			 && this_->buffersIn
+			 && split->numChans <= this_->numActiveOutputs
+			 && !(info.flags&BASS_SAMPLE_8BITS) )
+			{
+				for( s = 0; s < split->numStreams; s++ )
+				{
+					if( split->streams[s].stream == stream )
+					{
+						long bytesPerSample = (info.flags&BASS_SAMPLE_FLOAT)? sizeof(float) : sizeof(signed short);
+						readStream(this_, split, &split->streams[s], buffer, (long)(length / bytesPerSample / info.chans), &info, &events);
+						break;
+					}
+				}
+			}
+		leaveVstCritical(this_);
+
+		// the latency is updated by the idle routine, see doEffectProcess()
+		if( events.watchdogBypassed || events.nanReset )
+		{
+			this_->needsIdle |= NEEDS_LATENCY_UPDATE;
+			updateIdleTimers(this_);
+		}
+
+		// inform the user - outside of the critical section, the user may call other functions
+		if( events.watchdogBypassed && this_->callback )
+			this_->callback(vstHandle, BASS_VST_WATCHDOG_BYPASSED, (DWORD)(events.processNs/1000), (DWORD)(events.blockNs/1000), this_->callbackUserData);
+
+		if( events.nonFinite && this_->callback )
+			this_->callback(vstHandle, BASS_VST_NONFINITE_OUTPUT, this_->stats.nonFiniteBlocks, events.nanReset? 1 : 0, this_->callbackUserData);
+	}
+
+	unrefHandle(vstHandle);
+
+Cleanup:
+	allocCheckLeave();
+	return handled;
+}
+
+
+
+static DWORD CALLBACK doOutputStream(HSTREAM stream, void* buffer, DWORD length, USERPTR vstHandle__)
+{
+	DWORD vstHandle = (DWORD)(intptr_t)vstHandle__; // double cast to stop Xcode complaining
+	if( length <= 0 || buffer == NULL )
+		return 0;
+	memset(buffer, 0, length);
+	outputsProcess(vstHandle, stream, buffer, length);
+	return length;
+}
+
+
+
+/*****************************************************************************
+ *  creating and freeing the streams
+ *****************************************************************************/
+
+
+
+static void CALLBACK onOutputStreamFree(HSYNC /*handle*/, DWORD stream, DWORD /*data*/, USERPTR vstHandle__)
+{
+	// the stream is not read any longer; if it was the last one, the instrument's
+	// stream processes as usual again
+	DWORD vstHandle = (DWORD)(intptr_t)vstHandle__; // double cast to stop Xcode complaining
+	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
+	if( this_ )
+	{
+		OUTPUT_SPLIT* oldSplit = NULL;
+		enterVstCritical(this_);
+			OUTPUT_SPLIT* split = this_->outputSplit;
+			long s;
+			for( s = 1; split && s < split->numStreams; s++ )
+			{
+				if( split->streams[s].stream == stream )
+				{
+					split->numStreams--;
+					memmove(&split->streams[s], &split->streams[s+1], (split->numStreams - s)*sizeof(OUTPUT_STREAM));
+					break;
+				}
+			}
+
+			if( split && split->numStreams <= 1 )
+			{
+				oldSplit = split;
+				this_->outputSplit = NULL;
+			}
+		leaveVstCritical(this_);
+
+		freeSplit(oldSplit);
+		unrefHandle(vstHandle);
+	}
+}
+
+
+
+HSTREAM outputsCreate(BASS_VST_PLUGIN* this_, long firstOutput, long numChans, DWORD flags, DWORD* error)
+{
+	// returns 0 and sets *error, or returns 0 with *error=BASS_OK if BASS has failed
+	BASS_CHANNELINFO	info;
+	OUTPUT_SPLIT*		newSplit = NULL;
+
+	*error = BASS_OK;
+	if( this_->type != VSTinstrument )
+	{
+		*error = BASS_ERROR_ILLTYPE;
+		return 0;
+	}
+
+	if( this_->buffersIn == NULL || !BASS_ChannelGetInfo(this_->channelHandle, &info) )
+	{
+		*error = BASS_ERROR_NOTAVAIL;
+		return 0;
+	}
+
+	if( numChans <= 0 || firstOutput < 0 || firstOutput + numChans > this_->aeffect->numOutputs || firstOutput + numChans > MAX_CHANS )
+	{
+		*error = BASS_ERROR_ILLPARAM;
+		return 0;
+	}
+
+	if( flags & BASS_SAMPLE_8BITS )
+	{
+		*error = BASS_ERROR_FORMAT;
+		return 0;
+	}
+
+	// the ring is allocated with the first stream
+	enterVstCritical(this_);
+		bool needSplit = (this_->outputSplit == NULL);
+		bool full = (this_->outputSplit && this_->outputSplit->numStreams >= MAX_OUTPUT_STREAMS);
+	leaveVstCritical(this_);
+
+	if( full )
+	{
+		*error = BASS_ERROR_NOTAVAIL;
+		return 0;
+	}
+
+	if( needSplit )
+	{
+		newSplit = allocSplit(this_, info.freq, info.chans);
+		if( newSplit == NULL )
+		{
+			*error = BASS_ERROR_MEM;
+			return 0;
+		}
+	}
+
+	HSTREAM stream = BASS_StreamCreate(info.freq, numChans, flags, doOutputStream, (USERPTR)(intptr_t)this_->vstHandle);
+	if( stream == 0 )
+	{
+		freeSplit(newSplit);
+		return 0; // error already set by BASS
+	}
+	BASS_ChannelSetSync(stream, BASS_SYNC_FREE, 0, onOutputStreamFree, (USERPTR)(intptr_t)this_->vstHandle);
+
+	enterVstCritical(this_);
+		if( this_->outputSplit == NULL )
+		{
+			this_->outputSplit = newSplit;
+			newSplit = NULL;
+		}
+
+		OUTPUT_SPLIT* split = this_->outputSplit;
+		if( split->numStreams < MAX_OUTPUT_STREAMS )
+		{
+			OUTPUT_STREAM* st = &split->streams[split->numStreams++];
+			st->stream = stream;
+			st->firstOutput = firstOutput;
+			st->numChans = numChans;
+			st->readPos = split->renderPos; // start with the next block rendered
+		}
+		else
+		{
+			*error = BASS_ERROR_NOTAVAIL;
+		}
+	leaveVstCritical(this_);
+
+	freeSplit(newSplit); // not needed, another thread was faster
+
+	if( *error != BASS_OK )
+	{
+		BASS_StreamFree(stream);
+		return 0;
+	}
+
+	return stream;
+}
+
+
+
+void outputsFree(BASS_VST_PLUGIN* this_)
+{
+	// called by destroyHandle(), nobody else uses the plugin any longer; the syncs of
+	// the streams do not find the plugin then
+	OUTPUT_SPLIT* split = this_->outputSplit;
+	if( split )
+	{
+		for( long s = 1; s < split->numStreams; s++ )
+			BASS_StreamFree(split->streams[s].stream);
+		freeSplit(split);
+	}
+	this_->outputSplit = NULL;
+}
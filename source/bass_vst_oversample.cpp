@@ -0,0 +1,327 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_oversample.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Running plugins at a multiple of the channel's sample rate
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the oversampling is done by a cascade of 2x stages, each with a
+ *	linear phase half-band FIR filter.  Every second coefficient of a
+ *	half-band filter is zero, so for upsampling, one output of each pair
+ *	is just a delayed input and the other one a short dot product; for
+ *	downsampling, the same dot product is done over the even samples only.
+ *	The first stage needs a steep filter, the higher stages only have to
+ *	remove the images of the first stage and are much shorter.
+ *
+ *	The filters are applied to the plugin's buffers only, so the plugin
+ *	is called with factor times the samples; the latency of the filters is
+ *	added to the latency reported in initialDelay by BASS_VST_GetInfo()
+ *	(see getTotalLatency()).  The buffers are allocated when the option is
+ *	set, never by the audio thread.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE__))
+#define FP_SSE
+#include <xmmintrin.h>
+#endif
+
+
+
+/*****************************************************************************
+ *  filters
+ *****************************************************************************/
+
+
+
+// the non-zero coefficients of the half-band filters besides the center tap
+// of 0.5, symmetric, so the dot products run over the history forward; the
+// first stage passes up to 0.22 of its sample rate (19.4 kHz at 44.1 kHz)
+// and attenuates the images by 89 dB, the higher stages the same for the
+// range used by the first stage
+#define STAGE1_TAPS				48
+#define STAGE2_TAPS				16
+#define OVERSAMPLE_HISTORY		(STAGE1_TAPS-1)
+
+static const float s_stage1[STAGE1_TAPS] =
+{
+	-1.254887920e-05F,  3.515087055e-05F, -7.647179302e-05F,  1.454801658e-04F,
+	-2.535916360e-04F,  4.149308608e-04F, -6.465749497e-04F,  9.687999568e-04F,
+	-1.405375457e-03F,  1.983987524e-03F, -2.736924756e-03F,  3.702249538e-03F,
+	-4.925825538e-03F,  6.464841080e-03F, -8.393983175e-03F,  1.081647061e-02F,
+	-1.388446745e-02F,  1.783891211e-02F, -2.309333631e-02F,  3.042987706e-02F,
+	-4.153152061e-02F,  6.079150062e-02F, -1.043590224e-01F,  3.177274426e-01F,
+	 3.177274426e-01F, -1.043590224e-01F,  6.079150062e-02F, -4.153152061e-02F,
+	 3.042987706e-02F, -2.309333631e-02F,  1.783891211e-02F, -1.388446745e-02F,
+	 1.081647061e-02F, -8.393983175e-03F,  6.464841080e-03F, -4.925825538e-03F,
+	 3.702249538e-03F, -2.736924756e-03F,  1.983987524e-03F, -1.405375457e-03F,
+	 9.687999568e-04F, -6.465749497e-04F,  4.149308608e-04F, -2.535916360e-04F,
+	 1.454801658e-04F, -7.647179302e-05F,  3.515087055e-05F, -1.254887920e-05F,
+};
+
+static const float s_stage2[STAGE2_TAPS] =
+{
+	-2.037123063e-04F,  1.156715627e-03F, -3.825452116e-03F,  9.768401542e-03F,
+	-2.145661801e-02F,  4.379779521e-02F, -9.292651833e-02F,  3.136893884e-01F,
+	 3.136893884e-01F, -9.292651833e-02F,  4.379779521e-02F, -2.145661801e-02F,
+	 9.768401542e-03F, -3.825452116e-03F,  1.156715627e-03F, -2.037123063e-04F,
+};
+
+
+
+static inline float dotProduct(const float* x, const float* coeff, long numTaps)
+{
+	// numTaps is a multiple of 4
+#if defined(FP_SSE)
+	__m128 sum = _mm_setzero_ps();
+	for( long i = 0; i < numTaps; i += 4 )
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&x[i]), _mm_loadu_ps(&coeff[i])));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+#else
+	float sum0 = 0.0F, sum1 = 0.0F, sum2 = 0.0F, sum3 = 0.0F;
+	for( long i = 0; i < numTaps; i += 4 )
+	{
+		sum0 += x[i  ] * coeff[i  ];
+		sum1 += x[i+1] * coeff[i+1];
+		sum2 += x[i+2] * coeff[i+2];
+		sum3 += x[i+3] * coeff[i+3];
+	}
+	return (sum0 + sum1) + (sum2 + sum3);
+#endif
+}
+
+
+
+static void upsample2(const float* src, float* dst, long numSamples, float* history, float* work, const float* coeff, long numTaps)
+{
+	// dst gets 2*numSamples samples and may be the same as src; the history holds the
+	// last numTaps-1 inputs
+	long histLen = numTaps - 1, n;
+	memcpy(work, history, histLen*sizeof(float));
+	memcpy(&work[histLen], src, numSamples*sizeof(float));
+
+	for( n = 0; n < numSamples; n++ )
+	{
+		dst[2*n  ] = 2.0F * dotProduct(&work[n], coeff, numTaps);
+		dst[2*n+1] = work[n + numTaps/2];
+	}
+
+	memcpy(history, &work[numSamples], histLen*sizeof(float));
+}
+
+
+
+static void downsample2(const float* src, float* dst, long numSamples, float* history, float* workEven, float* workOdd, const float* coeff, long numTaps)
+{
+	// numSamples is the number of output samples, src has the double number; dst may
+	// be the same as src.  The history holds the last numTaps-1 even and odd inputs.
+	long histLen = numTaps - 1, n;
+	memcpy(workEven, history, histLen*sizeof(float));
+	memcpy(workOdd, &history[OVERSAMPLE_HISTORY], histLen*sizeof(float));
+	for( n = 0; n < numSamples; n++ )
+	{
+		workEven[histLen + n] = src[2*n];
+		workOdd[histLen + n] = src[2*n+1];
+	}
+
+	for( n = 0; n < numSamples; n++ )
+		dst[n] = dotProduct(&workEven[n], coeff, numTaps) + 0.5F * workOdd[n + numTaps/2 - 1];
+
+	memcpy(history, &workEven[numSamples], histLen*sizeof(float));
+	memcpy(&history[OVERSAMPLE_HISTORY], &workOdd[numSamples], histLen*sizeof(float));
+}
+
+
+
+static void getStage(long stage, const float** coeff, long* numTaps)
+{
+	*coeff = stage == 0? s_stage1 : s_stage2;
+	*numTaps = stage == 0? STAGE1_TAPS : STAGE2_TAPS;
+}
+
+
+
+/*****************************************************************************
+ *  processing, audio thread
+ *****************************************************************************/
+
+
+
+void oversampleProcess(BASS_VST_PLUGIN* this_, float** buffersIn, float** buffersOut, long numSamples)
+{
+	OVERSAMPLER*	os = &this_->oversampler;
+	const float*	coeff;
+	long			numTaps, c, s, len;
+
+	if( numSamples > os->blockSize
+	 || os->numInputs < this_->numActiveInputs
+	 || os->numOutputs < this_->numActiveOutputs )
+	{
+		// cannot happen, the buffers are allocated for the largest block and all channels
+		for( c = 0; c < this_->numActiveOutputs; c++ )
+			memset(buffersOut[c], 0, numSamples*sizeof(float));
+		return;
+	}
+
+	long numInputs = this_->aeffect->numInputs < os->numInputs? this_->aeffect->numInputs : os->numInputs;
+	long numOutputs = this_->aeffect->numOutputs < os->numOutputs? this_->aeffect->numOutputs : os->numOutputs;
+
+	// upsample the plugin's inputs, the stages work in place
+	for( c = 0; c < numInputs; c++ )
+	{
+		const float* src = buffersIn[c];
+		for( s = 0, len = numSamples; s < os->numStages; s++, len *= 2 )
+		{
+			getStage(s, &coeff, &numTaps);
+			upsample2(src, os->in[c], len, &os->upHistory[(c*OVERSAMPLE_MAX_STAGES + s)*OVERSAMPLE_HISTORY],
+				os->work[0], coeff, numTaps);
+			src = os->in[c];
+		}
+	}
+
+	callProcess(this_, os->in, os->out, numSamples * os->factor, false, false);
+
+	// downsample the plugin's outputs, beginning with the highest rate
+	for( c = 0; c < numOutputs; c++ )
+	{
+		for( s = os->numStages - 1, len = numSamples * os->factor / 2; s >= 0; s--, len /= 2 )
+		{
+			getStage(s, &coeff, &numTaps);
+			downsample2(os->out[c], s == 0? buffersOut[c] : os->out[c], len,
+				&os->downHistory[(c*OVERSAMPLE_MAX_STAGES + s)*2*OVERSAMPLE_HISTORY], os->work[1], os->work[2], coeff, numTaps);
+		}
+	}
+
+	// callProcess() has emptied the other outputs at the higher rate only
+	for( c = numOutputs; c < os->numOutputs; c++ )
+		memset(buffersOut[c], 0, numSamples*sizeof(float));
+}
+
+
+
+/*****************************************************************************
+ *  setting the factor
+ *****************************************************************************/
+
+
+
+static bool allocOversampler(OVERSAMPLER* os, long factor, long numInputs, long numOutputs, long blockSize)
+{
+	// the layout is the same as for the channel buffers, see allocProcessBuffers(); the
+	// plugin may convert its buffers to doubles in place
+	memset(os, 0, sizeof(OVERSAMPLER));
+	if( factor <= 1 )
+		return true;
+
+	os->factor = factor;
+	os->numStages = factor == 2? 1 : (factor == 4? 2 : 3);
+	os->numInputs = numInputs;
+	os->numOutputs = numOutputs;
+	os->blockSize = blockSize;
+
+	size_t pointerBytes = arenaStride(2*MAX_CHANS*sizeof(float*));
+	size_t stride = arenaStride(blockSize*factor*sizeof(float)*BUFFER_HEADROOM_MULT);
+	size_t workBytes = arenaStride((OVERSAMPLE_HISTORY + blockSize*factor/2)*sizeof(float));
+	size_t upBytes = arenaStride(numInputs*OVERSAMPLE_MAX_STAGES*OVERSAMPLE_HISTORY*sizeof(float));
+	size_t downBytes = arenaStride(numOutputs*OVERSAMPLE_MAX_STAGES*2*OVERSAMPLE_HISTORY*sizeof(float));
+	if( !arenaAlloc(&os->arena, pointerBytes + stride*(numInputs+numOutputs) + workBytes*3 + upBytes + downBytes) )
+	{
+		memset(os, 0, sizeof(OVERSAMPLER));
+		return false;
+	}
+
+	BYTE* p = os->arena.mem;
+	long i;
+	os->in = (float**)p;
+	os->out = os->in + MAX_CHANS;
+	p += pointerBytes;
+	for( i = 0; i < numInputs; i++, p += stride )
+		os->in[i] = (float*)p;
+	for( i = 0; i < numOutputs; i++, p += stride )
+		os->out[i] = (float*)p;
+	for( i = 0; i < 3; i++, p += workBytes )
+		os->work[i] = (float*)p;
+	os->upHistory = (float*)p;
+	p += upBytes;
+	os->downHistory = (float*)p;
+
+	// each stage delays by its filter length at its own rate, once for up- and once
+	// for downsampling
+	long stage, numTaps;
+	const float* coeff;
+	for( stage = 0; stage < os->numStages; stage++ )
+	{
+		getStage(stage, &coeff, &numTaps);
+		os->latency += (double)(numTaps - 1) / (1 << stage);
+	}
+
+	return true;
+}
+
+
+
+DWORD setOversampling(BASS_VST_PLUGIN* this_, long factor)
+{
+	// the buffers are allocated outside of the critical section; as the sample rate
+	// and the block size of the plugin change, it is suspended and resumed
+	BASS_CHANNELINFO info;
+	OVERSAMPLER newOs;
+
+	if( factor == 0 )
+		factor = 1;
+	if( factor != 1 && factor != 2 && factor != 4 && factor != 8 )
+		return BASS_ERROR_ILLPARAM;
+
+	if( this_->buffersIn == NULL || !BASS_ChannelGetInfo(this_->channelHandle, &info) )
+		return BASS_ERROR_NOTAVAIL; // no channel assigned
+
+	if( factor != 1 && this_->resampler.pluginRate )
+		return BASS_ERROR_NOTAVAIL; // either oversampling or a fixed rate
+
+	long blockSize = this_->fixedBlockSize > this_->effBlockSize? this_->fixedBlockSize : this_->effBlockSize;
+	if( !allocOversampler(&newOs, factor, this_->numActiveInputs, this_->numActiveOutputs, blockSize) )
+		return BASS_ERROR_MEM;
+
+	enterVstCritical(this_);
+
+		long oldFactor = oversampleFactor(this_);
+		OVERSAMPLER oldOs = this_->oversampler;
+		this_->oversampler = newOs;
+		newOs = oldOs;
+
+		// the transport position is given in samples of the plugin
+		this_->transport.samplePos = this_->transport.samplePos * factor / oldFactor;
+
+		if( this_->effStartProcessCalled )
+		{
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effSetSampleRate, 0, 0, NULL, (float)info.freq * factor);
+			this_->aeffect->dispatcher(this_->aeffect, effSetBlockSize, 0, (this_->fixedBlockSize? this_->fixedBlockSize : this_->effBlockSize) * factor, NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
+		}
+
+	leaveVstCritical(this_);
+
+	// free the old buffers
+	arenaFree(&newOs.arena);
+	return BASS_OK;
+}
+
+
+
+void freeOversampling(BASS_VST_PLUGIN* this_)
+{
+	arenaFree(&this_->oversampler.arena);
+	memset(&this_->oversampler, 0, sizeof(OVERSAMPLER));
+}
@@ -27,6 +27,19 @@
 
 
 #include "bass_vst_impl.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE__))
+#define FP_SSE
+#include <xmmintrin.h>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define FP_SSE2
+#include <emmintrin.h>
+#endif
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#endif
 
 
 
@@ -140,6 +153,155 @@ static void cnvFloatLLRR_To_Stereo(float* bufferL, float* bufferR, long sampleCo
 
 
 
+/*****************************************************************************
+ *  denormals
+ *****************************************************************************/
+
+
+
+// Denormals (the tiny numbers in the decaying tails of reverbs and filters) are very
+// slow on most CPUs.  While a plugin runs, the CPU flushes them to zero (FTZ) and
+// treats denormal inputs as zero (DAZ); the state of the caller is restored afterwards.
+#if defined(FP_SSE)
+typedef unsigned int FP_STATE;
+#define FP_FLUSH_DENORMALS		0x8040 // FTZ (bit 15) and DAZ (bit 6) of MXCSR
+
+static FP_STATE fpFlushDenormals()
+{
+	FP_STATE old = _mm_getcsr();
+	_mm_setcsr(old | FP_FLUSH_DENORMALS);
+	return old;
+}
+
+static void fpRestore(FP_STATE old)
+{
+	_mm_setcsr(old);
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+typedef unsigned long long FP_STATE;
+#define FP_FLUSH_DENORMALS		(1ULL<<24) // FZ of FPCR, on ARM this includes the inputs
+
+static FP_STATE fpFlushDenormals()
+{
+	FP_STATE old;
+	#ifdef _M_ARM64
+	old = _ReadStatusReg(ARM64_FPCR);
+	_WriteStatusReg(ARM64_FPCR, old | FP_FLUSH_DENORMALS);
+	#else
+	__asm__ __volatile__("mrs %0, fpcr" : "=r"(old));
+	__asm__ __volatile__("msr fpcr, %0" : : "r"(old | FP_FLUSH_DENORMALS));
+	#endif
+	return old;
+}
+
+static void fpRestore(FP_STATE old)
+{
+	#ifdef _M_ARM64
+	_WriteStatusReg(ARM64_FPCR, old);
+	#else
+	__asm__ __volatile__("msr fpcr, %0" : : "r"(old));
+	#endif
+}
+#else
+typedef int FP_STATE;
+
+static FP_STATE fpFlushDenormals()
+{
+	return 0; // not supported on this platform
+}
+
+static void fpRestore(FP_STATE old)
+{
+}
+#endif
+
+
+
+// some plugins reset the FPU state themselves; for these, a tiny signal far below
+// anything audible can be added to the inputs, see BASS_VST_OPTION_ANTIDENORMAL
+#define ANTI_DENORMAL_LEVEL		1.0e-18 // -360 dB
+
+static void addAntiDenormal(BASS_VST_PLUGIN* this_, float** buffers, long numChans, long numSamples, bool isDouble)
+{
+	long c, i;
+	double add = ANTI_DENORMAL_LEVEL;
+	for( c = 0; c < numChans; c++ )
+	{
+		for( i = 0; i < numSamples; i++ )
+		{
+			if( this_->antiDenormal == ANTI_DENORMAL_NOISE )
+			{
+				// a simple linear congruential generator is random enough
+				this_->antiDenormalSeed = this_->antiDenormalSeed * 1664525 + 1013904223;
+				add = (int)this_->antiDenormalSeed * (ANTI_DENORMAL_LEVEL / 2147483648.0);
+			}
+
+			if( isDouble )
+				((double*)buffers[c])[i] += add;
+			else
+				buffers[c][i] += (float)add;
+		}
+	}
+}
+
+
+
+/*****************************************************************************
+ *  NaN and infinity
+ *****************************************************************************/
+
+
+
+// x-x is 0 for all finite numbers and NaN for NaN and infinity; the checks are done for
+// 4 or 2 samples at once and the result is only looked at after the whole channel
+static bool isFinite(const float* buffer, long numSamples)
+{
+	long i = 0;
+#if defined(FP_SSE)
+	__m128 bad = _mm_setzero_ps();
+	for( ; i + 4 <= numSamples; i += 4 )
+	{
+		__m128 x = _mm_loadu_ps(&buffer[i]);
+		x = _mm_sub_ps(x, x);
+		bad = _mm_or_ps(bad, _mm_cmpunord_ps(x, x));
+	}
+	if( _mm_movemask_ps(bad) )
+		return false;
+#endif
+	for( ; i < numSamples; i++ )
+	{
+		if( !(buffer[i] - buffer[i] == 0.0F) )
+			return false;
+	}
+	return true;
+}
+
+
+
+static bool isFiniteDouble(const double* buffer, long numSamples)
+{
+	long i = 0;
+#if defined(FP_SSE2)
+	__m128d bad = _mm_setzero_pd();
+	for( ; i + 2 <= numSamples; i += 2 )
+	{
+		__m128d x = _mm_loadu_pd(&buffer[i]);
+		x = _mm_sub_pd(x, x);
+		bad = _mm_or_pd(bad, _mm_cmpunord_pd(x, x));
+	}
+	if( _mm_movemask_pd(bad) )
+		return false;
+#endif
+	for( ; i < numSamples; i++ )
+	{
+		if( !(buffer[i] - buffer[i] == 0.0) )
+			return false;
+	}
+	return true;
+}
+
+
+
 /*****************************************************************************
  *  the needed buffers
  *****************************************************************************/
@@ -150,53 +312,142 @@ void callMainsChanged(BASS_VST_PLUGIN* this_, long blockSize)
 {
 	enterVstCritical(this_);
 		this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
-		this_->aeffect->dispatcher(this_->aeffect, effSetBlockSize, 0, blockSize, NULL, 0.0);
+		this_->aeffect->dispatcher(this_->aeffect, effSetBlockSize, 0, getPluginBlockSize(this_, blockSize), NULL, 0.0);
 		this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
 	leaveVstCritical(this_);
 }
 
 
 
-static bool allocChanBuffers(BASS_VST_PLUGIN* this_, long numInputs, long numOutputs, long numBytes)
+// the arenas are aligned to cache lines; the stride between the channels is padded to
+// an odd number of cache lines, so that the same sample in different channels does
+// not map to the same cache set
+#define ARENA_ALIGN				64
+#define ARENA_LARGE_PAGE		(2*1024*1024)
+
+size_t arenaStride(size_t bytes)
+{
+	size_t stride = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if( (stride / ARENA_ALIGN) % 2 == 0 )
+		stride += ARENA_ALIGN;
+	return stride;
+}
+
+
+
+bool arenaAlloc(BUFFER_ARENA* arena, size_t bytes)
+{
+	memset(arena, 0, sizeof(BUFFER_ARENA));
+
+#ifdef _WIN32
+	if( s_largePages && bytes >= ARENA_LARGE_PAGE/2 )
+	{
+		// needs the "Lock pages in memory" privilege, if this fails, we use normal pages
+		SIZE_T largePage = GetLargePageMinimum();
+		if( largePage )
+		{
+			SIZE_T largeBytes = (bytes + largePage - 1) & ~(largePage - 1);
+			arena->mem = (BYTE*)VirtualAlloc(NULL, largeBytes, MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES, PAGE_READWRITE);
+			arena->largePages = (arena->mem != NULL);
+		}
+	}
+	if( arena->mem == NULL )
+		arena->mem = (BYTE*)_aligned_malloc(bytes, ARENA_ALIGN);
+#else
+	// on Linux, big arenas are aligned to huge pages and marked for transparent huge pages
+	void* mem = NULL;
+	size_t align = ARENA_ALIGN;
+	if( s_largePages && bytes >= ARENA_LARGE_PAGE/2 )
+	{
+		align = ARENA_LARGE_PAGE;
+		bytes = (bytes + ARENA_LARGE_PAGE - 1) & ~(size_t)(ARENA_LARGE_PAGE - 1);
+	}
+	if( posix_memalign(&mem, align, bytes) != 0 )
+		mem = NULL;
+	#ifdef MADV_HUGEPAGE
+	if( mem && align == ARENA_LARGE_PAGE )
+		madvise(mem, bytes, MADV_HUGEPAGE);
+	#endif
+	arena->mem = (BYTE*)mem;
+#endif
+
+	if( arena->mem == NULL )
+		return false;
+
+	memset(arena->mem, 0, bytes);
+	arena->bytes = bytes;
+	return true;
+}
+
+
+
+void arenaFree(BUFFER_ARENA* arena)
 {
+	if( arena->mem )
+	{
+#ifdef _WIN32
+		if( arena->largePages )
+			VirtualFree(arena->mem, 0, MEM_RELEASE);
+		else
+			_aligned_free(arena->mem);
+#else
+		free(arena->mem);
+#endif
+	}
+	memset(arena, 0, sizeof(BUFFER_ARENA));
+}
+
+
+
+static bool allocProcessBuffers(BASS_VST_PLUGIN* this_, long numInputs, long numOutputs, long numSamples, long numTempSamples)
+{
+	// called by openProcess() only - the audio thread must neither allocate memory
+	// nor call effMainsChanged(), see BASS_VST_CONFIG_MAXBLOCK.  All buffers are
+	// allocated in one arena.
+	long numBytes = numSamples*sizeof(float);
+	long tempBytes = numTempSamples*sizeof(float);
 	if( numInputs > MAX_CHANS
 	 || numInputs <= 0
 	 || numOutputs > MAX_CHANS
 	 || numOutputs <= 0 )
 	{
-		freeChansBuffers(this_);
+		freeProcessBuffers(this_);
 		return false;
 	}
 
 	if( numBytes > this_->bytesPerInOutBuffer
+	 || tempBytes > this_->bytesTempBuffer
+	 || this_->buffersIn == NULL
 	 || this_->buffersIn[numInputs-1] == NULL
 	 || this_->buffersOut[numOutputs-1] == NULL )
 	{
-		// we allcate silently the double number of bytes to be prepared for double processing ...
-		#define BUFFER_HEADROOM_MULT 2
 		assert( sizeof(double)==sizeof(float)*BUFFER_HEADROOM_MULT );
 
 		// free previously allocated buffers
-		freeChansBuffers(this_);
+		freeProcessBuffers(this_);
 	
-		// allocated the new buffers
+		// allocate the new arena and divide it: the pointer arrays, the channels, the temp. buffer
+		size_t pointerBytes = arenaStride(2*MAX_CHANS*sizeof(float*));
+		size_t stride = arenaStride(numBytes*BUFFER_HEADROOM_MULT);
+		if( !arenaAlloc(&this_->bufferArena, pointerBytes + stride*(numInputs+numOutputs) + arenaStride(tempBytes)) )
+			return false;
+
+		BYTE* p = this_->bufferArena.mem;
+		this_->buffersIn = (float**)p;
+		this_->buffersOut = this_->buffersIn + MAX_CHANS;
+		p += pointerBytes;
+
 		int i;
-		for( i = 0; i < numInputs; i++ )
-		{ 
-			if( (this_->buffersIn[i]=(float*)malloc(numBytes*BUFFER_HEADROOM_MULT)) == NULL )
-			{
-				freeChansBuffers(this_);
-				return false;
-			}
-		}
+		for( i = 0; i < numInputs; i++, p += stride )
+			this_->buffersIn[i] = (float*)p;
+
+		for( i = 0; i < numOutputs; i++, p += stride )
+			this_->buffersOut[i] = (float*)p;
 
-		for( i = 0; i < numOutputs; i++ )
+		if( tempBytes )
 		{
-			if( (this_->buffersOut[i]=(float*)malloc(numBytes*BUFFER_HEADROOM_MULT)) == NULL )
-			{
-				freeChansBuffers(this_);
-				return false;
-			}
+			this_->bufferTemp = (float*)p;
+			this_->bytesTempBuffer = tempBytes;
 		}
 
 		this_->bytesPerInOutBuffer = numBytes;
@@ -204,7 +455,7 @@ static bool allocChanBuffers(BASS_VST_PLUGIN* this_, long numInputs, long numOut
 		this_->effBlockSize = numBytes/sizeof(float)/*sample count*/;
 		callMainsChanged(this_, this_->effBlockSize);
 
-		EnterCriticalSection(&s_forwardCritical);
+		lockEnter(&s_forwardCritical, BASS_VST_LOCK_FORWARD);
 			for( i = 0; i < this_->forwardDataToOtherCnt; i++ )
 			{
 				BASS_VST_PLUGIN* other_ = refHandle(this_->forwardDataToOtherVstHandles[i]);
@@ -220,143 +471,679 @@ static bool allocChanBuffers(BASS_VST_PLUGIN* this_, long numInputs, long numOut
 
 
 
-void freeChansBuffers(BASS_VST_PLUGIN* this_)
+void freeProcessBuffers(BASS_VST_PLUGIN* this_)
 {
 	if( this_ )
 	{
-		for( int i = 0; i < MAX_CHANS; i++ )
+		this_->buffersIn = NULL;
+		this_->buffersOut = NULL;
+		this_->bufferTemp = NULL;
+		this_->numActiveInputs = 0;
+		this_->numActiveOutputs = 0;
+
+		arenaFree(&this_->bufferArena);
+
+		this_->bytesPerInOutBuffer = 0;
+		this_->bytesTempBuffer = 0;
+	}
+}
+
+
+
+// each MIDI event list is allocated as one block with the VstEvents structure, the event
+// pointers and one VstMidiEvent per slot; so queueing normal MIDI events never allocates
+// memory and only sysex events are allocated - outside of midiCritical_
+#define MIDI_EVENT_POOL(list)	((VstMidiEvent*)((char*)(list) + sizeof(VstEvents) + MAX_MIDI_EVENTS*sizeof(VstEvent*)))
+
+static VstEvents* allocMidiEventList()
+{
+	size_t bytesNeeded = sizeof(VstEvents) + MAX_MIDI_EVENTS*sizeof(VstEvent*) + MAX_MIDI_EVENTS*sizeof(VstMidiEvent);
+	VstEvents* list = (VstEvents*)malloc(bytesNeeded);
+	if( list )
+	{
+		memset(list, 0, bytesNeeded);
+		for( int i = 0; i < MAX_MIDI_EVENTS; i++ )
+			list->events[i] = (VstEvent*)&MIDI_EVENT_POOL(list)[i];
+	}
+	return list;
+}
+
+
+
+static void freeMidiEventList(VstEvents* list)
+{
+	if( list )
+	{
+		for( int i = 0; i < MAX_MIDI_EVENTS; i++ )
+		{
+			if( !isPooledMidiEvent(list, list->events[i]) )
+				free(list->events[i]);
+		}
+		free(list);
+	}
+}
+
+
+
+bool isPooledMidiEvent(VstEvents* list, VstEvent* e)
+{
+	return (VstMidiEvent*)e >= MIDI_EVENT_POOL(list) && (VstMidiEvent*)e < MIDI_EVENT_POOL(list) + MAX_MIDI_EVENTS;
+}
+
+
+
+static bool allocMidiEvents(BASS_VST_PLUGIN* this_)
+{
+	VstEvents* newCurr = NULL, *newPrev = NULL;
+	bool ret = true;
+
+	lockEnter(&this_->midiCritical_, BASS_VST_LOCK_MIDI);
+		bool allocated = (this_->midiEventsCurr != NULL);
+	LeaveCriticalSection(&this_->midiCritical_);
+
+	if( !allocated )
+	{
+		newCurr = allocMidiEventList();
+		newPrev = allocMidiEventList();
+		if( newCurr && newPrev )
+		{
+			lockEnter(&this_->midiCritical_, BASS_VST_LOCK_MIDI);
+				if( this_->midiEventsCurr == NULL )
+				{
+					this_->midiEventsCurr = newCurr;
+					this_->midiEventsPrev = newPrev;
+					newCurr = newPrev = NULL;
+				}
+			LeaveCriticalSection(&this_->midiCritical_);
+		}
+		else
+		{
+			ret = false;
+		}
+		freeMidiEventList(newCurr);
+		freeMidiEventList(newPrev);
+	}
+
+	return ret;
+}
+
+
+
+void freeMidiEvents(BASS_VST_PLUGIN* this_)
+{
+	if( this_ )
+	{
+		freeMidiEventList(this_->midiEventsCurr);
+		freeMidiEventList(this_->midiEventsPrev);
+		this_->midiEventsCurr = NULL;
+		this_->midiEventsPrev = NULL;
+	}
+}
+
+
+
+static void trackHeldNotes(BASS_VST_PLUGIN* this_, const VstEvents* events)
+{
+	// remember the keys down for checkInstrumentOutput(); called with the MIDI events
+	// locked just before they are given to the plugin
+	for( VstInt32 i = 0; i < events->numEvents; i++ )
+	{
+		const VstEvent* e = events->events[i];
+		if( e->type != kVstMidiType )
+			continue;
+
+		const BYTE* midiData = (const BYTE*)((const VstMidiEvent*)e)->midiData;
+		BYTE status = midiData[0] & 0xF0, channel = midiData[0] & 0x0F, key = midiData[1] & 0x7F;
+		DWORD* bits = this_->heldNoteBits[channel];
+		DWORD mask = 1UL << (key & 31);
+		if( status == 0x90 && midiData[2] != 0 )
+		{
+			if( !(bits[key>>5] & mask) )
+			{
+				bits[key>>5] |= mask;
+				this_->heldNotes++;
+			}
+		}
+		else if( status == 0x80 || status == 0x90 )
 		{
-			if( this_->buffersIn[i] )
+			if( bits[key>>5] & mask )
 			{
-				free(this_->buffersIn[i]);
-				this_->buffersIn[i] = NULL;
+				bits[key>>5] &= ~mask;
+				this_->heldNotes--;
 			}
+		}
+		else if( status == 0xB0 && (key == 120 || key == 123) )
+		{
+			// all sound off, all notes off
+			for( int w = 0; w < 4; w++ )
+			{
+				for( ; bits[w]; bits[w] &= bits[w] - 1 )
+					this_->heldNotes--;
+			}
+		}
+	}
+}
+
+
+
+/*****************************************************************************
+ *  the processing
+ *****************************************************************************/
+
+
+
+static void clearOutputBuffers(float** buffersOut, long firstChan, long numChans, long numBytes)
+{
+	int i;
+	for( i = firstChan; i < numChans; i++ )
+	{
+		memset(buffersOut[i], 0, numBytes);
+	}
+}
+
+
 
-			if( this_->buffersOut[i] )
+void callProcess(BASS_VST_PLUGIN* this_, float** buffersIn, float** buffersOut, long numSamples, bool isDouble, bool forwarding)
+{
+	// the buffers contain doubles if isDouble is set, they always have the room for
+	// this.  If the plugin wants the other format, only the plugin's inputs and outputs
+	// are converted in place - as the data originally were floats, this is not lossy.
+	// For editor forwarding, the inputs are used again afterwards and the outputs are
+	// not needed.
+	if( this_->effStartProcessCalled )
+	{
+		// do MIDI processing
+		lockEnter(&this_->midiCritical_, BASS_VST_LOCK_MIDI);
+			if( this_->midiEventsCurr && this_->midiEventsCurr->numEvents )
 			{
-				free(this_->buffersOut[i]);
-				this_->buffersOut[i] = NULL;
+				if( this_->type == VSTinstrument )
+					trackHeldNotes(this_, this_->midiEventsCurr);
+				this_->aeffect->dispatcher(this_->aeffect, effProcessEvents, 0, 0, this_->midiEventsCurr, 0.0);
+
+				// prepare for the next round ... use the other buffer
+				VstEvents* temp = this_->midiEventsCurr; this_->midiEventsCurr = this_->midiEventsPrev; this_->midiEventsPrev = temp;
+				if( this_->midiEventsCurr )
+					this_->midiEventsCurr->numEvents = 0;
 			}
+		LeaveCriticalSection(&this_->midiCritical_);
+
+		long numInputs = this_->aeffect->numInputs < MAX_CHANS? this_->aeffect->numInputs : MAX_CHANS;
+		long numOutputs = this_->aeffect->numOutputs < MAX_CHANS? this_->aeffect->numOutputs : MAX_CHANS;
+		bool useDouble = useDoubleReplacing(this_);
+		bool useReplacing = useDouble || (this_->aeffect->processReplacing
+		 && ( (this_->aeffect->flags & effFlagsCanReplacing) || this_->aeffect->__processDeprecated == NULL));
+		int i;
+
+		// empty the output buffers of the active channels
+		// (normally this is needed only for process() and not for processReplacing();
+		// however, this has to be done even in processReplacing() since some VSTIs
+		// (most notably those from Steinberg... hehe) obviously don't implement 
+		// processReplacing() as a separate function but rather use process()).
+		// The outputs written by plugins flagged by BASS_VST_OPTION_NOCLEAR are not
+		// emptied, nor anything for editor forwarding as the output is not used then.
+		if( !forwarding )
+		{
+			clearOutputBuffers(buffersOut, (this_->noClear && useReplacing)? numOutputs : 0, this_->numActiveOutputs,
+				numSamples * ((isDouble || useDouble)? sizeof(double) : sizeof(float)));
 		}
 
-		this_->bytesPerInOutBuffer = 0;
+		// denormals are flushed to zero while the plugin runs, see BASS_VST_OPTION_FLUSHDENORMALS
+		FP_STATE fpState = 0;
+		if( this_->flushDenormals )
+			fpState = fpFlushDenormals();
+
+		if( useDouble )
+		{
+			// convert the inputs to double
+			if( !isDouble )
+			{
+				for( i = 0; i < numInputs; i++ )
+					cnvFloatToDouble(buffersIn[i], (double*)buffersIn[i], numSamples*sizeof(float));
+			}
+
+			if( this_->antiDenormal )
+				addAntiDenormal(this_, buffersIn, numInputs, numSamples, true);
+
+			this_->aeffect->processDoubleReplacing(this_->aeffect, (double**)buffersIn, (double**)buffersOut, numSamples);
+
+			if( !isDouble )
+			{
+				for( i = 0; forwarding && i < numInputs; i++ )
+					cnvDoubleToFloat((double*)buffersIn[i], buffersIn[i], numSamples*sizeof(double));
+
+				for( i = 0; !forwarding && i < numOutputs; i++ )
+					cnvDoubleToFloat((double*)buffersOut[i], buffersOut[i], numSamples*sizeof(double));
+			}
+		}
+		else
+		{
+			// float processing: convert the inputs to float if needed
+			if( isDouble )
+			{
+				for( i = 0; i < numInputs; i++ )
+					cnvDoubleToFloat((double*)buffersIn[i], buffersIn[i], numSamples*sizeof(double));
+			}
+
+			if( this_->antiDenormal )
+				addAntiDenormal(this_, buffersIn, numInputs, numSamples, false);
+
+			if( useReplacing )
+			{
+				// do the normal float processing
+				this_->aeffect->processReplacing(this_->aeffect, buffersIn, buffersOut, numSamples);
+			}
+			else if( this_->aeffect->__processDeprecated )
+			{
+				// do the "old" float processing - better than the overhead for the double replacing
+				this_->aeffect->__processDeprecated(this_->aeffect, buffersIn, buffersOut, numSamples);
+			}
+
+			if( isDouble )
+			{
+				for( i = 0; forwarding && i < numInputs; i++ )
+					cnvFloatToDouble(buffersIn[i], (double*)buffersIn[i], numSamples*sizeof(float));
+
+				for( i = 0; !forwarding && i < numOutputs; i++ )
+					cnvFloatToDouble(buffersOut[i], (double*)buffersOut[i], numSamples*sizeof(float));
+			}
+		}
+
+		if( this_->flushDenormals )
+			fpRestore(fpState);
+	}
+}
+
+
+
+static void processFixedBlock(BASS_VST_PLUGIN* this_, long numSamples)
+{
+	// the plugin is always called with fixedBlockSize samples: the input is collected
+	// in fixedIn, the output is taken from the last block processed - this adds a
+	// latency of fixedBlockSize samples
+	long done = 0, todo, c;
+	while( done < numSamples )
+	{
+		todo = numSamples - done;
+		if( todo > this_->fixedBlockSize - this_->fixedBlockPos )
+			todo = this_->fixedBlockSize - this_->fixedBlockPos;
+
+		for( c = 0; c < MAX_CHANS; c++ )
+		{
+			if( this_->fixedIn[c] )
+				memcpy(&this_->fixedIn[c][this_->fixedBlockPos], &this_->buffersIn[c][done], todo*sizeof(float));
+
+			if( this_->fixedOut[c] )
+				memcpy(&this_->buffersOut[c][done], &this_->fixedOut[c][this_->fixedBlockPos], todo*sizeof(float));
+		}
+
+		done += todo;
+		this_->fixedBlockPos += todo;
+		if( this_->fixedBlockPos == this_->fixedBlockSize )
+		{
+			if( this_->oversampler.factor )
+				oversampleProcess(this_, this_->fixedIn, this_->fixedOut, this_->fixedBlockSize);
+			else if( this_->resampler.pluginRate )
+				resampleProcess(this_, this_->fixedIn, this_->fixedOut, this_->fixedBlockSize);
+			else
+				callProcess(this_, this_->fixedIn, this_->fixedOut, this_->fixedBlockSize, false, false);
+			this_->fixedBlockPos = 0;
+		}
+	}
+}
+
+
+
+static bool checkWatchdog(BASS_VST_PLUGIN* this_, QWORD processNs, QWORD blockNs)
+{
+	// a single overrun may be caused by the system, so we bypass the plugin only if
+	// it overruns its budget several times in a row; returns true if the plugin was bypassed
+	if( processNs * 100 <= blockNs * this_->watchdogBudget )
+	{
+		this_->watchdogOverruns = 0;
+		return false;
+	}
+
+	this_->watchdogOverruns++;
+	if( this_->watchdogOverruns < this_->watchdogMaxOverruns )
+		return false;
+
+	// same as BASS_VST_SetBypass(), we're already in the critical section
+	this_->watchdogOverruns = 0;
+	this_->doBypass = TRUE;
+	this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+	return true;
+}
+
+
+
+static bool isSilent(const void* buffer, long numValues, bool isPcm16)
+{
+	long i;
+	if( isPcm16 )
+	{
+		const signed short* s = (const signed short*)buffer;
+		long threshold = (long)(s_sleepThreshold * 32768.0F);
+		for( i = 0; i < numValues; i++ )
+		{
+			if( s[i] > threshold || s[i] < -threshold )
+				return false;
+		}
+	}
+	else
+	{
+		const float* f = (const float*)buffer;
+		float threshold = s_sleepThreshold;
+		for( i = 0; i < numValues; i++ )
+		{
+			if( f[i] > threshold || f[i] < -threshold )
+				return false;
+		}
 	}
+	return true;
+}
+
+
+
+static bool hasPendingMidi(BASS_VST_PLUGIN* this_)
+{
+	// the events are queued by other threads, see BASS_VST_ProcessEvent()
+	lockEnter(&this_->midiCritical_, BASS_VST_LOCK_MIDI);
+		bool pending = (this_->midiEventsCurr && this_->midiEventsCurr->numEvents);
+	LeaveCriticalSection(&this_->midiCritical_);
+	return pending;
+}
+
+
+
+static QWORD getSleepTail(BASS_VST_PLUGIN* this_, DWORD freq)
+{
+	// the tail of the last sound in samples at the channel's rate
+	QWORD tail = this_->sleepTail > 1? (QWORD)(this_->sleepTail / pluginRateRatio(this_)) : 0; // the plugin reports samples at its rate
+	if( this_->sleepTail == 0 )
+		tail = (QWORD)this_->sleepDefaultTail * freq / 1000;
+	return tail;
+}
+
+
+
+static bool checkSleep(BASS_VST_PLUGIN* this_, const void* buffer, long numValues, bool isPcm16, long numSamples, DWORD freq)
+{
+	// the plugin sleeps if its input was silent for longer than its latency and its tail
+	// and if there are no MIDI events; the first block that is not silent wakes it up
+	// again.  Returns true if the block is not to be processed.
+	bool silent = !hasPendingMidi(this_) && isSilent(buffer, numValues, isPcm16);
+	if( !silent )
+	{
+		this_->silentSamples = 0;
+		this_->sleeping = false;
+		return false;
+	}
+
+	if( !this_->sleeping )
+	{
+		// the output follows the input after the latency, then the tail of the last sound
+		// follows; sleep if this block only contains the output of silence
+		QWORD tail = getSleepTail(this_, freq) + getTotalLatency(this_);
+		if( this_->silentSamples < tail )
+		{
+			this_->silentSamples += numSamples;
+			return false;
+		}
+
+		this_->sleeping = true;
+		this_->stats.sleeps++;
+	}
+
+	this_->silentSamples += numSamples;
+	this_->stats.sleepSamples += numSamples;
+	return true;
+}
+
+
+
+static bool checkInstrumentSleep(BASS_VST_PLUGIN* this_, long numSamples)
+{
+	// the input of an instrument is always silent, so it falls asleep by its output, see
+	// checkInstrumentOutput(); only MIDI events wake it up again.  Returns true if the
+	// block is not to be processed.
+	if( !this_->sleeping )
+		return false;
+
+	if( hasPendingMidi(this_) )
+	{
+		this_->silentSamples = 0;
+		this_->sleeping = false;
+		return false;
+	}
+
+	this_->silentSamples += numSamples;
+	this_->stats.sleepSamples += numSamples;
+	return true;
 }
 
 
 
-static bool allocTempBuffer(BASS_VST_PLUGIN* this_, long numBytes)
+static void checkInstrumentOutput(BASS_VST_PLUGIN* this_, const void* buffer, long numValues, bool isPcm16, long numSamples, DWORD freq)
 {
-	if( numBytes > this_->bytesTempBuffer )
+	// called after a block was rendered: the instrument sleeps from the next block on if
+	// no key is down and its output was silent for longer than its tail - this keeps
+	// releases, echoes and arpeggiators pausing between notes alive
+	if( this_->heldNotes > 0 || !isSilent(buffer, numValues, isPcm16) )
 	{
-		freeTempBuffer(this_);
-
-		if( (this_->bufferTemp = (float*)malloc(numBytes)) == NULL )
-		{
-			freeTempBuffer(this_);
-			return false;
-		}
-
-		this_->bytesTempBuffer = numBytes;
+		this_->silentSamples = 0;
+		return;
 	}
 
-	return true;
+	this_->silentSamples += numSamples;
+	if( this_->silentSamples >= getSleepTail(this_, freq) )
+	{
+		this_->sleeping = true;
+		this_->stats.sleeps++;
+	}
 }
 
 
 
-void freeTempBuffer(BASS_VST_PLUGIN* this_)
+static bool guardOutput(BASS_VST_PLUGIN* this_, long numChans, long numSamples, bool isDouble)
 {
-	if( this_ )
+	// replace the output by silence if a plugin emits NaN or infinity - this would
+	// poison everything after the plugin; returns false in this case
+	long c;
+	for( c = 0; c < numChans; c++ )
 	{
-		if( this_->bufferTemp )
-		{
-			free(this_->bufferTemp);
-			this_->bufferTemp = NULL;
-		}
-
-		this_->bytesTempBuffer = 0;
+		if( isDouble? !isFiniteDouble((double*)this_->buffersOut[c], numSamples) : !isFinite(this_->buffersOut[c], numSamples) )
+			break;
 	}
+
+	if( c == numChans )
+		return true;
+
+	clearOutputBuffers(this_->buffersOut, 0, numChans, numSamples * (isDouble? sizeof(double) : sizeof(float)));
+	return false;
 }
 
 
 
-/*****************************************************************************
- *  the processing
- *****************************************************************************/
+static void processPlanar(BASS_VST_PLUGIN* this_, long numSamples, DWORD freq, bool isDouble)
+{
+	// the processing from buffersIn to buffersOut, used by processSubBlock() and processOutputs()
+	// the inputs fed by another channel, see BASS_VST_SetSidechain()
+	if( this_->sidechain )
+		sidechainRead(this_, numSamples, isDouble);
 
+	// the time info returned by audioMasterGetTime for this block
+	transportUpdate(this_, freq);
 
+	// copy the input for the editors of the same scope, they're called by the forwarding thread
+	if( this_->forwardRing )
+		forwardWrite(this_, numSamples, isDouble);
 
-static void clearOutputBuffers(BASS_VST_PLUGIN* this_, long numSamples)
-{
-	int i;
-	for( i = 0; i < MAX_CHANS; i++ )
+	// the "real" sound processing
+	if( this_->fixedBlockSize )
+	{
+		processFixedBlock(this_, numSamples);
+	}
+	else if( this_->oversampler.factor )
+	{
+		oversampleProcess(this_, this_->buffersIn, this_->buffersOut, numSamples);
+	}
+	else if( this_->resampler.pluginRate )
+	{
+		resampleProcess(this_, this_->buffersIn, this_->buffersOut, numSamples);
+	}
+	else
 	{
-		if( this_->buffersOut[i] )
-			memset(this_->buffersOut[i], 0, numSamples*sizeof(float)*BUFFER_HEADROOM_MULT);
+		callProcess(this_, this_->buffersIn, this_->buffersOut, numSamples, isDouble, false);
 	}
+	transportAdvance(this_, numSamples);
+
+	if( this_->sidechain )
+		sidechainRelease(this_);
 }
 
 
 
-static void callProcess(BASS_VST_PLUGIN* this_, BASS_VST_PLUGIN* buffers, long numSamples)
+static bool processSubBlock(BASS_VST_PLUGIN* this_, const BASS_CHANNELINFO* channelInfo, void* buffer__, long numSamples,
+							bool cnvPcm2Float, bool cnvStereoToMono, bool cnvMonoToStereo)
 {
-	if( this_->effStartProcessCalled )
-	{
-		// do MIDI processing
-		EnterCriticalSection(&this_->midiCritical_);
-			if( this_->midiEventsCurr && this_->midiEventsCurr->numEvents )
-			{
-				this_->aeffect->dispatcher(this_->aeffect, effProcessEvents, 0, 0, this_->midiEventsCurr, 0.0);
+	// returns false if the output of the plugin was not finite, see guardOutput()
+	float*	floatBuffer;
+	int		i;
+	bool	finite = true;
 
-				// prepare for the next round ... use the other buffer
-				VstEvents* temp = this_->midiEventsCurr; this_->midiEventsCurr = this_->midiEventsPrev; this_->midiEventsPrev = temp;
-				if( this_->midiEventsCurr )
-					this_->midiEventsCurr->numEvents = 0;
-			}
-		LeaveCriticalSection(&this_->midiCritical_);
+	// plugins using processDoubleReplacing() get the data converted directly from and to
+	// our interleaved floats; the fixed block size adapter, the oversampling, the resampling
+	// and the mono conversions are done with floats, then callProcess() converts the data
+	bool	isDouble = useDoubleReplacing(this_) && !this_->fixedBlockSize && !this_->oversampler.factor && !this_->resampler.pluginRate && !cnvStereoToMono && !cnvMonoToStereo;
 
-		if(    this_->aeffect->processReplacing
-		 && ( (this_->aeffect->flags & effFlagsCanReplacing) || this_->aeffect->__processDeprecated == NULL) )
-		{
-			// do the normal float processing
-			this_->aeffect->processReplacing(this_->aeffect, buffers->buffersIn, buffers->buffersOut, numSamples);
-		}
-		else if( this_->aeffect->__processDeprecated )
+	// get the data as floats.
+	// this is not lossy.
+	if( cnvPcm2Float )
+	{
+		cnvPcm16ToFloat((signed short*)buffer__, this_->bufferTemp, numSamples * sizeof(signed short) * channelInfo->chans);
+		floatBuffer = this_->bufferTemp;
+	}
+	else
+	{
+		floatBuffer = (float*)buffer__;
+	}
+
+	// copy the given LRLRLR buffer to the VST LLLRRR buffers
+	// this is not lossy
+	if( isDouble )
+	{
+		long chans = channelInfo->chans, c = 0;
+		float* buffer = (float*)floatBuffer;
+		float* end = &buffer[numSamples * chans];
+		double** in = (double**)this_->buffersIn;
+		i = 0;
+		while( buffer < end )
 		{
-			// do the "old" float processing - better than the overhead for the double replacing
-			this_->aeffect->__processDeprecated(this_->aeffect, this_->buffersIn, this_->buffersOut, numSamples);
+			in[c][i] = *buffer;
+			buffer ++;
+			c++;
+			if( c == chans )
+			{
+				c = 0;
+				i++;
+			}
 		}
-		else if( canDoubleReplacing(this_) )
+
+		for( c = chans; c < this_->numActiveInputs; c++ )
+			memset(in[c], 0, numSamples * sizeof(double));
+	}
+	else
+	{
+		long chans = channelInfo->chans, c = 0;
+		float* buffer = (float*)floatBuffer;
+		float* end = &buffer[numSamples * chans];
+		float** in = this_->buffersIn;
+		i = 0;
+		while( buffer < end )
 		{
-			// convert all buffers to double; the output buffer is already emptied incl. the double headroom
-			double* doubleIn[MAX_CHANS];
-			double* doubleOut[MAX_CHANS];
-			int i;
-			for( i = 0; i < MAX_CHANS; i++ )
+			in[c][i] = *buffer;
+			buffer ++;
+			c++;
+			if( c == chans )
 			{
-				doubleIn[i] = (double*)buffers->buffersIn[i];
-				if( doubleIn[i] )
-					cnvFloatToDouble(buffers->buffersIn[i], doubleIn[i], numSamples*sizeof(float));
-
-				doubleOut[i] = (double*)buffers->buffersOut[i]; 
+				c = 0;
+				i++;
 			}
+		}
+
+		for( c = chans; c < this_->numActiveInputs; c++ )
+			memset(in[c], 0, numSamples * sizeof(float));
+	}
+
+	// special mono-processing effect handling
+	if( cnvStereoToMono )
+	{
+		cnvFloatLLRR_To_Mono(this_->buffersIn[0], this_->buffersIn[1], numSamples,
+			this_->aeffect->numOutputs == 1? 1.0F : 0.5F);
+	}
 
-			// do process double replacing
-			this_->aeffect->processDoubleReplacing(this_->aeffect, doubleIn, doubleOut, numSamples);
+	// from buffersIn to buffersOut
+	processPlanar(this_, numSamples, channelInfo->freq, isDouble);
 
-			// convert all buffers back to floats; this is also needed for the input buffers as 
-			// callProcess() may be called for several instances of effects (eg. for editor forwarding)
-			for( i = 0; i < MAX_CHANS; i++ )
-			{
-				if( doubleIn[i] )
-					cnvDoubleToFloat(doubleIn[i], buffers->buffersIn[i], numSamples*sizeof(double));
+	// special mono-processing effect handling
+	if( cnvMonoToStereo )
+	{
+		cnvFloatLLRR_To_Stereo(this_->buffersOut[0], this_->buffersOut[1], numSamples);
+	}
+
+	// check the channels we take back for NaN and infinity, see BASS_VST_OPTION_NANGUARD
+	if( this_->nanGuard )
+		finite = guardOutput(this_, channelInfo->chans, numSamples, isDouble);
 
-				if( doubleOut[i] )
-					cnvDoubleToFloat(doubleOut[i], buffers->buffersOut[i], numSamples*sizeof(double));
+	// convert the returned data back to our channel representation (LLLLLRRRRR to LRLRLRLR)
+	// this is not lossy (but for doubles)
+	if( isDouble )
+	{
+		long chans = channelInfo->chans, c = 0;
+		float* buffer = (float*)floatBuffer;
+		float* end = &buffer[numSamples * chans];
+		double** out = (double**)this_->buffersOut;
+		i = 0;
+		while( buffer < end )
+		{
+			*buffer = (float)out[c][i];
+			buffer++;
+			c++;
+			if( c == chans )
+			{
+				c = 0;
+				i++;
 			}
 		}
 	}
+	else
+	{
+		long chans = channelInfo->chans, c = 0;
+		float* buffer = (float*)floatBuffer;
+		float* end = &buffer[numSamples * chans];
+		float** out = this_->buffersOut;
+		i = 0;
+		while( buffer < end )
+		{
+			*buffer = out[c][i];
+			buffer++;
+			c++;
+			if( c == chans )
+			{
+				c = 0;
+				i++;
+			}
+		}		
+	}
+
+	// convert the data back to PCM, if needed
+	// this is lossy
+	if( cnvPcm2Float )
+	{
+		cnvFloatToPcm16(floatBuffer, (signed short*)buffer__, numSamples * sizeof(float) * channelInfo->chans);
+	}
+
+	return finite;
 }
 
 
@@ -365,15 +1152,21 @@ void CALLBACK doEffectProcess(HDSP dspHandle, DWORD channelHandle, void* buffer_
 {
 	DWORD				vstHandle = (DWORD)(intptr_t)vstHandle__; // double cast to stop Xcode complaining
 	BASS_CHANNELINFO	channelInfo;
-	int					i;
 	long				requiredInputs;
 	long				requiredOutputs;
 
-	float*				floatBuffer;
-	long				numSamples;
+	long				bytesPerSample;
+	long				totalSamples, numSamples, offset;
 	bool				cnvPcm2Float;
+	bool				cnvStereoToMono = false;
 	bool				cnvMonoToStereo = false;
 
+	QWORD				processNs = 0, blockNs = 0, lockNs;
+	bool				watchdogBypassed = false;
+	bool				finite = true, nanReset = false;
+
+	allocCheckEnter();
+
 	BASS_VST_PLUGIN* this_ = refHandle(vstHandle);
 	if( this_ == NULL || channelHandle != this_->channelHandle || dspHandle != this_->dspHandle || buffer__ == NULL || bufferBytes__ <= 0 )
 		goto Cleanup; // error already logged
@@ -391,56 +1184,35 @@ void CALLBACK doEffectProcess(HDSP dspHandle, DWORD channelHandle, void* buffer_
 	if( (long)channelInfo.chans > requiredOutputs )
 		requiredOutputs = channelInfo.chans;
 
-	// get the data as floats.
-	// this is not lossy.
+	// the buffers are allocated by openProcess(), the audio thread never allocates
+	// memory - if the buffers are not there, the data are left unprocessed.  We do
+	// not allocate bigger buffers for bigger blocks (nor call effMainsChanged() for
+	// this) but process the data in sub-blocks of at most effBlockSize samples.
+	if( this_->buffersIn == NULL
+	 || this_->bytesPerInOutBuffer <= 0
+	 || requiredInputs > this_->numActiveInputs
+	 || requiredOutputs > this_->numActiveOutputs )
+		goto Cleanup;
+
 	cnvPcm2Float = ((channelInfo.flags&BASS_SAMPLE_FLOAT)==0 && (this_->type==VSTinstrument || BASS_GetConfig(BASS_CONFIG_FLOATDSP)==0));
 	if( cnvPcm2Float )
 	{
 		if( channelInfo.flags & BASS_SAMPLE_8BITS )
 			goto Cleanup; // can't and won't do this
 
-		if( !allocTempBuffer(this_, bufferBytes__*2) )
+		if( this_->bytesTempBuffer < this_->effBlockSize * (long)channelInfo.chans * (long)sizeof(float) )
 			goto Cleanup;
-		cnvPcm16ToFloat((signed short*)buffer__, this_->bufferTemp, bufferBytes__);
 
-		floatBuffer = this_->bufferTemp;
-		numSamples = (bufferBytes__ / sizeof(signed short)) / channelInfo.chans;
+		bytesPerSample = sizeof(signed short);
 	}
 	else
 	{
-		floatBuffer = (float*)buffer__;
-		numSamples = (bufferBytes__ / sizeof(float)) / channelInfo.chans;
+		bytesPerSample = sizeof(float);
 	}
 
-	if( numSamples <= 0 )
-		goto Cleanup;
-
-	// copy the given LRLRLR buffer to the VST LLLRRR buffers
-	// this is not lossy
-	if( !allocChanBuffers(this_, requiredInputs, requiredOutputs, numSamples*sizeof(float)) )
+	totalSamples = (bufferBytes__ / bytesPerSample) / channelInfo.chans;
+	if( totalSamples <= 0 )
 		goto Cleanup;
-	
-	{
-		long chans = channelInfo.chans, c = 0;
-		float* buffer = (float*)floatBuffer;
-		float* end = &buffer[numSamples * chans];
-		float** in = this_->buffersIn;
-		i = 0;
-		while( buffer < end )
-		{
-			in[c][i] = *buffer;
-			buffer ++;
-			c++;
-			if( c == chans )
-			{
-				c = 0;
-				i++;
-			}
-		}
-
-		for( c = chans; c < requiredInputs; c++ )
-			memset(in[c], 0, numSamples * sizeof(float));
-	}
 
 	// special mono-processing effect handling
 	if(   this_->aeffect->numInputs == 1
@@ -448,99 +1220,156 @@ void CALLBACK doEffectProcess(HDSP dspHandle, DWORD channelHandle, void* buffer_
 	 &&   channelInfo.chans > 1
 	 && !(this_->createFlags&BASS_VST_KEEP_CHANS) )
 	{
-		cnvFloatLLRR_To_Mono(this_->buffersIn[0], this_->buffersIn[1], numSamples,
-			this_->aeffect->numOutputs == 1? 1.0F : 0.5F);
-		
+		cnvStereoToMono = true;
 		if( this_->aeffect->numOutputs == 1 )
 			cnvMonoToStereo = true;
 	}
 
-	// empty the output buffers and process
-	// (normally this is needed only for process() and not for processReplacing();
-	// however, this has to be done even in processReplacing() since some VSTIs
-	// (most notably those from Steinberg... hehe) obviously don't implement 
-	// processReplacing() as a separate function but rather use process())
+	// process
+	lockNs = getTimeNs();
 	enterVstCritical(this_);
-		if( !this_->doBypass )
+		processNs = getTimeNs();
+		this_->stats.vstLockWaitNs += processNs - lockNs;
+		if( !this_->doBypass && this_->sleepOn
+		 && (this_->type == VSTinstrument? checkInstrumentSleep(this_, totalSamples)
+			: checkSleep(this_, buffer__, totalSamples * channelInfo.chans, cnvPcm2Float, totalSamples, channelInfo.freq)) )
 		{
-			this_->vstTimeInfo.samplePos += numSamples;
-			if( this_->vstTimeInfo.samplePos < 0.0 )
-				this_->vstTimeInfo.samplePos = 0.0;
-
-			EnterCriticalSection(&s_forwardCritical);
-				for( i = 0; i < this_->forwardDataToOtherCnt; i++ )
-				{
-					clearOutputBuffers(this_, numSamples);
-					BASS_VST_PLUGIN* other_ = refHandle(this_->forwardDataToOtherVstHandles[i]);
-						if( other_ )
-						{
-							if( tryEnterVstCritical(other_) )
-							{
-								callProcess(other_, this_/*buffers to use*/, numSamples);
-								leaveVstCritical(other_);
-							}
-						}
-					unrefHandle(this_->forwardDataToOtherVstHandles[i]);
-				}
-			LeaveCriticalSection(&s_forwardCritical);
-
-			// the "real" sound processing (the one above is only for the editors to get data)
-			clearOutputBuffers(this_, numSamples);
-			callProcess(this_, this_/*buffers to use*/, numSamples);
-
-			// special mono-processing effect handling
-			if( cnvMonoToStereo )
+			// the plugin sleeps, see BASS_VST_OPTION_SLEEP
+			memset(buffer__, 0, totalSamples * channelInfo.chans * bytesPerSample);
+			transportAdvance(this_, totalSamples);
+			if( this_->sidechain )
+				sidechainSkip(this_, totalSamples);
+		}
+		else if( !this_->doBypass )
+		{
+			for( offset = 0; offset < totalSamples; offset += numSamples )
 			{
-				cnvFloatLLRR_To_Stereo(this_->buffersOut[0], this_->buffersOut[1], numSamples);
+				numSamples = totalSamples - offset;
+				if( numSamples > this_->effBlockSize )
+					numSamples = this_->effBlockSize;
+
+				if( !processSubBlock(this_, &channelInfo, (char*)buffer__ + offset * channelInfo.chans * bytesPerSample, numSamples,
+						cnvPcm2Float, cnvStereoToMono, cnvMonoToStereo) )
+					finite = false;
 			}
 
-			// convert the returned data back to our channel representation (LLLLLRRRRR to LRLRLRLR)
-			// this is not lossy
+			if( !finite )
 			{
-				long chans = channelInfo.chans, c = 0;
-				float* buffer = (float*)floatBuffer;
-				float* end = &buffer[numSamples * chans];
-				float** out = this_->buffersOut;
-				i = 0;
-				while( buffer < end )
+				// the output was replaced by silence; reset the plugin as BASS_VST_Resume() does if wanted
+				this_->stats.nonFiniteBlocks++;
+				if( this_->nanGuard == NAN_GUARD_RESET )
 				{
-					*buffer = out[c][i];
-					buffer++;
-					c++;
-					if( c == chans )
-					{
-						c = 0;
-						i++;
-					}
-				}		
+					this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+					this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
+					nanReset = true;
+				}
 			}
 
-			// convert the data back to PCM, if needed
-			// this is lossy
-			if( cnvPcm2Float )
+			if( this_->type == VSTinstrument && this_->sleepOn )
+				checkInstrumentOutput(this_, buffer__, totalSamples * channelInfo.chans, cnvPcm2Float, totalSamples, channelInfo.freq);
+
+			processNs = getTimeNs() - processNs;
+			statsAddBlock(this_, totalSamples, processNs);
+			if( this_->watchdogBudget )
 			{
-				cnvFloatToPcm16(floatBuffer, (signed short*)buffer__, numSamples * sizeof(float) * channelInfo.chans);
+				blockNs = (QWORD)totalSamples * 1000000000 / channelInfo.freq;
+				watchdogBypassed = checkWatchdog(this_, processNs, blockNs);
 			}
 		}
+		else
+		{
+			// keep the chain aligned while bypassed, see BASS_VST_OPTION_BYPASSDELAY
+			if( this_->bypassDelay.buffer )
+				delayLineProcess(&this_->bypassDelay, buffer__, bufferBytes__);
+			if( this_->sidechain )
+				sidechainSkip(this_, totalSamples);
+		}
 	leaveVstCritical(this_);
+
+	// the automatic bypass changes the latency of the chain, the reset may change the plugin's;
+	// the compensation is updated by the idle routine, it must not be done on the audio thread
+	if( watchdogBypassed || nanReset )
+	{
+		this_->needsIdle |= NEEDS_LATENCY_UPDATE;
+		updateIdleTimers(this_);
+	}
+
+	// inform the user about the bypass - outside of the critical section, the user may call other functions
+	if( watchdogBypassed && this_->callback )
+		this_->callback(vstHandle, BASS_VST_WATCHDOG_BYPASSED, (DWORD)(processNs/1000), (DWORD)(blockNs/1000), this_->callbackUserData);
+
+	if( !finite && this_->callback )
+		this_->callback(vstHandle, BASS_VST_NONFINITE_OUTPUT, this_->stats.nonFiniteBlocks, nanReset? 1 : 0, this_->callbackUserData);
 	
 	// done
 Cleanup:
 	unrefHandle(vstHandle);
+	allocCheckLeave();
 }
 
 
 
 
-DWORD CALLBACK doInstrumentProcess(HSTREAM vstHandle, void* buffer, DWORD bufferBytes, USERPTR user /*not used for VST instruments*/)
+void processOutputs(BASS_VST_PLUGIN* this_, long numSamples, DWORD freq, PROCESS_EVENTS* events)
+{
+	// called by the output streams of an instrument with the plugin locked, see
+	// bass_vst_outputs.cpp: renders one block of all outputs to buffersOut (which point
+	// to the shared outputs then) as doEffectProcess() does for one stream
+	long c;
+	if( this_->doBypass )
+	{
+		clearOutputBuffers(this_->buffersOut, 0, this_->numActiveOutputs, numSamples * sizeof(float));
+		transportAdvance(this_, numSamples);
+		return;
+	}
+
+	for( c = 0; c < this_->numActiveInputs; c++ )
+		memset(this_->buffersIn[c], 0, numSamples * sizeof(float));
+
+	QWORD processNs = getTimeNs();
+	processPlanar(this_, numSamples, freq, false);
+
+	if( this_->nanGuard && !guardOutput(this_, this_->numActiveOutputs, numSamples, false) )
+	{
+		this_->stats.nonFiniteBlocks++;
+		events->nonFinite = true;
+		if( this_->nanGuard == NAN_GUARD_RESET )
+		{
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
+			events->nanReset = true;
+		}
+	}
+
+	processNs = getTimeNs() - processNs;
+	statsAddBlock(this_, numSamples, processNs);
+	if( this_->watchdogBudget )
+	{
+		QWORD blockNs = (QWORD)numSamples * 1000000000 / freq;
+		if( checkWatchdog(this_, processNs, blockNs) )
+		{
+			events->watchdogBypassed = true;
+			events->processNs = processNs;
+			events->blockNs = blockNs;
+		}
+	}
+}
+
+
+
+DWORD CALLBACK doInstrumentProcess(HSTREAM vstHandle, void* buffer, DWORD bufferBytes, USERPTR /*user, not used for VST instruments*/)
 {
 	// check for common errors and init the buffer to silence (needed if processReplacing() is not available)
 	if( bufferBytes <= 0 || buffer == NULL )
 		return 0;
 	memset(buffer, 0, bufferBytes);
 
+	// if the outputs are split into several streams, the instrument is rendered once for all of them
+	if( outputsProcess(vstHandle, vstHandle, buffer, bufferBytes) )
+		return bufferBytes;
+
 	// now, we can do the same processing as for VST effects :-)
-	doEffectProcess(0, vstHandle, buffer, bufferBytes, (USERPTR)vstHandle);
+	doEffectProcess(0, vstHandle, buffer, bufferBytes, (USERPTR)(intptr_t)vstHandle);
 
 	return bufferBytes;
 }
@@ -548,6 +1377,121 @@ DWORD CALLBACK doInstrumentProcess(HSTREAM vstHandle, void* buffer, DWORD buffer
 
 
 
+long s_maxBlockSize = DEFAULT_MAX_BLOCK_SIZE;
+
+
+
+bool s_largePages = false;
+
+
+
+DWORD s_sleepThresholdDb = DEFAULT_SLEEP_THRESHOLD;
+float s_sleepThreshold = (float)pow(10.0, -DEFAULT_SLEEP_THRESHOLD/20.0);
+
+
+
+DWORD setFixedBlockSize(BASS_VST_PLUGIN* this_, long blockSize)
+{
+	// the buffers are allocated outside of the critical section; as the plugin's block
+	// size changes, it is suspended and resumed (same as done by callMainsChanged())
+	BUFFER_ARENA newArena;
+	float** newIn = NULL, **newOut = NULL;
+	int i, numBuffers = 0;
+
+	if( blockSize < 0 || blockSize > MAX_MAX_BLOCK_SIZE )
+		return BASS_ERROR_ILLPARAM;
+
+	if( blockSize && this_->buffersIn == NULL )
+		return BASS_ERROR_NOTAVAIL; // no channel assigned
+
+	memset(&newArena, 0, sizeof(newArena));
+	if( blockSize )
+	{
+		// the same layout as the channel buffers, see allocProcessBuffers()
+		size_t pointerBytes = arenaStride(2*MAX_CHANS*sizeof(float*));
+		size_t stride = arenaStride(blockSize*sizeof(float)*BUFFER_HEADROOM_MULT);
+		for( i = 0; i < MAX_CHANS; i++ )
+		{
+			if( this_->buffersIn[i] )	numBuffers++;
+			if( this_->buffersOut[i] )	numBuffers++;
+		}
+
+		if( !arenaAlloc(&newArena, pointerBytes + stride*numBuffers) )
+			return BASS_ERROR_MEM;
+
+		BYTE* p = newArena.mem;
+		newIn = (float**)p;
+		newOut = newIn + MAX_CHANS;
+		p += pointerBytes;
+		for( i = 0; i < MAX_CHANS; i++ )
+			if( this_->buffersIn[i] )	{ newIn[i] = (float*)p; p += stride; }
+		for( i = 0; i < MAX_CHANS; i++ )
+			if( this_->buffersOut[i] )	{ newOut[i] = (float*)p; p += stride; }
+	}
+
+	enterVstCritical(this_);
+
+		BUFFER_ARENA oldArena = this_->fixedArena;
+		this_->fixedArena = newArena;
+		newArena = oldArena;
+		this_->fixedIn = newIn;
+		this_->fixedOut = newOut;
+		this_->fixedBlockSize = blockSize;
+		this_->fixedBlockPos = 0;
+
+		if( this_->effStartProcessCalled )
+		{
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effSetBlockSize, 0, getPluginBlockSize(this_, blockSize? blockSize : this_->effBlockSize), NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
+		}
+
+	leaveVstCritical(this_);
+
+	// free the old buffers
+	arenaFree(&newArena);
+	return BASS_OK;
+}
+
+
+
+void freeFixedBlockBuffers(BASS_VST_PLUGIN* this_)
+{
+	this_->fixedIn = NULL;
+	this_->fixedOut = NULL;
+	arenaFree(&this_->fixedArena);
+	this_->fixedBlockSize = 0;
+}
+
+
+
+long getTotalLatency(BASS_VST_PLUGIN* this_)
+{
+	if( this_->aeffect == NULL )
+		return 0;
+
+	// the plugin's own latency plus the one added by BASS_VST; if oversampled or resampled,
+	// the plugin reports its latency in samples at its rate
+	long latency = (long)((double)this_->aeffect->initialDelay / pluginRateRatio(this_) + this_->oversampler.latency + 0.5);
+	latency += this_->resampler.latency;
+	latency += this_->fixedBlockSize;
+	return latency;
+}
+
+
+
+long getPluginBlockSize(BASS_VST_PLUGIN* this_, long blockSize)
+{
+	// the number of samples given to the plugin per block varies if resampled
+	if( this_->oversampler.factor )
+		return blockSize * this_->oversampler.factor;
+	if( this_->resampler.pluginRate )
+		return (long)ceil(blockSize * this_->resampler.ratio) + 2;
+	return blockSize;
+}
+
+
+
 bool openProcess(BASS_VST_PLUGIN* this_, BASS_VST_PLUGIN* info_)
 {
 	// really not yet opened?
@@ -569,6 +1513,25 @@ bool openProcess(BASS_VST_PLUGIN* this_, BASS_VST_PLUGIN* info_)
 		return false; // error already logged
 	}
 
+	// preallocate the buffers for the largest block and the MIDI event lists, this also
+	// sets the block size of the plugin; larger blocks are split by doEffectProcess().  Plugins only getting data
+	// forwarded for their editors use the buffers and the block size of info_.
+	if( this_ == info_ )
+	{
+		long chans = channelInfo.chans > 0? channelInfo.chans : 1;
+		long requiredInputs = this_->aeffect->numInputs > chans? this_->aeffect->numInputs : chans;
+		long requiredOutputs = this_->aeffect->numOutputs > chans? this_->aeffect->numOutputs : chans;
+		this_->maxBlockSize = s_maxBlockSize;
+		long tempSamples = (channelInfo.flags&BASS_SAMPLE_FLOAT)? 0 : this_->maxBlockSize * chans;
+		if( !allocProcessBuffers(this_, requiredInputs, requiredOutputs, this_->maxBlockSize, tempSamples)
+		 || !allocMidiEvents(this_) )
+		{
+			return false;
+		}
+		this_->numActiveInputs = requiredInputs;
+		this_->numActiveOutputs = requiredOutputs;
+	}
+
 	enterVstCritical(this_);
 
 		// connect the inputs and outputs
@@ -589,6 +1552,9 @@ bool openProcess(BASS_VST_PLUGIN* this_, BASS_VST_PLUGIN* info_)
 		this_->aeffect->dispatcher(this_->aeffect, effStartProcess, 0, 0, NULL, 0.0);
 		this_->effStartProcessCalled = true;
 
+		// the tail is needed for the sleep mode, see checkSleep()
+		this_->sleepTail = (long)this_->aeffect->dispatcher(this_->aeffect, effGetTailSize, 0, 0, NULL, 0.0);
+
 	leaveVstCritical(this_);
 
 	return true;
@@ -0,0 +1,388 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_resample.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Running plugins at a sample rate other than the channel's
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the data are resampled to the plugin's rate before the plugin is
+ *	called and back to the channel's rate afterwards, by a windowed sinc
+ *	filter in polyphase form: the filter is tabled for RESAMPLE_PHASES
+ *	fractional positions, the output is interpolated linearly between the
+ *	two nearest ones.  The cutoff is below the lower of both rates, so
+ *	the filter gets longer when converting to a lower rate.
+ *
+ *	As the rates are not multiples of each other, the number of samples
+ *	given to the plugin varies from block to block.  The conversion back
+ *	always has to return the number of samples given by BASS, for this,
+ *	it is primed with some silence - its length is chosen so that the
+ *	whole latency is an integral number of samples at the channel's rate,
+ *	which is added to initialDelay, see getTotalLatency().
+ *
+ *	All buffers and the filter tables are allocated when the option is
+ *	set, never by the audio thread.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || (defined(__i386__) && defined(__SSE__))
+#define FP_SSE
+#include <xmmintrin.h>
+#endif
+
+
+
+#define RESAMPLE_PHASES			256
+#define RESAMPLE_TAPS			32		// at the lower rate, a multiple of 4
+#define RESAMPLE_KAISER_BETA	8.0
+#define RESAMPLE_BANDWIDTH		0.9		// of the nyquist frequency of the lower rate
+#define RESAMPLE_MAX_RATIO		8
+#define RESAMPLE_PI				3.14159265358979323846
+
+
+
+/*****************************************************************************
+ *  filters
+ *****************************************************************************/
+
+
+
+static double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for( int k = 1; k < 50; k++ )
+	{
+		term *= (x / (2.0*k)) * (x / (2.0*k));
+		sum += term;
+	}
+	return sum;
+}
+
+
+
+static long getNumTaps(long fromRate, long toRate)
+{
+	// the filter covers RESAMPLE_TAPS samples of the lower rate
+	double ratio = fromRate > toRate? (double)fromRate / toRate : 1.0;
+	return ((long)ceil(RESAMPLE_TAPS * ratio) + 3) & ~3L;
+}
+
+
+
+static void initFilter(RESAMPLE_FILTER* f, long fromRate, long toRate, float* table)
+{
+	// row p of the table is the filter for an output at the fractional position
+	// p/RESAMPLE_PHASES after the input sample numTaps/2-1 of the row
+	long numTaps = getNumTaps(fromRate, toRate), p, k;
+	double cutoff = (fromRate > toRate? (double)toRate / fromRate : 1.0) * RESAMPLE_BANDWIDTH; // relative to fromRate/2
+	double norm = besselI0(RESAMPLE_KAISER_BETA);
+
+	f->numTaps = numTaps;
+	f->step = (double)fromRate / toRate;
+	f->table = table;
+
+	for( p = 0; p <= RESAMPLE_PHASES; p++ )
+	{
+		for( k = 0; k < numTaps; k++ )
+		{
+			double x = k - (numTaps/2 - 1) - (double)p / RESAMPLE_PHASES;
+			double w = 1.0 - (x / (numTaps/2)) * (x / (numTaps/2));
+			double sinc = x == 0.0? 1.0 : sin(RESAMPLE_PI * cutoff * x) / (RESAMPLE_PI * cutoff * x);
+			table[p*numTaps + k] = (float)(cutoff * sinc * (w > 0.0? besselI0(RESAMPLE_KAISER_BETA * sqrt(w)) / norm : 0.0));
+		}
+	}
+}
+
+
+
+static inline float dotProduct(const float* x, const float* coeff, long numTaps)
+{
+	// numTaps is a multiple of 4
+#if defined(FP_SSE)
+	__m128 sum = _mm_setzero_ps();
+	for( long i = 0; i < numTaps; i += 4 )
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&x[i]), _mm_loadu_ps(&coeff[i])));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+#else
+	float sum0 = 0.0F, sum1 = 0.0F, sum2 = 0.0F, sum3 = 0.0F;
+	for( long i = 0; i < numTaps; i += 4 )
+	{
+		sum0 += x[i  ] * coeff[i  ];
+		sum1 += x[i+1] * coeff[i+1];
+		sum2 += x[i+2] * coeff[i+2];
+		sum3 += x[i+3] * coeff[i+3];
+	}
+	return (sum0 + sum1) + (sum2 + sum3);
+#endif
+}
+
+
+
+/*****************************************************************************
+ *  streams
+ *****************************************************************************/
+
+
+
+// a stream consists of a history per channel and the position of the next output
+// in it, given in input samples; the position and the history length are the same
+// for all channels and are updated by resampleAdvance() after all channels are done
+
+static long countOutputs(const RESAMPLE_FILTER* f, long available, double pos)
+{
+	// the number of outputs that can be calculated from the available input; all input
+	// is present for positions before limit
+	double limit = (double)(available - f->numTaps/2);
+	if( pos >= limit )
+		return 0;
+	return (long)ceil((limit - pos) / f->step);
+}
+
+
+
+static void resampleChannel(const RESAMPLE_FILTER* f, float* history, long histLen, const float* src, long numSamples,
+							double pos, float* dst, long count, float* work)
+{
+	// work has room for the history, the input and numTaps samples of silence used if
+	// the input does not suffice (which does not happen as long as the stream is primed)
+	long	numTaps = f->numTaps, n, available = histLen + numSamples;
+	memcpy(work, history, histLen*sizeof(float));
+	memcpy(&work[histLen], src, numSamples*sizeof(float));
+	memset(&work[available], 0, numTaps*sizeof(float));
+
+	for( n = 0; n < count; n++ )
+	{
+		double	npos = pos + n * f->step;
+		double	ipos = floor(npos);
+		float	phase = (float)((npos - ipos) * RESAMPLE_PHASES);
+		long	row = (long)phase;
+		long	first = (long)ipos - numTaps/2 + 1;
+		if( row >= RESAMPLE_PHASES )
+			row = RESAMPLE_PHASES - 1; // rounding
+		if( first > available )
+			first = available; // underrun, use silence
+
+		const float* x = &work[first];
+		float y0 = dotProduct(x, &f->table[row*numTaps], numTaps);
+		float y1 = dotProduct(x, &f->table[(row+1)*numTaps], numTaps);
+		dst[n] = y0 + (y1 - y0) * (phase - row);
+	}
+
+	// keep the input still needed for the next block
+	long keep = (long)floor(pos + count * f->step) - numTaps/2 + 1;
+	if( keep > available )
+		keep = available;
+	memmove(history, &work[keep], (available - keep)*sizeof(float));
+}
+
+
+
+static void resampleAdvance(const RESAMPLE_FILTER* f, long* histLen, long numSamples, double* pos, long count)
+{
+	// the same as done by resampleChannel()
+	long available = *histLen + numSamples;
+	*pos += count * f->step;
+	long keep = (long)floor(*pos) - f->numTaps/2 + 1;
+	if( keep > available )
+		keep = available;
+	*histLen = available - keep;
+	*pos -= keep;
+}
+
+
+
+/*****************************************************************************
+ *  processing, audio thread
+ *****************************************************************************/
+
+
+
+void resampleProcess(BASS_VST_PLUGIN* this_, float** buffersIn, float** buffersOut, long numSamples)
+{
+	RESAMPLER*	rs = &this_->resampler;
+	long		c;
+
+	// the number of samples given to the plugin is the same for all channels, also for
+	// instruments without any input
+	long count = countOutputs(&rs->toPlugin, rs->inHistLen + numSamples, rs->inPos);
+	if( numSamples > rs->blockSize
+	 || count > rs->pluginBlockSize
+	 || rs->numInputs < this_->numActiveInputs
+	 || rs->numOutputs < this_->numActiveOutputs )
+	{
+		// cannot happen, the buffers are allocated for the largest block and all channels
+		for( c = 0; c < this_->numActiveOutputs; c++ )
+			memset(buffersOut[c], 0, numSamples*sizeof(float));
+		return;
+	}
+
+	long numInputs = this_->aeffect->numInputs < rs->numInputs? this_->aeffect->numInputs : rs->numInputs;
+	long numOutputs = this_->aeffect->numOutputs < rs->numOutputs? this_->aeffect->numOutputs : rs->numOutputs;
+
+	// to the plugin's rate
+	for( c = 0; c < numInputs; c++ )
+	{
+		resampleChannel(&rs->toPlugin, &rs->inHistory[c*rs->histCapacity], rs->inHistLen, buffersIn[c], numSamples,
+			rs->inPos, rs->in[c], count, rs->work);
+	}
+	resampleAdvance(&rs->toPlugin, &rs->inHistLen, numSamples, &rs->inPos, count);
+
+	if( count > 0 )
+		callProcess(this_, rs->in, rs->out, count, false, false);
+
+	// back to the channel's rate; exactly numSamples are needed here
+	for( c = 0; c < numOutputs; c++ )
+	{
+		resampleChannel(&rs->fromPlugin, &rs->outHistory[c*rs->histCapacity], rs->outHistLen, rs->out[c], count,
+			rs->outPos, buffersOut[c], numSamples, rs->work);
+	}
+	resampleAdvance(&rs->fromPlugin, &rs->outHistLen, count, &rs->outPos, numSamples);
+
+	// callProcess() has emptied the other outputs at the plugin's rate only
+	for( c = numOutputs; c < rs->numOutputs; c++ )
+		memset(buffersOut[c], 0, numSamples*sizeof(float));
+}
+
+
+
+/*****************************************************************************
+ *  setting the rate
+ *****************************************************************************/
+
+
+
+static bool allocResampler(RESAMPLER* rs, long pluginRate, long channelRate, long numInputs, long numOutputs, long blockSize)
+{
+	// the layout of the buffers is the same as for the channel buffers, see
+	// allocProcessBuffers(); the plugin may convert its buffers to doubles in place
+	memset(rs, 0, sizeof(RESAMPLER));
+	if( pluginRate == 0 || pluginRate == channelRate )
+		return true;
+
+	long tapsToPlugin = getNumTaps(channelRate, pluginRate);
+	long tapsFromPlugin = getNumTaps(pluginRate, channelRate);
+
+	// the conversion back must be primed by the look-ahead of both filters, then the
+	// latency is rounded up to whole samples at the channel's rate; the fractional
+	// rest is given by the start position
+	double ratio = (double)pluginRate / channelRate;
+	double minPrime = tapsFromPlugin/2 + ceil(tapsToPlugin/2 * ratio) + 2;
+	long latency = (long)ceil(minPrime / ratio);
+	long prime = (long)ceil(latency * ratio);
+
+	rs->pluginRate = pluginRate;
+	rs->channelRate = channelRate;
+	rs->ratio = ratio;
+	rs->numInputs = numInputs;
+	rs->numOutputs = numOutputs;
+	rs->blockSize = blockSize;
+	rs->pluginBlockSize = (long)ceil(blockSize * ratio) + 2;
+	rs->latency = latency;
+	rs->histCapacity = (tapsToPlugin > tapsFromPlugin? tapsToPlugin : tapsFromPlugin) + prime + 8;
+
+	long maxSamples = blockSize > rs->pluginBlockSize? blockSize : rs->pluginBlockSize;
+	size_t pointerBytes = arenaStride(2*MAX_CHANS*sizeof(float*));
+	size_t stride = arenaStride(rs->pluginBlockSize*sizeof(float)*BUFFER_HEADROOM_MULT);
+	size_t tableBytes = arenaStride((RESAMPLE_PHASES+1)*(tapsToPlugin+tapsFromPlugin)*sizeof(float));
+	size_t historyBytes = arenaStride((numInputs+numOutputs)*rs->histCapacity*sizeof(float));
+	size_t workBytes = arenaStride((rs->histCapacity + maxSamples + (tapsToPlugin > tapsFromPlugin? tapsToPlugin : tapsFromPlugin))*sizeof(float));
+	if( !arenaAlloc(&rs->arena, pointerBytes + stride*(numInputs+numOutputs) + tableBytes + historyBytes + workBytes) )
+	{
+		memset(rs, 0, sizeof(RESAMPLER));
+		return false;
+	}
+
+	BYTE* p = rs->arena.mem;
+	long i;
+	rs->in = (float**)p;
+	rs->out = rs->in + MAX_CHANS;
+	p += pointerBytes;
+	for( i = 0; i < numInputs; i++, p += stride )
+		rs->in[i] = (float*)p;
+	for( i = 0; i < numOutputs; i++, p += stride )
+		rs->out[i] = (float*)p;
+
+	initFilter(&rs->toPlugin, channelRate, pluginRate, (float*)p);
+	initFilter(&rs->fromPlugin, pluginRate, channelRate, (float*)p + (RESAMPLE_PHASES+1)*tapsToPlugin);
+	p += tableBytes;
+	rs->inHistory = (float*)p;
+	rs->outHistory = rs->inHistory + numInputs*rs->histCapacity;
+	p += historyBytes;
+	rs->work = (float*)p;
+
+	// start with silence so that the first output is calculated at the start of the
+	// input; the histories are already zeroed by arenaAlloc()
+	rs->inHistLen = tapsToPlugin/2 - 1;
+	rs->inPos = tapsToPlugin/2 - 1;
+	rs->outHistLen = tapsFromPlugin/2 - 1 + prime;
+	rs->outPos = tapsFromPlugin/2 - 1 + (prime - latency * ratio);
+	return true;
+}
+
+
+
+DWORD setPluginSampleRate(BASS_VST_PLUGIN* this_, long pluginRate)
+{
+	// the buffers are allocated outside of the critical section; as the sample rate
+	// and the block size of the plugin change, it is suspended and resumed
+	BASS_CHANNELINFO info;
+	RESAMPLER newRs;
+
+	if( pluginRate < 0 )
+		return BASS_ERROR_ILLPARAM;
+
+	if( this_->buffersIn == NULL || !BASS_ChannelGetInfo(this_->channelHandle, &info) )
+		return BASS_ERROR_NOTAVAIL; // no channel assigned
+
+	if( pluginRate && this_->oversampler.factor )
+		return BASS_ERROR_NOTAVAIL; // either oversampling or a fixed rate
+
+	if( pluginRate && ((DWORD)pluginRate * RESAMPLE_MAX_RATIO < info.freq || (DWORD)pluginRate > info.freq * RESAMPLE_MAX_RATIO) )
+		return BASS_ERROR_ILLPARAM;
+
+	long blockSize = this_->fixedBlockSize > this_->effBlockSize? this_->fixedBlockSize : this_->effBlockSize;
+	if( !allocResampler(&newRs, pluginRate, info.freq, this_->numActiveInputs, this_->numActiveOutputs, blockSize) )
+		return BASS_ERROR_MEM;
+
+	enterVstCritical(this_);
+
+		double oldRatio = pluginRateRatio(this_);
+		RESAMPLER oldRs = this_->resampler;
+		this_->resampler = newRs;
+		newRs = oldRs;
+
+		// the transport position is given in samples of the plugin
+		this_->transport.samplePos = floor(this_->transport.samplePos * pluginRateRatio(this_) / oldRatio + 0.5);
+
+		if( this_->effStartProcessCalled )
+		{
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 0/*suspend*/, NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effSetSampleRate, 0, 0, NULL, (float)(info.freq * pluginRateRatio(this_)));
+			this_->aeffect->dispatcher(this_->aeffect, effSetBlockSize, 0, getPluginBlockSize(this_, this_->fixedBlockSize? this_->fixedBlockSize : this_->effBlockSize), NULL, 0.0);
+			this_->aeffect->dispatcher(this_->aeffect, effMainsChanged, 0, 1/*resume*/, NULL, 0.0);
+		}
+
+	leaveVstCritical(this_);
+
+	// free the old buffers
+	arenaFree(&newRs.arena);
+	return BASS_OK;
+}
+
+
+
+void freeResampling(BASS_VST_PLUGIN* this_)
+{
+	arenaFree(&this_->resampler.arena);
+	memset(&this_->resampler, 0, sizeof(RESAMPLER));
+}
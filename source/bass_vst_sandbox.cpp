@@ -0,0 +1,925 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_sandbox.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Out-of-process hosting of plugins (BASS_VST_SANDBOX)
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: a sandboxed plugin is loaded by the helper executable
+ *	bass_vst_sandbox (see bass_vst_sandbox_child.cpp), started with
+ *	posix_spawn() from the directory of libbass_vst.so or as given by the
+ *	environment variable BASS_VST_SANDBOX_EXE.  The host only sees a proxy
+ *	AEffect whose dispatcher(), setParameter(), getParameter() and
+ *	processReplacing() forward the calls to the child - so the rest of
+ *	BASS_VST does not need to know about the sandbox at all.
+ *
+ *	Host and child share one memory block holding the requests, the audio
+ *	buffers and the MIDI events; it is created with shm_open() under a
+ *	unique name, mapped by the child by this name and unlinked as soon as
+ *	the child has answered the first request.  The blocks and all other
+ *	requests have a slot each with one request outstanding at a time, so
+ *	the audio thread never waits for a dispatcher call to be sent or
+ *	answered.  The request/acknowledge counters of the slots and the
+ *	doorbell of the child are incremented with atomic operations and
+ *	double as futex words, so a waiting side is woken up without any other
+ *	lock.  Both sides spin a little bit before they go to sleep, which
+ *	keeps the round trip short if the partner answers quickly.
+ *
+ *	MIDI events given to effProcessEvents and parameter changes are only
+ *	queued in the proxy and delivered together with the next request - the
+ *	next block in most cases - so processing costs exactly one round trip
+ *	per block.  getParameter() is answered from a copy of the values the
+ *	child refreshes after each request, or from the queue for parameters
+ *	not yet delivered.  The audioMaster calls the host needs to know about
+ *	(automation, latency and display changes, window sizes) are queued by
+ *	the child and replayed to the host after the request is answered.
+ *	Chunks larger than the shared data area are transferred in pieces.
+ *
+ *	The audio thread never waits longer than the duration of the block
+ *	(and at least SANDBOX_MIN_BLOCK_TIMEOUT_US): if the child is late, the
+ *	block is silence and the request stays pending; until it is answered,
+ *	the following blocks are silence, too.  Dispatcher calls wait up to
+ *	SANDBOX_TIMEOUT_MS per request.  If the child crashes or does not
+ *	answer a request within SANDBOX_TIMEOUT_MS, it is killed and the proxy
+ *	outputs silence from then on.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_sandbox.h"
+
+#ifdef __linux__
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+
+extern char** environ;
+
+
+
+#define SANDBOX_MIN_BLOCK_TIMEOUT_US	1000	// for tiny blocks, a shorter timeout would only produce dropouts
+#define SANDBOX_WAIT_SLICE_NS			10000000LL	// while waiting, we check this often if the child is still alive
+
+
+
+#define SANDBOX_PARAM_QUEUED			0x01	// set by the host, not yet given to a request
+#define SANDBOX_PARAM_SENT				0x02	// given to a request not yet answered
+
+
+
+typedef struct
+{
+	// the request the caller gave up waiting for, 0 if none; no other request can be
+	// sent in this slot until it is answered or the child is killed at pendingKillAt
+	int					pendingSeq;
+	long long			pendingKillAt;
+	bool				sentParams;		// the request carries the queued parameter changes
+} SANDBOX_SLOT_STATE;
+
+
+
+typedef struct
+{
+	AEffect				aeffect;		// must be the first member, the proxy is casted from AEffect*
+	SANDBOX_SHM*		shm;
+	pid_t				pid;
+	volatile long		dead;
+	CRITICAL_SECTION	critical_;		// one control request at a time
+	audioMasterCallback	hostCallback;
+	char*				chunkData;
+	DWORD				chunkError;		// of the last effGetChunk or effSetChunk, see sandboxChunkError()
+	ERect				editRect;
+	float				sampleRate;		// as set by effSetSampleRate, for the timeout of the blocks
+	SANDBOX_SLOT_STATE	slots[SANDBOX_SLOTS];
+
+	// MIDI events queued by effProcessEvents and parameter changes queued by setParameter(),
+	// copied to the shared memory with the next request
+	CRITICAL_SECTION	queueCritical_;
+	int					numEvents;
+	long				eventBytes;
+	char				events[SANDBOX_EVENT_BYTES];
+	float				params[SANDBOX_MAX_PARAMS];		// the values set by the host, valid if paramState is not 0
+	BYTE				paramState[SANDBOX_MAX_PARAMS];	// SANDBOX_PARAM_QUEUED, SANDBOX_PARAM_SENT
+	VstInt32			queuedParams[SANDBOX_MAX_PARAMS];
+	int					numQueuedParams;
+	bool				paramsSent;		// a request carrying parameter changes is not yet answered
+} SANDBOX;
+
+
+
+static long s_sandboxCount = 0;
+
+
+
+static inline long long sandboxNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+
+static int sandboxPtrKind(VstInt32 opcode)
+{
+	switch( opcode )
+	{
+		case effGetProgramName:
+		case effGetParamLabel:
+		case effGetParamDisplay:
+		case effGetParamName:
+		case effGetProgramNameIndexed:
+		case effGetEffectName:
+		case effGetVendorString:
+		case effGetProductString:
+		case effShellGetNextPlugin:
+			return SANDBOX_PTR_STRING_OUT;
+
+		case effSetProgramName:
+		case effCanDo:
+		case effString2Parameter:
+			return SANDBOX_PTR_STRING_IN;
+
+		case effSetChunk:
+			return SANDBOX_PTR_DATA_IN;
+
+		case effGetChunk:
+			return SANDBOX_PTR_DATA_OUT;
+
+		case effEditGetRect:
+			return SANDBOX_PTR_RECT_OUT;
+
+		default:
+			return SANDBOX_PTR_UNSUPPORTED; // we do not know the size of the data behind the pointer
+	}
+}
+
+
+
+/*****************************************************************************
+ *  talking to the child
+ *****************************************************************************/
+
+
+
+static inline bool sandboxIsDead(SANDBOX* sb)
+{
+	return __sync_fetch_and_add(&sb->dead, 0) != 0;
+}
+
+
+
+static void sandboxKill(SANDBOX* sb)
+{
+	// both slots may give up on the child at the same time, only one of them kills it
+	if( InterlockedCompareExchange(&sb->dead, 1, 0) == 0 )
+	{
+		kill(sb->pid, SIGKILL);
+		waitpid(sb->pid, NULL, 0);
+	}
+}
+
+
+
+static bool sandboxChildExited(SANDBOX* sb)
+{
+	pid_t exited = waitpid(sb->pid, NULL, WNOHANG);
+	if( exited == 0 )
+		return false;
+	if( exited == sb->pid )
+		return true;
+	return kill(sb->pid, 0) != 0; // the application ignores SIGCHLD, so the child is reaped without us
+}
+
+
+
+static bool sandboxWaitAck(SANDBOX* sb, int s, int seq, long long deadline, bool killOnTimeout)
+{
+	SANDBOX_SLOT* slot = &sb->shm->slots[s];
+
+	// spin first, most requests are answered within a few microseconds
+	for( int spin = 0; spin < SANDBOX_SPIN_COUNT; spin++ )
+	{
+		if( slot->ackSeq == seq )
+			return true;
+		cpuRelax();
+	}
+
+	// then sleep; we wake up regularly to check if the child is still alive
+	while( slot->ackSeq != seq )
+	{
+		if( sandboxChildExited(sb) )
+		{
+			InterlockedExchange(&sb->dead, 1); // crashed, already reaped
+			return false;
+		}
+
+		long long left = deadline - sandboxNow();
+		if( left <= 0 )
+		{
+			if( killOnTimeout )
+				sandboxKill(sb);
+			return false;
+		}
+
+		slot->hostWaiting = 1;
+		__sync_synchronize();
+		int ack = slot->ackSeq;
+		if( ack != seq )
+			futexWait(&slot->ackSeq, ack, left < SANDBOX_WAIT_SLICE_NS? left : SANDBOX_WAIT_SLICE_NS);
+		slot->hostWaiting = 0;
+	}
+
+	return true;
+}
+
+
+
+static void sandboxTakeOver(SANDBOX* sb)
+{
+	// take over the plugin state mirrored by the child
+	SANDBOX_SHM* shm = sb->shm;
+	__sync_synchronize();
+	sb->aeffect.numPrograms		= shm->numPrograms;
+	sb->aeffect.numParams		= shm->numParams;
+	sb->aeffect.numInputs		= shm->numInputs;
+	sb->aeffect.numOutputs		= shm->numOutputs;
+	sb->aeffect.initialDelay	= shm->initialDelay;
+	sb->aeffect.uniqueID		= shm->uniqueID;
+	sb->aeffect.version			= shm->version;
+	sb->aeffect.flags			= (shm->flags | effFlagsCanReplacing) & ~(effFlagsHasEditor|effFlagsCanDoubleReplacing);
+}
+
+
+
+static void sandboxTakeParams(SANDBOX* sb, int s)
+{
+	// hand the queued parameter changes to the request of the slot; only one request
+	// carries changes at a time, so the changes cannot overtake each other
+	SANDBOX_SLOT* slot = &sb->shm->slots[s];
+	slot->numParamChanges = 0;
+	EnterCriticalSection(&sb->queueCritical_);
+		if( !sb->paramsSent && sb->numQueuedParams > 0 )
+		{
+			for( int i = 0; i < sb->numQueuedParams; i++ )
+			{
+				VstInt32 index = sb->queuedParams[i];
+				slot->paramChanges[i].index = index;
+				slot->paramChanges[i].value = sb->params[index];
+				sb->paramState[index] = SANDBOX_PARAM_SENT;
+			}
+			slot->numParamChanges = sb->numQueuedParams;
+			sb->numQueuedParams = 0;
+			sb->paramsSent = true;
+			sb->slots[s].sentParams = true;
+		}
+	LeaveCriticalSection(&sb->queueCritical_);
+}
+
+
+
+static void sandboxAnswered(SANDBOX* sb, int s)
+{
+	// called after a request of the slot is answered, also if the caller gave up waiting for it
+	SANDBOX_SLOT* slot = &sb->shm->slots[s];
+	sandboxTakeOver(sb);
+
+	// the child has applied the parameter changes and refreshed shm->params
+	if( sb->slots[s].sentParams )
+	{
+		EnterCriticalSection(&sb->queueCritical_);
+			for( int i = 0; i < slot->numParamChanges; i++ )
+				sb->paramState[slot->paramChanges[i].index] &= ~SANDBOX_PARAM_SENT;
+			sb->paramsSent = false;
+		LeaveCriticalSection(&sb->queueCritical_);
+		sb->slots[s].sentParams = false;
+	}
+
+	// replay the audioMaster calls of the plugin; the caller of the proxy holds the plugin's
+	// lock just as for a plugin calling back from within dispatcher() or processReplacing()
+	for( int i = 0; i < slot->numNotifications; i++ )
+	{
+		SANDBOX_NOTIFICATION* n = &slot->notifications[i];
+		sb->hostCallback(&sb->aeffect, n->opcode, n->index, n->value, NULL, n->opt);
+	}
+	slot->numNotifications = 0;
+}
+
+
+
+static bool sandboxReady(SANDBOX* sb, int s, long long deadline)
+{
+	// returns true if the slot may be filled with a new request, which is not the case
+	// while the child still works on a pending one; the caller owns the slot, see SANDBOX_SLOT_*
+	SANDBOX_SLOT_STATE* state = &sb->slots[s];
+	if( sandboxIsDead(sb) )
+		return false;
+
+	if( state->pendingSeq )
+	{
+		bool answered = sandboxWaitAck(sb, s, state->pendingSeq, deadline < state->pendingKillAt? deadline : state->pendingKillAt, false);
+		if( !answered )
+		{
+			if( !sandboxIsDead(sb) && sandboxNow() >= state->pendingKillAt )
+				sandboxKill(sb);
+			return false;
+		}
+
+		state->pendingSeq = 0; // the output of the late block is thrown away
+		sandboxAnswered(sb, s);
+	}
+
+	return true;
+}
+
+
+
+static bool sandboxCall(SANDBOX* sb, int s, long long deadline, bool isProcess)
+{
+	// the caller has checked sandboxReady() and has filled the request
+	SANDBOX_SHM* shm = sb->shm;
+	sandboxTakeParams(sb, s);
+	int seq = __sync_add_and_fetch(&shm->slots[s].reqSeq, 1); // full barrier, the request is visible to the child now
+	__sync_add_and_fetch(&shm->doorbell, 1);
+	if( shm->childWaiting )
+		futexWake(&shm->doorbell);
+
+	if( !sandboxWaitAck(sb, s, seq, deadline, !isProcess) )
+	{
+		if( isProcess && !sandboxIsDead(sb) )
+		{
+			// the audio thread cannot wait any longer, give the child some more time in the background
+			sb->slots[s].pendingSeq = seq;
+			sb->slots[s].pendingKillAt = sandboxNow() + SANDBOX_TIMEOUT_MS * 1000000LL;
+		}
+		return false;
+	}
+
+	sandboxAnswered(sb, s);
+	return true;
+}
+
+
+
+static long long sandboxCallDeadline()
+{
+	return sandboxNow() + SANDBOX_TIMEOUT_MS * 1000000LL;
+}
+
+
+
+/*****************************************************************************
+ *  the proxy
+ *****************************************************************************/
+
+
+
+static VstIntPtr proxyQueueEvents(SANDBOX* sb, VstEvents* events)
+{
+	EnterCriticalSection(&sb->queueCritical_);
+
+		for( int i = 0; i < events->numEvents; i++ )
+		{
+			VstEvent* e = events->events[i];
+			long bytes = sizeof(VstMidiSysexEvent);
+			if( e->type == kVstSysExType )
+				bytes = (sizeof(VstMidiSysexEvent) + ((VstMidiSysexEvent*)e)->dumpBytes + 7) & ~7;
+
+			if( sb->eventBytes + bytes > SANDBOX_EVENT_BYTES || sb->numEvents >= MAX_MIDI_EVENTS )
+				break; // the event queue of the sandbox is full, drop the rest
+
+			char* p = sb->events + sb->eventBytes;
+			if( e->type == kVstSysExType )
+			{
+				memcpy(p, e, sizeof(VstMidiSysexEvent));
+				memcpy(p + sizeof(VstMidiSysexEvent), ((VstMidiSysexEvent*)e)->sysexDump, ((VstMidiSysexEvent*)e)->dumpBytes);
+			}
+			else
+			{
+				memcpy(p, e, sizeof(VstMidiEvent));
+			}
+
+			sb->eventBytes += bytes;
+			sb->numEvents++;
+		}
+
+	LeaveCriticalSection(&sb->queueCritical_);
+	return 1;
+}
+
+
+
+static bool sandboxPutChunk(SANDBOX* sb, const char* chunk, long bytes)
+{
+	// the caller holds sb->critical_; chunks larger than the data area are put in pieces
+	// before effSetChunk is dispatched, sb->chunkError is set on errors
+	SANDBOX_SLOT* slot = &sb->shm->slots[SANDBOX_SLOT_CONTROL];
+	for( long offset = 0; offset < bytes; offset += SANDBOX_DATA_BYTES )
+	{
+		long pieceBytes = bytes - offset < SANDBOX_DATA_BYTES? bytes - offset : SANDBOX_DATA_BYTES;
+		memcpy(sb->shm->data, chunk + offset, pieceBytes);
+		slot->cmd			= SANDBOX_CMD_CHUNK_PUT;
+		slot->value			= bytes;
+		slot->dataOffset	= offset;
+		slot->dataBytes		= pieceBytes;
+		if( !sandboxCall(sb, SANDBOX_SLOT_CONTROL, sandboxCallDeadline(), false) )
+		{
+			sb->chunkError = BASS_ERROR_NOTAVAIL; // the child is gone
+			return false;
+		}
+		if( slot->error != BASS_OK )
+		{
+			sb->chunkError = slot->error;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+static bool sandboxGetChunk(SANDBOX* sb, long bytes)
+{
+	// the caller holds sb->critical_ and has dispatched effGetChunk; the first piece is
+	// in the data area, the others are got one by one, sb->chunkError is set on errors
+	SANDBOX_SLOT* slot = &sb->shm->slots[SANDBOX_SLOT_CONTROL];
+	char* newData = (char*)realloc(sb->chunkData, bytes);
+	if( newData == NULL )
+	{
+		sb->chunkError = BASS_ERROR_MEM;
+		return false;
+	}
+	sb->chunkData = newData;
+
+	long offset = 0;
+	for( ;; )
+	{
+		if( slot->dataBytes <= 0 || slot->dataBytes > bytes - offset )
+		{
+			sb->chunkError = BASS_ERROR_UNKNOWN; // does not happen unless the child is confused
+			return false;
+		}
+		memcpy(sb->chunkData + offset, sb->shm->data, slot->dataBytes);
+		offset += slot->dataBytes;
+		if( offset == bytes )
+			return true;
+
+		slot->cmd			= SANDBOX_CMD_CHUNK_GET;
+		slot->dataOffset	= offset;
+		if( !sandboxCall(sb, SANDBOX_SLOT_CONTROL, sandboxCallDeadline(), false) )
+		{
+			sb->chunkError = BASS_ERROR_NOTAVAIL;
+			return false;
+		}
+		if( slot->error != BASS_OK )
+		{
+			sb->chunkError = slot->error;
+			return false;
+		}
+	}
+}
+
+
+
+static VstIntPtr proxyDispatcher(AEffect* aeffect, VstInt32 opcode, VstInt32 index, VstIntPtr value, void* ptr, float opt)
+{
+	SANDBOX* sb = (SANDBOX*)aeffect;
+	VstIntPtr ret = 0;
+
+	// editors cannot be embedded across processes
+	if( opcode == effEditOpen || opcode == effEditClose || opcode == effEditIdle )
+		return 0;
+
+	if( opcode == effProcessEvents )
+		return ptr? proxyQueueEvents(sb, (VstEvents*)ptr) : 0;
+
+	int ptrKind = ptr? sandboxPtrKind(opcode) : SANDBOX_PTR_NONE;
+	if( ptrKind == SANDBOX_PTR_UNSUPPORTED )
+		return 0;
+
+	EnterCriticalSection(&sb->critical_);
+
+		if( opcode == effSetSampleRate && opt > 0.0F )
+			sb->sampleRate = opt;
+		if( ptrKind == SANDBOX_PTR_DATA_IN || ptrKind == SANDBOX_PTR_DATA_OUT )
+			sb->chunkError = BASS_OK;
+
+		long long deadline = sandboxCallDeadline();
+		SANDBOX_SHM* shm = sb->shm;
+		SANDBOX_SLOT* slot = &shm->slots[SANDBOX_SLOT_CONTROL];
+		bool ok = sandboxReady(sb, SANDBOX_SLOT_CONTROL, deadline);
+		if( ok && ptrKind == SANDBOX_PTR_DATA_IN )
+		{
+			if( value <= 0 )
+			{
+				sb->chunkError = BASS_ERROR_ILLPARAM;
+				ok = false;
+			}
+			else if( value <= SANDBOX_DATA_BYTES )
+				memcpy(shm->data, ptr, value);
+			else
+				ok = sandboxPutChunk(sb, (const char*)ptr, (long)value);
+		}
+
+		if( ok )
+		{
+			slot->cmd		= SANDBOX_CMD_DISPATCH;
+			slot->opcode	= opcode;
+			slot->index		= index;
+			slot->value		= value;
+			slot->opt		= opt;
+			slot->ptrKind	= ptrKind;
+
+			if( ptrKind == SANDBOX_PTR_STRING_IN )
+			{
+				strncpy(shm->data, (const char*)ptr, SANDBOX_STRING_BYTES-1);
+				shm->data[SANDBOX_STRING_BYTES-1] = 0;
+			}
+		}
+
+		if( ok && sandboxCall(sb, SANDBOX_SLOT_CONTROL, sandboxCallDeadline(), false) )
+		{
+			ret = slot->ret;
+			switch( ptrKind )
+			{
+				case SANDBOX_PTR_STRING_OUT:
+					strcpy((char*)ptr, shm->data);
+					break;
+
+				case SANDBOX_PTR_DATA_IN:
+					if( slot->error != BASS_OK )
+						sb->chunkError = slot->error;
+					break;
+
+				case SANDBOX_PTR_DATA_OUT:
+					*(void**)ptr = NULL;
+					if( slot->error != BASS_OK )
+						sb->chunkError = slot->error;
+					else if( ret > 0 && sandboxGetChunk(sb, (long)ret) )
+						*(void**)ptr = sb->chunkData;
+					else
+						ret = 0;
+					break;
+
+				case SANDBOX_PTR_RECT_OUT:
+					*(ERect**)ptr = NULL;
+					if( slot->dataBytes == sizeof(ERect) )
+					{
+						memcpy(&sb->editRect, shm->data, sizeof(ERect));
+						*(ERect**)ptr = &sb->editRect;
+					}
+					break;
+			}
+		}
+		else if( (ptrKind == SANDBOX_PTR_DATA_IN || ptrKind == SANDBOX_PTR_DATA_OUT) && sb->chunkError == BASS_OK )
+		{
+			sb->chunkError = BASS_ERROR_NOTAVAIL; // the child is gone
+		}
+
+	LeaveCriticalSection(&sb->critical_);
+
+	return ret;
+}
+
+
+
+static void proxySetParameter(AEffect* aeffect, VstInt32 index, float value)
+{
+	SANDBOX* sb = (SANDBOX*)aeffect;
+
+	// queue the change for the next request, see sandboxTakeParams()
+	if( index >= 0 && index < SANDBOX_MAX_PARAMS )
+	{
+		EnterCriticalSection(&sb->queueCritical_);
+			sb->params[index] = value;
+			if( !(sb->paramState[index] & SANDBOX_PARAM_QUEUED) )
+			{
+				sb->paramState[index] |= SANDBOX_PARAM_QUEUED;
+				sb->queuedParams[sb->numQueuedParams++] = index;
+			}
+		LeaveCriticalSection(&sb->queueCritical_);
+		return;
+	}
+
+	// parameters beyond the queue are set at once
+	EnterCriticalSection(&sb->critical_);
+		long long deadline = sandboxCallDeadline();
+		if( sandboxReady(sb, SANDBOX_SLOT_CONTROL, deadline) )
+		{
+			SANDBOX_SLOT* slot = &sb->shm->slots[SANDBOX_SLOT_CONTROL];
+			slot->cmd	= SANDBOX_CMD_SETPARAM;
+			slot->index	= index;
+			slot->opt	= value;
+			sandboxCall(sb, SANDBOX_SLOT_CONTROL, deadline, false);
+		}
+	LeaveCriticalSection(&sb->critical_);
+}
+
+
+
+static float proxyGetParameter(AEffect* aeffect, VstInt32 index)
+{
+	SANDBOX* sb = (SANDBOX*)aeffect;
+	float value = 0.0F;
+
+	// the value set by the host if not yet answered by the child, else the child's copy
+	if( index >= 0 && index < SANDBOX_MAX_PARAMS )
+	{
+		EnterCriticalSection(&sb->queueCritical_);
+			value = sb->paramState[index]? sb->params[index] : sb->shm->params[index];
+		LeaveCriticalSection(&sb->queueCritical_);
+		return value;
+	}
+
+	// parameters beyond the copy are asked for
+	EnterCriticalSection(&sb->critical_);
+		long long deadline = sandboxCallDeadline();
+		if( sandboxReady(sb, SANDBOX_SLOT_CONTROL, deadline) )
+		{
+			SANDBOX_SLOT* slot = &sb->shm->slots[SANDBOX_SLOT_CONTROL];
+			slot->cmd	= SANDBOX_CMD_GETPARAM;
+			slot->index	= index;
+			if( sandboxCall(sb, SANDBOX_SLOT_CONTROL, deadline, false) )
+				value = slot->retParam;
+		}
+	LeaveCriticalSection(&sb->critical_);
+	return value;
+}
+
+
+
+static void proxyProcessReplacing(AEffect* aeffect, float** inputs, float** outputs, VstInt32 numSamples)
+{
+	SANDBOX* sb = (SANDBOX*)aeffect;
+	int numOutputs = aeffect->numOutputs < MAX_CHANS? aeffect->numOutputs : MAX_CHANS;
+	long done = 0, todo;
+	int c;
+
+	// we wait for the child no longer than the block lasts, so a slow plugin causes a dropout but no stall
+	long long timeout = (long long)(numSamples * 1000000000.0 / (sb->sampleRate > 0.0F? sb->sampleRate : 44100.0F));
+	if( timeout < SANDBOX_MIN_BLOCK_TIMEOUT_US * 1000LL )
+		timeout = SANDBOX_MIN_BLOCK_TIMEOUT_US * 1000LL;
+	long long deadline = sandboxNow() + timeout;
+
+	// get the time info from the host once per block, the child answers audioMasterGetTime from this copy
+	VstTimeInfo* timeInfo = (VstTimeInfo*)sb->hostCallback(aeffect, audioMasterGetTime, 0,
+		kVstNanosValid|kVstPpqPosValid|kVstTempoValid|kVstBarsValid|kVstCyclePosValid|kVstTimeSigValid|kVstSmpteValid, NULL, 0.0F);
+
+	// the audio slot is only used here, and the host never processes a plugin by two threads
+	// at the same time - so there is no lock to wait for
+	SANDBOX_SHM* shm = sb->shm;
+	int numInputs = aeffect->numInputs < MAX_CHANS? aeffect->numInputs : MAX_CHANS;
+	if( sandboxReady(sb, SANDBOX_SLOT_AUDIO, deadline) )
+	{
+		if( timeInfo )
+			memcpy(&shm->timeInfo, timeInfo, sizeof(VstTimeInfo));
+
+		// the events are delivered with the first part of the block
+		EnterCriticalSection(&sb->queueCritical_);
+			memcpy(shm->events, sb->events, sb->eventBytes);
+			shm->numEvents = sb->numEvents;
+			shm->eventBytes = sb->eventBytes;
+			sb->numEvents = 0;
+			sb->eventBytes = 0;
+		LeaveCriticalSection(&sb->queueCritical_);
+
+		while( done < numSamples )
+		{
+			todo = numSamples - done;
+			if( todo > SANDBOX_MAX_SAMPLES )
+				todo = SANDBOX_MAX_SAMPLES;
+
+			for( c = 0; c < numInputs; c++ )
+				memcpy(shm->audio[0][c], inputs[c] + done, todo*sizeof(float));
+
+			shm->slots[SANDBOX_SLOT_AUDIO].cmd = SANDBOX_CMD_PROCESS;
+			shm->numSamples = todo;
+
+			if( !sandboxCall(sb, SANDBOX_SLOT_AUDIO, deadline, true) )
+				break;
+
+			for( c = 0; c < numOutputs; c++ )
+				memcpy(outputs[c] + done, shm->audio[1][c], todo*sizeof(float));
+
+			shm->numEvents = 0;
+			shm->eventBytes = 0;
+
+			done += todo;
+		}
+	}
+
+	// whatever the child did not deliver in time is silence
+	for( c = 0; c < numOutputs && done < numSamples; c++ )
+		memset(outputs[c] + done, 0, (numSamples - done)*sizeof(float));
+}
+
+
+
+/*****************************************************************************
+ *  opening and closing
+ *****************************************************************************/
+
+
+
+static void sandboxExePath(char* buf, size_t bufSize)
+{
+	// the helper is installed next to libbass_vst.so; if we cannot find out where we
+	// are, the name alone lets posix_spawnp() search the PATH
+	const char* env = getenv(SANDBOX_EXE_ENV);
+	if( env && env[0] )
+	{
+		snprintf(buf, bufSize, "%s", env);
+		return;
+	}
+
+	Dl_info info;
+	const char* slash;
+	if( dladdr((void*)sandboxOpen, &info) && info.dli_fname && (slash = strrchr(info.dli_fname, '/')) != NULL )
+		snprintf(buf, bufSize, "%.*s/%s", (int)(slash - info.dli_fname), info.dli_fname, SANDBOX_EXE_NAME);
+	else
+		snprintf(buf, bufSize, "%s", SANDBOX_EXE_NAME);
+}
+
+
+
+static bool sandboxSpawn(SANDBOX* sb, const char* shmName, const char* dllFile, long pluginID)
+{
+	char exe[PATH_MAX], idStr[32], pidStr[32];
+	sandboxExePath(exe, sizeof(exe));
+	snprintf(idStr, sizeof(idStr), "%ld", pluginID);
+	snprintf(pidStr, sizeof(pidStr), "%ld", (long)getpid());
+	char* argv[] = { exe, (char*)shmName, (char*)dllFile, idStr, pidStr, NULL };
+
+	// the calling thread may block signals, the child should not inherit this
+	posix_spawnattr_t attr;
+	sigset_t noSignals;
+	sigemptyset(&noSignals);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setsigmask(&attr, &noSignals);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+	int err = posix_spawnp(&sb->pid, exe, NULL, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+	return err == 0;
+}
+
+
+
+AEffect* sandboxOpen(const void* dllFile, long pluginID, audioMasterCallback hostCallback, DWORD* error)
+{
+	SANDBOX* sb = (SANDBOX*)calloc(1, sizeof(SANDBOX));
+	if( sb == NULL )
+	{
+		*error = BASS_ERROR_MEM;
+		return NULL;
+	}
+
+	// the shared memory gets a name the child can open; it is unlinked as soon as the child has mapped it
+	char shmName[64];
+	snprintf(shmName, sizeof(shmName), "/bass_vst_sandbox.%ld.%ld", (long)getpid(), (long)__sync_fetch_and_add(&s_sandboxCount, 1));
+	int fd = shm_open(shmName, O_RDWR|O_CREAT|O_EXCL, 0600);
+	if( fd < 0 )
+	{
+		free(sb);
+		*error = BASS_ERROR_MEM;
+		return NULL;
+	}
+
+	sb->shm = (SANDBOX_SHM*)MAP_FAILED;
+	if( ftruncate(fd, sizeof(SANDBOX_SHM)) == 0 )
+		sb->shm = (SANDBOX_SHM*)mmap(NULL, sizeof(SANDBOX_SHM), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if( sb->shm == MAP_FAILED )
+	{
+		shm_unlink(shmName);
+		free(sb);
+		*error = BASS_ERROR_MEM;
+		return NULL;
+	}
+
+	sb->shm->slots[SANDBOX_SLOT_CONTROL].reqSeq = 1; // the first request is loading the plugin
+	__sync_synchronize();
+
+	if( !sandboxSpawn(sb, shmName, (const char*)dllFile, pluginID) )
+	{
+		shm_unlink(shmName);
+		munmap(sb->shm, sizeof(SANDBOX_SHM));
+		free(sb);
+		*error = BASS_ERROR_NOTAVAIL; // the helper executable is missing
+		return NULL;
+	}
+
+	InitializeCriticalSection(&sb->critical_);
+	InitializeCriticalSection(&sb->queueCritical_);
+	sb->hostCallback = hostCallback;
+	sb->sampleRate = 44100.0F;
+
+	bool loaded = sandboxWaitAck(sb, SANDBOX_SLOT_CONTROL, 1, sandboxNow() + SANDBOX_OPEN_TIMEOUT_MS * 1000000LL, true);
+	shm_unlink(shmName);
+	if( !loaded || sb->shm->openError )
+	{
+		*error = sb->shm->openError? sb->shm->openError : BASS_ERROR_FILEFORM;
+		sandboxKill(sb);
+		DeleteCriticalSection(&sb->queueCritical_);
+		DeleteCriticalSection(&sb->critical_);
+		munmap(sb->shm, sizeof(SANDBOX_SHM));
+		free(sb);
+		return NULL;
+	}
+
+	// set up the proxy
+	SANDBOX_SHM* shm = sb->shm;
+	sb->aeffect.magic					= shm->magic;
+	sb->aeffect.dispatcher				= proxyDispatcher;
+	sb->aeffect.setParameter			= proxySetParameter;
+	sb->aeffect.getParameter			= proxyGetParameter;
+	sb->aeffect.processReplacing		= proxyProcessReplacing;
+	sandboxTakeOver(sb);
+
+	return &sb->aeffect;
+}
+
+
+
+void sandboxClose(AEffect* aeffect)
+{
+	SANDBOX* sb = (SANDBOX*)aeffect;
+	if( sb == NULL )
+		return;
+
+	EnterCriticalSection(&sb->critical_);
+		long long deadline = sandboxNow() + 500 * 1000000LL;
+		if( sandboxReady(sb, SANDBOX_SLOT_CONTROL, deadline) )
+		{
+			sb->shm->slots[SANDBOX_SLOT_CONTROL].cmd = SANDBOX_CMD_QUIT;
+			if( sandboxCall(sb, SANDBOX_SLOT_CONTROL, deadline, false) )
+			{
+				// give the child a moment to exit by itself
+				for( int i = 0; i < 50 && !sandboxIsDead(sb); i++ )
+				{
+					if( sandboxChildExited(sb) )
+						InterlockedExchange(&sb->dead, 1);
+					else
+						usleep(1000);
+				}
+			}
+		}
+		sandboxKill(sb);
+	LeaveCriticalSection(&sb->critical_);
+
+	DeleteCriticalSection(&sb->queueCritical_);
+	DeleteCriticalSection(&sb->critical_);
+	munmap(sb->shm, sizeof(SANDBOX_SHM));
+	if( sb->chunkData )
+		free(sb->chunkData);
+	free(sb);
+}
+
+
+
+DWORD sandboxChunkError(AEffect* aeffect)
+{
+	// the caller holds the plugin's lock, so no other chunk is transferred meanwhile
+	return ((SANDBOX*)aeffect)->chunkError;
+}
+
+
+
+#else // !__linux__
+
+
+
+AEffect* sandboxOpen(const void* /*dllFile*/, long /*pluginID*/, audioMasterCallback /*hostCallback*/, DWORD* error)
+{
+	*error = BASS_ERROR_NOTAVAIL; // not yet implemented for this platform
+	return NULL;
+}
+
+
+
+void sandboxClose(AEffect* /*aeffect*/)
+{
+}
+
+
+
+DWORD sandboxChunkError(AEffect* /*aeffect*/)
+{
+	return BASS_OK;
+}
+
+
+
+#endif
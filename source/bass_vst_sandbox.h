@@ -0,0 +1,188 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_sandbox.h
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Shared memory layout of sandboxed plugins (BASS_VST_SANDBOX)
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: this header is included by the host side in bass_vst_sandbox.cpp
+ *	and by the helper executable bass_vst_sandbox_child.cpp, so both sides
+ *	always agree on the layout of SANDBOX_SHM.
+ *
+ *****************************************************************************/
+
+
+
+#ifndef __BASS_VST_SANDBOX_H__
+#define __BASS_VST_SANDBOX_H__
+
+#include "bass_vst_impl.h"
+
+#ifdef __linux__
+
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <time.h>
+
+
+
+#define SANDBOX_MAX_SAMPLES		4096			// larger blocks are split
+#define SANDBOX_DATA_BYTES		(1024*1024)		// larger chunks are transferred in pieces
+#define SANDBOX_EVENT_BYTES		(64*1024)
+#define SANDBOX_MAX_PARAMS		4096			// parameters beyond are not cached, they cost a round trip
+#define SANDBOX_MAX_NOTIFICATIONS 1024
+#define SANDBOX_STRING_BYTES	128
+#define SANDBOX_SPIN_COUNT		4000
+#define SANDBOX_TIMEOUT_MS		3000			// max. time for a single request before the child is killed
+#define SANDBOX_OPEN_TIMEOUT_MS	10000
+#define SANDBOX_CHILD_POLL_MS	1000			// the child checks this often if the host is still alive
+#define SANDBOX_EXE_NAME		"bass_vst_sandbox"	// the helper executable, next to libbass_vst.so
+#define SANDBOX_EXE_ENV			"BASS_VST_SANDBOX_EXE"	// overrides the path of the helper
+
+#define SANDBOX_SLOT_AUDIO		0	// SANDBOX_CMD_PROCESS only
+#define SANDBOX_SLOT_CONTROL	1	// all other requests
+#define SANDBOX_SLOTS			2
+
+#define SANDBOX_CMD_DISPATCH	1
+#define SANDBOX_CMD_SETPARAM	2	// only for parameters beyond SANDBOX_MAX_PARAMS
+#define SANDBOX_CMD_GETPARAM	3	// only for parameters beyond SANDBOX_MAX_PARAMS
+#define SANDBOX_CMD_PROCESS		4
+#define SANDBOX_CMD_QUIT		5
+#define SANDBOX_CMD_CHUNK_PUT	6	// <dataBytes> at <dataOffset> of a chunk of <value> bytes for effSetChunk
+#define SANDBOX_CMD_CHUNK_GET	7	// up to SANDBOX_DATA_BYTES at <dataOffset> of the chunk got by effGetChunk
+
+#define SANDBOX_PTR_NONE		0
+#define SANDBOX_PTR_STRING_OUT	1	// ptr is a buffer the plugin fills with a string
+#define SANDBOX_PTR_STRING_IN	2	// ptr is a string read by the plugin
+#define SANDBOX_PTR_DATA_IN		3	// ptr points to <value> bytes (effSetChunk), put before if more than SANDBOX_DATA_BYTES
+#define SANDBOX_PTR_DATA_OUT	4	// ptr is a void** receiving <ret> bytes (effGetChunk), the first <dataBytes> are in data
+#define SANDBOX_PTR_RECT_OUT	5	// ptr is a ERect**
+#define SANDBOX_PTR_UNSUPPORTED	6
+
+
+
+typedef struct
+{
+	VstInt32		index;
+	float			value;
+} SANDBOX_PARAM_CHANGE;
+
+
+
+typedef struct
+{
+	VstInt32		opcode;
+	VstInt32		index;
+	VstIntPtr		value;
+	float			opt;
+} SANDBOX_NOTIFICATION;
+
+
+
+typedef struct
+{
+	// request/acknowledge counters; the host waits for ackSeq as a futex word
+	volatile int	reqSeq;
+	volatile int	ackSeq;
+	volatile int	hostWaiting;
+
+	// the current request and its result
+	int				cmd;
+	VstInt32		opcode;
+	VstInt32		index;
+	VstIntPtr		value;
+	float			opt;
+	int				ptrKind;
+	VstIntPtr		ret;
+	float			retParam;
+	long			dataOffset;
+	long			dataBytes;
+	DWORD			error;			// BASS error code if the child could not serve the request
+
+	// parameter changes the child applies before the request
+	int				numParamChanges;
+	SANDBOX_PARAM_CHANGE paramChanges[SANDBOX_MAX_PARAMS];
+
+	// audioMaster calls of the plugin while serving the request, replayed by the host
+	int				numNotifications;
+	SANDBOX_NOTIFICATION notifications[SANDBOX_MAX_NOTIFICATIONS];
+} SANDBOX_SLOT;
+
+
+
+typedef struct
+{
+	// the audio thread and the control requests have a slot each, so a block never
+	// waits for a dispatcher call; the host increments doorbell after any request
+	SANDBOX_SLOT	slots[SANDBOX_SLOTS];
+	volatile int	doorbell;
+	volatile int	childWaiting;
+
+	// mirror of the plugin's AEffect, updated by the child after each request
+	VstInt32		magic;
+	VstInt32		numPrograms;
+	VstInt32		numParams;
+	VstInt32		numInputs;
+	VstInt32		numOutputs;
+	VstInt32		flags;
+	VstInt32		initialDelay;
+	VstInt32		uniqueID;
+	VstInt32		version;
+	DWORD			openError;		// BASS error code if the child could not load the plugin
+
+	// the parameter values, refreshed by the child after each request
+	float			params[SANDBOX_MAX_PARAMS];
+
+	// MIDI events delivered with SANDBOX_CMD_PROCESS
+	int				numEvents;
+	long			eventBytes;
+
+	// time info and audio for SANDBOX_CMD_PROCESS
+	VstTimeInfo		timeInfo;
+	long			numSamples;
+
+	char			data[SANDBOX_DATA_BYTES];	// strings and chunks of the control requests
+	char			events[SANDBOX_EVENT_BYTES];
+	float			audio[2][MAX_CHANS][SANDBOX_MAX_SAMPLES];
+} SANDBOX_SHM;
+
+
+
+static inline int futexWait(volatile int* addr, int val, long long timeoutNs)
+{
+	struct timespec ts;
+	ts.tv_sec = (time_t)(timeoutNs / 1000000000LL);
+	ts.tv_nsec = (long)(timeoutNs % 1000000000LL);
+	return (int)syscall(SYS_futex, (int*)addr, FUTEX_WAIT, val, &ts, NULL, 0); // not FUTEX_PRIVATE_FLAG: the word is shared between processes
+}
+
+
+
+static inline void futexWake(volatile int* addr)
+{
+	syscall(SYS_futex, (int*)addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+
+
+static inline void cpuRelax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+
+
+#endif // __linux__
+
+#endif // __BASS_VST_SANDBOX_H__
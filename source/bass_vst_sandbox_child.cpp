@@ -0,0 +1,607 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_sandbox_child.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    The helper executable hosting a sandboxed plugin
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: bass_vst_sandbox is started by sandboxOpen() in bass_vst_sandbox.cpp
+ *	with posix_spawn(), so the plugin is loaded into a freshly executed
+ *	process and not into a forked copy of the host - after fork(), only
+ *	async-signal-safe functions could be used, and dlopen() and whatever
+ *	the plugin does are not.
+ *
+ *	Usage: bass_vst_sandbox <shm name> <plugin file> <plugin ID> <host pid>
+ *
+ *	The shared memory is created by the host and mapped here by its name;
+ *	see bass_vst_sandbox.h for the layout and bass_vst_sandbox.cpp for the
+ *	protocol.  The child exits if the host is gone, it checks this every
+ *	SANDBOX_CHILD_POLL_MS while waiting for requests.
+ *
+ *	The requests of both slots are served by the main thread one after
+ *	another, the audio slot first - so the plugin is never called by two
+ *	threads at the same time, as in the host.  The audioMaster calls the
+ *	host has to know about are queued in the slot being served.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_sandbox.h"
+
+#ifdef __linux__
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+
+
+static SANDBOX_SHM*	s_childShm = NULL;
+static SANDBOX_SLOT*	s_childSlot = NULL;		// the slot being served, NULL while loading
+static long			s_childPluginID = 0;
+static float		s_childSampleRate = 44100.0F;
+static VstIntPtr	s_childBlockSize = 1024;
+static char*		s_childChunk = NULL;	// chunks larger than SANDBOX_DATA_BYTES
+static long			s_childChunkBytes = 0;
+static bool			s_childClosed = false;	// effClose freed the AEffect, only SANDBOX_CMD_QUIT may follow
+
+
+
+static void childNotify(VstInt32 opcode, VstInt32 index, VstIntPtr value, float opt)
+{
+	// queue the call for the host; a repeated call replaces the last one of the same
+	// opcode (and parameter) unless an audioMasterBeginEdit or audioMasterEndEdit is
+	// in between, so the queue only overflows for more than SANDBOX_MAX_NOTIFICATIONS
+	// different parameters in one request - the rest is dropped then
+	SANDBOX_SLOT* slot = s_childSlot;
+	if( slot == NULL )
+		return; // while loading, the host does not know the plugin yet
+
+	for( int i = slot->numNotifications - 1; i >= 0; i-- )
+	{
+		SANDBOX_NOTIFICATION* n = &slot->notifications[i];
+		if( n->opcode == audioMasterBeginEdit || n->opcode == audioMasterEndEdit
+		 || opcode == audioMasterBeginEdit || opcode == audioMasterEndEdit )
+			break;
+		if( n->opcode == opcode && (opcode != audioMasterAutomate || n->index == index) )
+		{
+			n->index = index;
+			n->value = value;
+			n->opt = opt;
+			return;
+		}
+	}
+
+	if( slot->numNotifications < SANDBOX_MAX_NOTIFICATIONS )
+	{
+		SANDBOX_NOTIFICATION* n = &slot->notifications[slot->numNotifications++];
+		n->opcode = opcode;
+		n->index = index;
+		n->value = value;
+		n->opt = opt;
+	}
+}
+
+
+
+static VstIntPtr childAudioMasterCallback(AEffect* /*aeffect*/, VstInt32 opcode, VstInt32 index,
+										 VstIntPtr value, void* ptr, float opt)
+{
+	// the child cannot reach the BASS_VST handle, so we answer only what is needed for processing
+	// and forward the notifications to the host; the time info is copied into the shared memory
+	// by the host just before each block
+	switch( opcode )
+	{
+		case audioMasterAutomate:
+		case audioMasterUpdateDisplay:
+		case audioMasterBeginEdit:
+		case audioMasterEndEdit:
+		case audioMasterSizeWindow:
+			childNotify(opcode, index, value, opt);
+			return 0;
+
+		case audioMasterIOChanged:
+			childNotify(opcode, index, value, opt);
+			return 1;
+
+		case audioMasterVersion:			return kVstVersion;
+		case audioMasterCurrentId:			return s_childPluginID;
+		case audioMasterGetTime:			return (VstIntPtr)&s_childShm->timeInfo;
+		case audioMasterGetSampleRate:		return (VstIntPtr)s_childSampleRate;
+		case audioMasterGetBlockSize:		return s_childBlockSize;
+		case audioMasterGetVendorVersion:	return BASS_VST_VERSION_HEX;
+
+		case audioMasterGetVendorString:
+			strcpy((char*)ptr, "Bjoern Petersen Software Design and Development"/*max 64 char!*/);
+			return 1;
+
+		case audioMasterGetProductString:
+			strcpy((char*)ptr, "BASS_VST @ Silverjuke.Net");
+			return 1;
+
+		case audioMasterCanDo:
+			if( strcasecmp((char*)ptr, "sendvstevents")==0
+			 || strcasecmp((char*)ptr, "sendvstmidievent")==0
+			 || strcasecmp((char*)ptr, "sendvsttimeinfo")==0
+			 || strcasecmp((char*)ptr, "startstopprocess")==0
+			 || strcasecmp((char*)ptr, "shellcategory")==0 )
+			{
+				return 1;
+			}
+			break;
+	}
+
+	return 0;
+}
+
+
+
+static void childMirrorAEffect(SANDBOX_SHM* shm, AEffect* aeffect)
+{
+	shm->magic			= aeffect->magic;
+	shm->numPrograms	= aeffect->numPrograms;
+	shm->numParams		= aeffect->numParams;
+	shm->numInputs		= aeffect->numInputs;
+	shm->numOutputs		= aeffect->numOutputs;
+	shm->flags			= aeffect->flags;
+	shm->initialDelay	= aeffect->initialDelay;
+	shm->uniqueID		= aeffect->uniqueID;
+	shm->version		= aeffect->version;
+}
+
+
+
+static void childFreeChunk()
+{
+	if( s_childChunk )
+		free(s_childChunk);
+	s_childChunk = NULL;
+	s_childChunkBytes = 0;
+}
+
+
+
+static void childDispatch(SANDBOX_SHM* shm, SANDBOX_SLOT* slot, AEffect* aeffect)
+{
+	void* ptr = NULL;
+	void* outPtr = NULL;
+
+	switch( slot->ptrKind )
+	{
+		case SANDBOX_PTR_STRING_OUT:
+			memset(shm->data, 0, SANDBOX_STRING_BYTES);
+			ptr = shm->data; // the whole data area is available, so plugins writing too long strings do no harm
+			break;
+
+		case SANDBOX_PTR_STRING_IN:
+			ptr = shm->data;
+			break;
+
+		case SANDBOX_PTR_DATA_IN:
+			// larger chunks were put into s_childChunk before by SANDBOX_CMD_CHUNK_PUT
+			if( slot->value <= SANDBOX_DATA_BYTES )
+				ptr = shm->data;
+			else if( s_childChunkBytes == slot->value )
+				ptr = s_childChunk;
+			else
+			{
+				slot->error = BASS_ERROR_ILLPARAM;
+				slot->ret = 0;
+				return;
+			}
+			break;
+
+		case SANDBOX_PTR_DATA_OUT:
+		case SANDBOX_PTR_RECT_OUT:
+			ptr = &outPtr;
+			break;
+	}
+
+	if( slot->opcode == effSetSampleRate )
+		s_childSampleRate = slot->opt;
+	else if( slot->opcode == effSetBlockSize )
+		s_childBlockSize = slot->value;
+
+	slot->ret = aeffect->dispatcher(aeffect, slot->opcode, slot->index, slot->value, ptr, slot->opt);
+	slot->dataBytes = 0;
+	if( slot->opcode == effClose )
+	{
+		s_childClosed = true;
+		return;
+	}
+
+	switch( slot->ptrKind )
+	{
+		case SANDBOX_PTR_STRING_OUT:
+			shm->data[SANDBOX_STRING_BYTES-1] = 0;
+			break;
+
+		case SANDBOX_PTR_DATA_IN:
+			if( ptr == s_childChunk )
+				childFreeChunk();
+			break;
+
+		case SANDBOX_PTR_DATA_OUT:
+			if( outPtr == NULL || slot->ret <= 0 )
+			{
+				slot->ret = 0;
+			}
+			else if( slot->ret <= SANDBOX_DATA_BYTES )
+			{
+				memcpy(shm->data, outPtr, slot->ret);
+				slot->dataBytes = (long)slot->ret;
+			}
+			else
+			{
+				// the host gets the first piece now and the rest by SANDBOX_CMD_CHUNK_GET; we keep
+				// a copy as the plugin's memory may change while other requests are served
+				childFreeChunk();
+				if( (s_childChunk = (char*)malloc(slot->ret)) == NULL )
+				{
+					slot->error = BASS_ERROR_MEM;
+					slot->ret = 0;
+					break;
+				}
+				s_childChunkBytes = (long)slot->ret;
+				memcpy(s_childChunk, outPtr, s_childChunkBytes);
+				memcpy(shm->data, s_childChunk, SANDBOX_DATA_BYTES);
+				slot->dataBytes = SANDBOX_DATA_BYTES;
+			}
+			break;
+
+		case SANDBOX_PTR_RECT_OUT:
+			if( outPtr )
+			{
+				memcpy(shm->data, outPtr, sizeof(ERect));
+				slot->dataBytes = sizeof(ERect);
+			}
+			break;
+	}
+}
+
+
+
+static void childChunkPut(SANDBOX_SHM* shm, SANDBOX_SLOT* slot)
+{
+	// the first piece allocates the whole chunk
+	if( slot->dataOffset == 0 )
+	{
+		childFreeChunk();
+		if( slot->value <= 0 || (s_childChunk = (char*)malloc(slot->value)) == NULL )
+		{
+			slot->error = BASS_ERROR_MEM;
+			return;
+		}
+		s_childChunkBytes = (long)slot->value;
+	}
+
+	if( s_childChunkBytes != slot->value
+	 || slot->dataBytes <= 0 || slot->dataBytes > SANDBOX_DATA_BYTES
+	 || slot->dataOffset < 0 || slot->dataOffset + slot->dataBytes > s_childChunkBytes )
+	{
+		slot->error = BASS_ERROR_ILLPARAM;
+		return;
+	}
+
+	memcpy(s_childChunk + slot->dataOffset, shm->data, slot->dataBytes);
+}
+
+
+
+static void childChunkGet(SANDBOX_SHM* shm, SANDBOX_SLOT* slot)
+{
+	if( slot->dataOffset <= 0 || slot->dataOffset >= s_childChunkBytes )
+	{
+		slot->dataBytes = 0;
+		slot->error = BASS_ERROR_ILLPARAM;
+		return;
+	}
+
+	slot->dataBytes = s_childChunkBytes - slot->dataOffset;
+	if( slot->dataBytes > SANDBOX_DATA_BYTES )
+		slot->dataBytes = SANDBOX_DATA_BYTES;
+	memcpy(shm->data, s_childChunk + slot->dataOffset, slot->dataBytes);
+
+	if( slot->dataOffset + slot->dataBytes == s_childChunkBytes )
+		childFreeChunk(); // the host has got everything
+}
+
+
+
+static void childProcess(SANDBOX_SHM* shm, AEffect* aeffect)
+{
+	static VstEvents*	events = NULL;
+	static double*		doubleBuf[2][MAX_CHANS];
+
+	long numSamples = shm->numSamples, i;
+	int c;
+
+	// deliver the MIDI events; the sysex pointers are fixed up to point into our shared memory
+	if( shm->numEvents > 0 )
+	{
+		if( events == NULL )
+			events = (VstEvents*)calloc(1, sizeof(VstEvents) + MAX_MIDI_EVENTS*sizeof(VstEvent*));
+
+		if( events )
+		{
+			char* p = shm->events;
+			events->numEvents = 0;
+			for( i = 0; i < shm->numEvents && i < MAX_MIDI_EVENTS; i++ )
+			{
+				VstEvent* e = (VstEvent*)p;
+				if( e->type == kVstSysExType )
+				{
+					VstMidiSysexEvent* s = (VstMidiSysexEvent*)e;
+					s->sysexDump = p + sizeof(VstMidiSysexEvent);
+					p += (sizeof(VstMidiSysexEvent) + s->dumpBytes + 7) & ~7;
+				}
+				else
+				{
+					p += sizeof(VstMidiSysexEvent);
+				}
+				events->events[events->numEvents++] = e;
+			}
+			aeffect->dispatcher(aeffect, effProcessEvents, 0, 0, events, 0.0);
+		}
+	}
+
+	float* in[MAX_CHANS];
+	float* out[MAX_CHANS];
+	for( c = 0; c < MAX_CHANS; c++ )
+	{
+		in[c] = shm->audio[0][c];
+		out[c] = shm->audio[1][c];
+	}
+
+	if(    aeffect->processReplacing
+	 && ( (aeffect->flags & effFlagsCanReplacing) || aeffect->__processDeprecated == NULL) )
+	{
+		aeffect->processReplacing(aeffect, in, out, numSamples);
+	}
+	else if( aeffect->__processDeprecated )
+	{
+		for( c = 0; c < aeffect->numOutputs && c < MAX_CHANS; c++ )
+			memset(out[c], 0, numSamples*sizeof(float));
+		aeffect->__processDeprecated(aeffect, in, out, numSamples);
+	}
+	else if( aeffect->processDoubleReplacing )
+	{
+		for( c = 0; c < MAX_CHANS; c++ )
+		{
+			if( doubleBuf[0][c] == NULL )
+			{
+				doubleBuf[0][c] = (double*)calloc(SANDBOX_MAX_SAMPLES, sizeof(double));
+				doubleBuf[1][c] = (double*)calloc(SANDBOX_MAX_SAMPLES, sizeof(double));
+				if( doubleBuf[0][c] == NULL || doubleBuf[1][c] == NULL )
+					_exit(1);
+			}
+			if( c < aeffect->numInputs )
+				for( i = 0; i < numSamples; i++ ) doubleBuf[0][c][i] = in[c][i];
+		}
+
+		aeffect->processDoubleReplacing(aeffect, doubleBuf[0], doubleBuf[1], numSamples);
+
+		for( c = 0; c < aeffect->numOutputs && c < MAX_CHANS; c++ )
+			for( i = 0; i < numSamples; i++ ) out[c][i] = (float)doubleBuf[1][c][i];
+	}
+}
+
+
+
+static void childRefreshParams(SANDBOX_SHM* shm, AEffect* aeffect)
+{
+	// the host answers getParameter() from this copy
+	if( aeffect->getParameter )
+	{
+		for( int i = 0; i < aeffect->numParams && i < SANDBOX_MAX_PARAMS; i++ )
+			shm->params[i] = aeffect->getParameter(aeffect, i);
+	}
+}
+
+
+
+static void childAck(SANDBOX_SLOT* slot, int seq)
+{
+	__sync_synchronize();
+	slot->ackSeq = seq;
+	__sync_synchronize();
+	if( slot->hostWaiting )
+		futexWake(&slot->ackSeq);
+}
+
+
+
+static void childServe(SANDBOX_SHM* shm, SANDBOX_SLOT* slot, AEffect* aeffect)
+{
+	int seq = slot->reqSeq;
+	__sync_synchronize();
+
+	s_childSlot = slot;
+	slot->numNotifications = 0;
+	slot->error = BASS_OK;
+
+	if( s_childClosed && slot->cmd != SANDBOX_CMD_QUIT )
+	{
+		slot->error = BASS_ERROR_NOTAVAIL;
+		s_childSlot = NULL;
+		childAck(slot, seq);
+		return;
+	}
+
+	// the parameter changes queued by the host come first
+	for( int i = 0; i < slot->numParamChanges; i++ )
+		aeffect->setParameter(aeffect, slot->paramChanges[i].index, slot->paramChanges[i].value);
+
+	switch( slot->cmd )
+	{
+		case SANDBOX_CMD_DISPATCH:
+			childDispatch(shm, slot, aeffect);
+			break;
+
+		case SANDBOX_CMD_SETPARAM:
+			aeffect->setParameter(aeffect, slot->index, slot->opt);
+			break;
+
+		case SANDBOX_CMD_GETPARAM:
+			slot->retParam = aeffect->getParameter(aeffect, slot->index);
+			break;
+
+		case SANDBOX_CMD_PROCESS:
+			childProcess(shm, aeffect);
+			break;
+
+		case SANDBOX_CMD_CHUNK_PUT:
+			childChunkPut(shm, slot);
+			break;
+
+		case SANDBOX_CMD_CHUNK_GET:
+			childChunkGet(shm, slot);
+			break;
+
+		case SANDBOX_CMD_QUIT:
+			childAck(slot, seq);
+			_exit(0);
+	}
+
+	if( !s_childClosed )
+	{
+		childRefreshParams(shm, aeffect);
+		childMirrorAEffect(shm, aeffect);
+	}
+	s_childSlot = NULL;
+	childAck(slot, seq);
+}
+
+
+
+static void childCloseInheritedFiles()
+{
+	// the host's files are of no use here and should not be kept open by us;
+	// close_range() is available since Linux 5.9, before we close them one by one
+#ifdef SYS_close_range
+	if( syscall(SYS_close_range, 3, ~0U, 0) == 0 )
+		return;
+#endif
+	long maxFd = sysconf(_SC_OPEN_MAX);
+	if( maxFd < 0 || maxFd > 65536 )
+		maxFd = 65536;
+	for( long fd = 3; fd < maxFd; fd++ )
+		close((int)fd);
+}
+
+
+
+int main(int argc, char** argv)
+{
+	// _exit() is used everywhere so that the plugin's static destructors cannot hang or crash on exit
+	if( argc != 5 )
+	{
+		fprintf(stderr, "usage: %s <shm name> <plugin file> <plugin ID> <host pid>\n", argv[0]);
+		_exit(2);
+	}
+
+	const char* shmName = argv[1];
+	const char* dllFile = argv[2];
+	s_childPluginID = atol(argv[3]);
+	pid_t hostPid = (pid_t)atol(argv[4]);
+
+	childCloseInheritedFiles();
+
+	int fd = shm_open(shmName, O_RDWR, 0);
+	if( fd < 0 )
+		_exit(2);
+	SANDBOX_SHM* shm = (SANDBOX_SHM*)mmap(NULL, sizeof(SANDBOX_SHM), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if( shm == MAP_FAILED )
+		_exit(2);
+	s_childShm = shm;
+
+	// load the plugin
+	AEffect* aeffect = NULL;
+	void* hinst = dlopen(dllFile, RTLD_LAZY);
+	if( hinst )
+	{
+		dllMainEntryFuncType dllMainEntryFuncPtr = (dllMainEntryFuncType)dlsym(hinst, "VSTPluginMain");
+		if( dllMainEntryFuncPtr == NULL )
+			dllMainEntryFuncPtr = (dllMainEntryFuncType)dlsym(hinst, "main");
+
+		if( dllMainEntryFuncPtr )
+			aeffect = dllMainEntryFuncPtr(childAudioMasterCallback);
+	}
+
+	if( hinst == NULL )
+		shm->openError = BASS_ERROR_FILEOPEN;
+	else if( aeffect == NULL || aeffect->magic != kEffectMagic || aeffect->dispatcher == NULL )
+		shm->openError = BASS_ERROR_FILEFORM;
+	else
+	{
+		childRefreshParams(shm, aeffect);
+		childMirrorAEffect(shm, aeffect);
+	}
+
+	// loading the plugin is the first request of the control slot
+	int doorbell = shm->doorbell;
+	childAck(&shm->slots[SANDBOX_SLOT_CONTROL], shm->slots[SANDBOX_SLOT_CONTROL].reqSeq);
+	if( shm->openError )
+		_exit(1);
+
+	// serve the requests
+	for( ;; )
+	{
+		int spin = 0;
+		while( shm->doorbell == doorbell )
+		{
+			if( spin < SANDBOX_SPIN_COUNT )
+			{
+				cpuRelax();
+				spin++;
+			}
+			else
+			{
+				shm->childWaiting = 1;
+				__sync_synchronize();
+				if( shm->doorbell == doorbell )
+					futexWait(&shm->doorbell, doorbell, SANDBOX_CHILD_POLL_MS * 1000000LL);
+				shm->childWaiting = 0;
+
+				// we are reparented if the host is gone; PR_SET_PDEATHSIG is no option as
+				// it fires as soon as the thread that started us ends, not the host process
+				if( getppid() != hostPid )
+					_exit(0);
+			}
+		}
+
+		// the doorbell is read before the slots, so a request arriving while we serve
+		// the others rings it again and is not missed
+		doorbell = shm->doorbell;
+		__sync_synchronize();
+		for( int s = 0; s < SANDBOX_SLOTS; s++ )
+		{
+			SANDBOX_SLOT* slot = &shm->slots[s];
+			if( slot->reqSeq != slot->ackSeq )
+				childServe(shm, slot, aeffect);
+		}
+	}
+}
+
+
+
+#else // !__linux__
+
+
+
+int main()
+{
+	return 1; // sandboxed plugins are not yet implemented for this platform
+}
+
+
+
+#endif
@@ -0,0 +1,408 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_sidechain.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Feeding plugin inputs from another BASS channel
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: a DSP on the source channel writes the source's data to a ring of
+ *	the plugin (sidechainWrite()), the audio thread of the plugin takes one
+ *	block from the ring before processing (sidechainRead()) and releases it
+ *	afterwards (sidechainRelease()).  The ring has a single writer and a
+ *	single reader, neither waits for the other nor takes a lock; the writer
+ *	never overwrites data not yet released, if the ring is full, the new
+ *	data are dropped.
+ *
+ *	If the block to read is contiguous in the ring, the plugin's inputs
+ *	point directly into the ring while processing, so the data are not
+ *	copied again - this is the normal case if both channels are processed
+ *	one after another by the same thread, eg. by a mixer.
+ *
+ *	The source and the plugin may be processed by different threads or
+ *	devices with slightly different clocks.  The reader keeps the minimum
+ *	of the data left in the ring over a window of SIDECHAIN_WINDOW_MS; if
+ *	more than SIDECHAIN_MARGIN samples were left all the time, the excess
+ *	is dropped.  If the source lags behind, the missing samples are filled
+ *	with the last sample (or with silence if more than SIDECHAIN_MAX_HOLD
+ *	samples are missing, eg. as the source is stopped).
+ *
+ *	The DSP gets the ring itself as its user data, so the writer does not
+ *	look up the plugin at all.  The ring is exchanged by sidechainSet()
+ *	holding the plugin's vstCritical_, which excludes the reader; the old
+ *	ring is freed only after its DSP is removed from the source.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+
+
+#define SIDECHAIN_RING_MS		500			// the ring holds at least 500 ms ...
+#define SIDECHAIN_RING_BLOCKS	4			// ... and 4 blocks of the plugin
+#define SIDECHAIN_WINDOW_MS		500
+#define SIDECHAIN_MARGIN		32			// samples left in the ring that are not dropped
+#define SIDECHAIN_MAX_HOLD		64			// max. number of missing samples filled with the last one
+#define SIDECHAIN_DSP_PRIORITY	-0x7FFFFFFF	// after all other DSPs of the source
+
+
+
+struct SIDECHAIN
+{
+	BUFFER_ARENA		arena;
+	DWORD				sourceChannel;
+	HDSP				dspHandle;
+	long				firstInput;
+	long				numChans;		// the inputs fed from the source
+	long				frames;			// a power of 2
+	float*				chans[MAX_CHANS];
+	volatile long		writePos;		// samples written so far, wraps around
+	volatile long		readPos;		// samples released so far, wraps around
+
+	// used by the audio thread of the plugin only
+	long				readEnd;		// readPos after the current block, see sidechainRelease()
+	bool				borrowed;		// the inputs point into the ring
+	float*				savedIn[MAX_CHANS];
+	float				lastSample[MAX_CHANS];
+	long				windowLength;
+	long				windowSamples;
+	long				windowMinSlack;	// the min. number of samples left in the ring in the current window
+};
+
+
+
+/*****************************************************************************
+ *  the source, any thread
+ *****************************************************************************/
+
+
+
+static void writeRing(SIDECHAIN* sc, const void* buffer, DWORD length, const BASS_CHANNELINFO* info)
+{
+	// deinterleave the data to the ring; the data the plugin has not yet released
+	// are never overwritten
+	bool isFloat = (info->flags&BASS_SAMPLE_FLOAT) || BASS_GetConfig(BASS_CONFIG_FLOATDSP);
+	if( !isFloat && (info->flags&BASS_SAMPLE_8BITS) )
+		return; // can't and won't do this
+
+	long chans = (long)info->chans;
+	long numSamples = (long)(length / (isFloat? sizeof(float) : sizeof(signed short))) / chans;
+	long numChans = sc->numChans < chans? sc->numChans : chans;
+	unsigned long pos = (unsigned long)sc->writePos;
+	long space = sc->frames - (long)(pos - (unsigned long)InterlockedExchangeAdd(&sc->readPos, 0));
+	if( numSamples > space )
+		numSamples = space; // the plugin is behind, drop the rest
+	if( numSamples <= 0 )
+		return;
+
+	long done = 0, todo, offset, c, i;
+	while( done < numSamples )
+	{
+		offset = (long)(pos & (sc->frames-1));
+		todo = numSamples - done;
+		if( todo > sc->frames - offset )
+			todo = sc->frames - offset;
+
+		for( c = 0; c < numChans; c++ )
+		{
+			float* dest = &sc->chans[c][offset];
+			if( isFloat )
+			{
+				const float* src = &((const float*)buffer)[done*chans + c];
+				for( i = 0; i < todo; i++ )
+					dest[i] = src[i*chans];
+			}
+			else
+			{
+				const signed short* src = &((const signed short*)buffer)[done*chans + c];
+				for( i = 0; i < todo; i++ )
+					dest[i] = src[i*chans] * (1.0F / 32768.0F);
+			}
+		}
+
+		for( c = numChans; c < sc->numChans; c++ )
+			memset(&sc->chans[c][offset], 0, todo*sizeof(float));
+
+		done += todo;
+		pos += todo;
+	}
+
+	// publish the samples; this is a full barrier, the reader sees the data before the position
+	InterlockedExchangeAdd(&sc->writePos, numSamples);
+}
+
+
+
+static void CALLBACK sidechainWrite(HDSP /*dspHandle*/, DWORD channelHandle, void* buffer, DWORD length, USERPTR sc__)
+{
+	// the ring exists as long as this DSP, see sidechainSet(); the data written before
+	// the ring is given to the plugin are read by its first block
+	BASS_CHANNELINFO info;
+
+	allocCheckEnter();
+		if( buffer && length > 0 && BASS_ChannelGetInfo(channelHandle, &info) && info.chans > 0 )
+			writeRing((SIDECHAIN*)sc__, buffer, length, &info);
+	allocCheckLeave();
+}
+
+
+
+/*****************************************************************************
+ *  the plugin, audio thread with the plugin locked
+ *****************************************************************************/
+
+
+
+void sidechainRead(BASS_VST_PLUGIN* this_, long numSamples, bool isDouble)
+{
+	SIDECHAIN* sc = this_->sidechain;
+	long first = sc->firstInput, numChans = sc->numChans, c, i;
+	if( first + numChans > this_->numActiveInputs )
+		numChans = this_->numActiveInputs - first;
+
+	unsigned long pos = (unsigned long)sc->readPos;
+	long fill = (long)((unsigned long)InterlockedExchangeAdd(&sc->writePos, 0) - pos);
+
+	// drift handling: if the source was ahead all the time, drop the excess
+	if( sc->windowSamples >= sc->windowLength )
+	{
+		if( sc->windowMinSlack > SIDECHAIN_MARGIN )
+		{
+			long skip = sc->windowMinSlack - SIDECHAIN_MARGIN;
+			if( skip > fill )
+				skip = fill;
+			pos += skip;
+			fill -= skip;
+		}
+		sc->windowSamples = 0;
+		sc->windowMinSlack = sc->frames;
+	}
+
+	long got = fill < numSamples? fill : numSamples;
+	if( fill - got < sc->windowMinSlack )
+		sc->windowMinSlack = fill - got;
+	sc->windowSamples += numSamples;
+
+	long offset = (long)(pos & (sc->frames-1));
+	if( got == numSamples && offset + numSamples <= sc->frames && !isDouble && !useDoubleReplacing(this_) )
+	{
+		// the plugin reads directly from the ring; the inputs are not converted in place then
+		for( c = 0; c < numChans; c++ )
+		{
+			sc->savedIn[c] = this_->buffersIn[first+c];
+			this_->buffersIn[first+c] = &sc->chans[c][offset];
+			sc->lastSample[c] = sc->chans[c][offset+numSamples-1];
+		}
+		sc->borrowed = true;
+	}
+	else
+	{
+		long done = 0, todo;
+		unsigned long p = pos;
+		while( done < got )
+		{
+			offset = (long)(p & (sc->frames-1));
+			todo = got - done;
+			if( todo > sc->frames - offset )
+				todo = sc->frames - offset;
+
+			for( c = 0; c < numChans; c++ )
+			{
+				const float* src = &sc->chans[c][offset];
+				if( isDouble )
+				{
+					double* dest = &((double*)this_->buffersIn[first+c])[done];
+					for( i = 0; i < todo; i++ )
+						dest[i] = src[i];
+				}
+				else
+				{
+					memcpy(&this_->buffersIn[first+c][done], src, todo*sizeof(float));
+				}
+				sc->lastSample[c] = src[todo-1];
+			}
+
+			done += todo;
+			p += todo;
+		}
+
+		// the source lags behind: hold the last sample for short gaps, silence otherwise
+		for( c = 0; c < numChans && got < numSamples; c++ )
+		{
+			float value = numSamples - got <= SIDECHAIN_MAX_HOLD? sc->lastSample[c] : 0.0F;
+			if( isDouble )
+			{
+				double* dest = (double*)this_->buffersIn[first+c];
+				for( i = got; i < numSamples; i++ )
+					dest[i] = value;
+			}
+			else
+			{
+				float* dest = this_->buffersIn[first+c];
+				for( i = got; i < numSamples; i++ )
+					dest[i] = value;
+			}
+			sc->lastSample[c] = value;
+		}
+	}
+
+	sc->readEnd = (long)(pos + got);
+}
+
+
+
+void sidechainRelease(BASS_VST_PLUGIN* this_)
+{
+	// called after processing the block taken by sidechainRead()
+	SIDECHAIN* sc = this_->sidechain;
+	if( sc->borrowed )
+	{
+		long first = sc->firstInput, c;
+		for( c = 0; c < sc->numChans && first + c < this_->numActiveInputs; c++ )
+			this_->buffersIn[first+c] = sc->savedIn[c];
+		sc->borrowed = false;
+	}
+
+	// give the samples back to the writer; there is only one writer of readPos, the
+	// exchange is needed for the barrier
+	InterlockedCompareExchange(&sc->readPos, sc->readEnd, sc->readPos);
+}
+
+
+
+void sidechainSkip(BASS_VST_PLUGIN* this_, long numSamples)
+{
+	// called instead of sidechainRead() while the plugin sleeps or is bypassed
+	SIDECHAIN* sc = this_->sidechain;
+	long fill = (long)((unsigned long)InterlockedExchangeAdd(&sc->writePos, 0) - (unsigned long)sc->readPos);
+	sc->readEnd = sc->readPos + (fill < numSamples? fill : numSamples);
+	sc->windowSamples = 0;
+	sc->windowMinSlack = sc->frames;
+	sidechainRelease(this_);
+}
+
+
+
+/*****************************************************************************
+ *  setting the source
+ *****************************************************************************/
+
+
+
+static void freeSidechain(SIDECHAIN* sc)
+{
+	if( sc )
+	{
+		arenaFree(&sc->arena);
+		free(sc);
+	}
+}
+
+
+
+static SIDECHAIN* allocSidechain(DWORD sourceChannel, long firstInput, long numChans, DWORD freq, long blockSize)
+{
+	long frames = 1, c;
+	while( frames < (long)(freq * SIDECHAIN_RING_MS / 1000) || frames < blockSize * SIDECHAIN_RING_BLOCKS )
+		frames <<= 1;
+
+	SIDECHAIN* sc = (SIDECHAIN*)calloc(1, sizeof(SIDECHAIN));
+	if( sc == NULL )
+		return NULL;
+
+	size_t stride = arenaStride(frames*sizeof(float));
+	if( !arenaAlloc(&sc->arena, stride*numChans) )
+	{
+		free(sc);
+		return NULL;
+	}
+
+	BYTE* p = sc->arena.mem;
+	for( c = 0; c < numChans; c++, p += stride )
+		sc->chans[c] = (float*)p;
+
+	sc->sourceChannel = sourceChannel;
+	sc->firstInput = firstInput;
+	sc->numChans = numChans;
+	sc->frames = frames;
+	sc->windowLength = (long)(freq * SIDECHAIN_WINDOW_MS / 1000);
+	sc->windowMinSlack = frames;
+	return sc;
+}
+
+
+
+DWORD sidechainSet(BASS_VST_PLUGIN* this_, DWORD sourceChannel, long firstInput)
+{
+	// sourceChannel=0 removes the sidechain; BASS functions are not called while
+	// holding vstCritical_ as the DSPs may wait for it while BASS holds a lock on the channel
+	BASS_CHANNELINFO	info, sourceInfo;
+	SIDECHAIN*			sc = NULL;
+
+	if( sourceChannel )
+	{
+		if( this_->buffersIn == NULL || !BASS_ChannelGetInfo(this_->channelHandle, &info) )
+			return BASS_ERROR_NOTAVAIL; // no channel assigned
+
+		if( !BASS_ChannelGetInfo(sourceChannel, &sourceInfo) || sourceInfo.chans <= 0 )
+			return BASS_ERROR_HANDLE;
+
+		if( firstInput < 0 || firstInput >= this_->aeffect->numInputs || firstInput >= this_->numActiveInputs )
+			return BASS_ERROR_ILLPARAM;
+
+		if( sourceInfo.freq != info.freq )
+			return BASS_ERROR_FORMAT;
+
+		long numChans = this_->aeffect->numInputs - firstInput;
+		if( numChans > (long)sourceInfo.chans )
+			numChans = sourceInfo.chans;
+		if( firstInput + numChans > MAX_CHANS )
+			numChans = MAX_CHANS - firstInput;
+
+		sc = allocSidechain(sourceChannel, firstInput, numChans, info.freq, this_->effBlockSize);
+		if( sc == NULL )
+			return BASS_ERROR_MEM;
+
+		sc->dspHandle = BASS_ChannelSetDSP(sourceChannel, sidechainWrite, (USERPTR)sc, SIDECHAIN_DSP_PRIORITY);
+		if( sc->dspHandle == 0 )
+		{
+			freeSidechain(sc);
+			return BASS_ERROR_HANDLE;
+		}
+	}
+
+	enterVstCritical(this_);
+		SIDECHAIN* oldSc = this_->sidechain;
+		this_->sidechain = sc;
+	leaveVstCritical(this_);
+
+	if( oldSc )
+	{
+		// BASS does not return while the DSP runs; if the source is already freed, so is the DSP
+		BASS_ChannelRemoveDSP(oldSc->sourceChannel, oldSc->dspHandle);
+		freeSidechain(oldSc);
+	}
+
+	return BASS_OK;
+}
+
+
+
+void sidechainFree(BASS_VST_PLUGIN* this_)
+{
+	// called by destroyHandle(), nobody else uses the plugin any longer
+	SIDECHAIN* sc = this_->sidechain;
+	if( sc )
+	{
+		BASS_ChannelRemoveDSP(sc->sourceChannel, sc->dspHandle);
+		freeSidechain(sc);
+	}
+	this_->sidechain = NULL;
+}
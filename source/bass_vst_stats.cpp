@@ -0,0 +1,261 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_stats.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Processing statistics (BASS_VST_GetStats)
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *	18.10.2026	Lock profiling added
+ *
+ *****************************************************************************
+ *
+ *	Hint: the statistics are written by the audio thread only and read by
+ *	BASS_VST_GetStats() without any locking.  So a caller may see a block
+ *	half-counted, which is no problem for the intended purpose.
+ *
+ *	The processing times are collected in a logarithmic histogram with 4
+ *	buckets per octave; the p99 value is the upper limit of the bucket
+ *	containing the 99th percentile, so it is at most ~25% too high.
+ *
+ *	The lock statistics are shared by all threads and are only collected if
+ *	switched on by BASS_VST_CONFIG_LOCK_STATS or by the environment variable
+ *	BASS_VST_LOCK_STATS; a lock is first tried and only if this fails, the
+ *	wait time is measured.  If the environment variable is set, the
+ *	statistics are written to stderr on exit - or appended to the file given
+ *	in the variable if its value is not "1".
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+
+
+/*****************************************************************************
+ *  collecting and summarizing the data
+ *****************************************************************************/
+
+
+
+static int highestBit(DWORD v)
+{
+	int bit = 0;
+	while( v >>= 1 )
+		bit++;
+	return bit;
+}
+
+
+
+static int timeToBucket(DWORD ns)
+{
+	if( ns < 8 )
+		return ns;
+
+	int bit = highestBit(ns);
+	return bit*4 + ((ns>>(bit-2))&3) - 4;
+}
+
+
+
+static DWORD bucketToTime(int bucket)
+{
+	if( bucket < 8 )
+		return bucket;
+
+	int bit = bucket/4 + 1, sub = bucket%4;
+	QWORD upper = ((QWORD)(5+sub) << (bit-2)) - 1;
+	return upper > 0xFFFFFFFF? 0xFFFFFFFF : (DWORD)upper;
+}
+
+
+
+void statsAddBlock(BASS_VST_PLUGIN* this_, long numSamples, QWORD processNs)
+{
+	PROCESS_STATS* stats = &this_->stats;
+	DWORD ns = processNs > 0xFFFFFFFF? 0xFFFFFFFF : (DWORD)processNs;
+
+	stats->lastNs = ns;
+	if( ns > stats->maxNs )
+		stats->maxNs = ns;
+	stats->totalNs += ns;
+	stats->timeHistogram[timeToBucket(ns)]++;
+
+	int sizeIndex = highestBit((DWORD)numSamples);
+	if( sizeIndex >= BASS_VST_STATS_BLOCKSIZES )
+		sizeIndex = BASS_VST_STATS_BLOCKSIZES-1;
+	stats->blockSizes[sizeIndex]++;
+
+	stats->samples += numSamples;
+	stats->blocks++; // last, a reader uses this to check for data
+}
+
+
+
+void statsGet(BASS_VST_PLUGIN* this_, BASS_VST_STATS* ret)
+{
+	const PROCESS_STATS* stats = &this_->stats;
+	memset(ret, 0, sizeof(BASS_VST_STATS));
+
+	ret->blocks				= stats->blocks;
+	ret->samples			= stats->samples;
+	ret->lastTime			= stats->lastNs;
+	ret->maxTime			= stats->maxNs;
+	ret->vstLockWait		= stats->vstLockWaitNs;
+	ret->sleeps				= stats->sleeps;
+	ret->sleepSamples		= stats->sleepSamples;
+	ret->sleeping			= this_->sleeping? TRUE : FALSE;
+	ret->nonFiniteBlocks	= stats->nonFiniteBlocks;
+	memcpy(ret->blockSizes, stats->blockSizes, sizeof(ret->blockSizes));
+
+	if( ret->blocks == 0 )
+		return;
+
+	ret->meanTime = (DWORD)(stats->totalNs / ret->blocks);
+
+	// find the 99th percentile in a copy of the histogram as the audio thread may change it meanwhile
+	DWORD histogram[STATS_TIME_BUCKETS], total = 0, sum = 0;
+	int bucket;
+	memcpy(histogram, stats->timeHistogram, sizeof(histogram));
+	for( bucket = 0; bucket < STATS_TIME_BUCKETS; bucket++ )
+		total += histogram[bucket];
+
+	for( bucket = 0; bucket < STATS_TIME_BUCKETS-1; bucket++ )
+	{
+		sum += histogram[bucket];
+		if( (QWORD)sum * 100 >= (QWORD)total * 99 )
+			break;
+	}
+
+	ret->p99Time = bucketToTime(bucket);
+	if( ret->p99Time > ret->maxTime )
+		ret->p99Time = ret->maxTime;
+}
+
+
+
+/*****************************************************************************
+ *  lock profiling
+ *****************************************************************************/
+
+
+
+volatile bool s_lockStatsOn = false;
+
+static struct
+{
+	volatile QWORD	acquisitions;
+	volatile QWORD	contended;
+	volatile QWORD	waitNs;
+} s_lockStats[BASS_VST_LOCK_CLASSES];
+
+static const char* s_lockNames[BASS_VST_LOCK_CLASSES] =
+{
+	"s_handleCritical", "s_forwardCritical", "s_idleCritical", "vstCritical_", "midiCritical_", "delayCritical_"
+};
+
+
+
+static void atomicAdd(volatile QWORD* value, QWORD add)
+{
+#ifdef _WIN32
+	InterlockedExchangeAdd64((volatile LONGLONG*)value, (LONGLONG)add);
+#else
+	__sync_fetch_and_add(value, add);
+#endif
+}
+
+
+
+void lockEnter(CRITICAL_SECTION* cs, int lockClass)
+{
+	if( !s_lockStatsOn )
+	{
+		EnterCriticalSection(cs);
+		return;
+	}
+
+	if( !TryEnterCriticalSection(cs) )
+	{
+		QWORD waitNs = getTimeNs();
+		EnterCriticalSection(cs);
+		waitNs = getTimeNs() - waitNs;
+
+		atomicAdd(&s_lockStats[lockClass].contended, 1);
+		atomicAdd(&s_lockStats[lockClass].waitNs, waitNs);
+	}
+
+	atomicAdd(&s_lockStats[lockClass].acquisitions, 1);
+}
+
+
+
+void lockTried(int lockClass, BOOL success)
+{
+	// for locks that are only tried, a failure is counted as contention without any wait time
+	if( !s_lockStatsOn )
+		return;
+
+	if( success )
+		atomicAdd(&s_lockStats[lockClass].acquisitions, 1);
+	else
+		atomicAdd(&s_lockStats[lockClass].contended, 1);
+}
+
+
+
+void lockStatsReset()
+{
+	memset((void*)s_lockStats, 0, sizeof(s_lockStats));
+}
+
+
+
+void lockStatsGet(int lockClass, BASS_VST_LOCK_STATS* ret)
+{
+	ret->acquisitions	= s_lockStats[lockClass].acquisitions;
+	ret->contended		= s_lockStats[lockClass].contended;
+	ret->waitTime		= s_lockStats[lockClass].waitNs;
+}
+
+
+
+void lockStatsInit()
+{
+	const char* env = getenv("BASS_VST_LOCK_STATS");
+	if( env && env[0] && strcmp(env, "0") != 0 )
+	{
+		lockStatsReset();
+		s_lockStatsOn = true;
+	}
+}
+
+
+
+void lockStatsExit()
+{
+	const char* env = getenv("BASS_VST_LOCK_STATS");
+	if( env == NULL || env[0] == 0 || strcmp(env, "0") == 0 )
+		return;
+
+	FILE* f = strcmp(env, "1") == 0? stderr : fopen(env, "a");
+	if( f == NULL )
+		return;
+
+	fprintf(f, "BASS_VST lock statistics:\n");
+	for( int lockClass = 0; lockClass < BASS_VST_LOCK_CLASSES; lockClass++ )
+	{
+		BASS_VST_LOCK_STATS stats;
+		lockStatsGet(lockClass, &stats);
+		fprintf(f, "%-20s %12.0f acquisitions, %10.0f contended, %12.3f ms waited\n",
+			s_lockNames[lockClass], (double)stats.acquisitions, (double)stats.contended,
+			(double)stats.waitTime / 1000000.0);
+	}
+
+	if( f != stderr )
+		fclose(f);
+}
@@ -0,0 +1,239 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_transport.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Host transport and tempo map reported by audioMasterGetTime
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the VstTimeInfo structure of a plugin is calculated once per
+ *	block by transportUpdate() from the transport position, the tempo map
+ *	and the transport state set by the application (see
+ *	BASS_VST_SetTransport() and BASS_VST_SetTempoMap()); audioMasterGetTime
+ *	just returns it.  The structure is double-buffered: transportUpdate()
+ *	fills the snapshot not in use and publishes it then, so the snapshot
+ *	returned to the plugin is never changed while the block is processed.
+ *	While processing, audioMasterGetTime is answered without any lock, see
+ *	audioMasterCallbackImpl().
+ *
+ *	The position follows the samples processed while playing; if the
+ *	position of the channel is changed, a sync relocates the transport.
+ *	Relocations are only noted by the thread setting them and applied by
+ *	the audio thread with the next block.
+ *
+ *****************************************************************************/
+
+
+
+#include "bass_vst_impl.h"
+
+
+
+#define DEFAULT_TEMPO				120.0
+#define DEFAULT_TIME_SIG_NUMERATOR		4
+#define DEFAULT_TIME_SIG_DENOMINATOR	4
+
+
+
+void transportInit(BASS_VST_PLUGIN* this_)
+{
+	this_->transport.playing = true;
+	transportUpdate(this_, 0.0); // the time info until the plugin is assigned to a channel
+}
+
+
+
+void transportFree(BASS_VST_PLUGIN* this_)
+{
+	if( this_->transport.tempoMap )
+		free(this_->transport.tempoMap);
+	this_->transport.tempoMap = NULL;
+	this_->transport.tempoCount = 0;
+}
+
+
+
+/*****************************************************************************
+ *  calculating the time info, audio thread
+ *****************************************************************************/
+
+
+
+void transportUpdate(BASS_VST_PLUGIN* this_, double sampleRate)
+{
+	TRANSPORT*		t = &this_->transport;
+	long			index = this_->vstTimeInfoIndex ^ 1;
+	VstTimeInfo*	ti = &this_->vstTimeInfo[index];
+
+	if( sampleRate <= 0.0 )
+		sampleRate = 44100.0;
+	sampleRate *= pluginRateRatio(this_); // the position is given in samples of the plugin
+
+	// relocated by BASS_VST_SetTransportPos() or by setting the channel's position?
+	if( InterlockedExchange(&t->relocatePending, 0) )
+	{
+		t->samplePos = floor(t->relocateSeconds * sampleRate + 0.5);
+		t->changed = true;
+	}
+
+	ti->samplePos = t->samplePos;
+	ti->sampleRate = sampleRate;
+	ti->nanoSeconds = (double)getTimeNs();
+	ti->flags = kVstNanosValid | kVstPpqPosValid | kVstTempoValid | kVstBarsValid | kVstTimeSigValid | kVstSmpteValid;
+	if( t->playing )
+		ti->flags |= kVstTransportPlaying;
+	if( t->changed )
+		ti->flags |= kVstTransportChanged;
+	t->changed = false;
+
+	// find the tempo map entry; normally, this is the one used for the last block
+	static const TEMPO_ENTRY defaultEntry = { 0.0, 0.0, DEFAULT_TEMPO, DEFAULT_TIME_SIG_NUMERATOR, DEFAULT_TIME_SIG_DENOMINATOR };
+	const TEMPO_ENTRY* e = &defaultEntry;
+	double seconds = ti->samplePos / sampleRate;
+	if( t->tempoMap )
+	{
+		long i = t->tempoCursor;
+		if( i >= t->tempoCount || seconds < t->tempoMap[i].seconds )
+			i = 0;
+		while( i + 1 < t->tempoCount && seconds >= t->tempoMap[i+1].seconds )
+			i++;
+		t->tempoCursor = i;
+		e = &t->tempoMap[i];
+	}
+
+	ti->tempo = e->tempo;
+	ti->ppqPos = e->ppqPos + (seconds - e->seconds) * e->tempo / 60.0;
+	ti->timeSigNumerator = e->timeSigNumerator;
+	ti->timeSigDenominator = e->timeSigDenominator;
+
+	// a time signature entry starts a new bar
+	double barLength = 4.0 * e->timeSigNumerator / e->timeSigDenominator;
+	ti->barStartPos = e->ppqPos + floor((ti->ppqPos - e->ppqPos) / barLength) * barLength;
+
+	if( t->cycleActive )
+	{
+		ti->cycleStartPos = t->cycleStart;
+		ti->cycleEndPos = t->cycleEnd;
+		ti->flags |= kVstCyclePosValid | kVstTransportCycleActive;
+	}
+
+	static const double smpteFps[] = { 24.0, 25.0, 24.0, 30.0, 29.97, 30.0 };
+	ti->smpteFrameRate = kVstSmpte24fps;
+	ti->smpteOffset = (VstInt32)((seconds - floor(seconds)) * smpteFps[ti->smpteFrameRate] * 80.0);
+
+	// publish the snapshot; there is only one writer, the exchange is needed for the barrier
+	InterlockedCompareExchange(&this_->vstTimeInfoIndex, index, index ^ 1);
+}
+
+
+
+void transportAdvance(BASS_VST_PLUGIN* this_, long numSamples)
+{
+	if( this_->transport.playing )
+		this_->transport.samplePos += numSamples * pluginRateRatio(this_);
+}
+
+
+
+/*****************************************************************************
+ *  setting the transport
+ *****************************************************************************/
+
+
+
+DWORD transportSetTempoMap(BASS_VST_PLUGIN* this_, const BASS_VST_TEMPO* tempos, DWORD count)
+{
+	// the entries must start at 0 and must be sorted; we calculate the seconds of each
+	// entry here, so the audio thread needs only a few operations per block
+	TEMPO_ENTRY* newMap = NULL;
+	DWORD i;
+	if( count )
+	{
+		if( tempos == NULL || tempos[0].ppqPos != 0.0 )
+			return BASS_ERROR_ILLPARAM;
+
+		for( i = 0; i < count; i++ )
+		{
+			if( tempos[i].tempo <= 0.0
+			 || tempos[i].timeSigNumerator == 0
+			 || tempos[i].timeSigDenominator == 0
+			 || (i > 0 && tempos[i].ppqPos <= tempos[i-1].ppqPos) )
+				return BASS_ERROR_ILLPARAM;
+		}
+
+		newMap = (TEMPO_ENTRY*)malloc(count * sizeof(TEMPO_ENTRY));
+		if( newMap == NULL )
+			return BASS_ERROR_MEM;
+
+		for( i = 0; i < count; i++ )
+		{
+			newMap[i].ppqPos = tempos[i].ppqPos;
+			newMap[i].seconds = i == 0? 0.0 : newMap[i-1].seconds + (tempos[i].ppqPos - tempos[i-1].ppqPos) * 60.0 / tempos[i-1].tempo;
+			newMap[i].tempo = tempos[i].tempo;
+			newMap[i].timeSigNumerator = tempos[i].timeSigNumerator;
+			newMap[i].timeSigDenominator = tempos[i].timeSigDenominator;
+		}
+	}
+
+	enterVstCritical(this_);
+		TEMPO_ENTRY* oldMap = this_->transport.tempoMap;
+		this_->transport.tempoMap = newMap;
+		this_->transport.tempoCount = count;
+		this_->transport.tempoCursor = 0;
+		this_->transport.changed = true;
+	leaveVstCritical(this_);
+
+	if( oldMap )
+		free(oldMap);
+
+	return BASS_OK;
+}
+
+
+
+DWORD transportSet(BASS_VST_PLUGIN* this_, const BASS_VST_TRANSPORT* transport)
+{
+	if( transport->cycleActive && transport->cycleEnd <= transport->cycleStart )
+		return BASS_ERROR_ILLPARAM;
+
+	enterVstCritical(this_);
+		TRANSPORT* t = &this_->transport;
+		bool playing = transport->playing? true : false;
+		bool cycleActive = transport->cycleActive? true : false;
+		if( playing != t->playing || cycleActive != t->cycleActive )
+			t->changed = true;
+		t->playing = playing;
+		t->cycleActive = cycleActive;
+		t->cycleStart = transport->cycleStart;
+		t->cycleEnd = transport->cycleEnd;
+	leaveVstCritical(this_);
+
+	return BASS_OK;
+}
+
+
+
+void transportGet(BASS_VST_PLUGIN* this_, BASS_VST_TRANSPORT* ret)
+{
+	enterVstCritical(this_);
+		ret->playing = this_->transport.playing? TRUE : FALSE;
+		ret->cycleActive = this_->transport.cycleActive? TRUE : FALSE;
+		ret->cycleStart = this_->transport.cycleStart;
+		ret->cycleEnd = this_->transport.cycleEnd;
+	leaveVstCritical(this_);
+}
+
+
+
+void transportRelocate(BASS_VST_PLUGIN* this_, double seconds)
+{
+	// may be called from any thread, also while the audio thread processes the plugin;
+	// the new position is applied with the next block
+	this_->transport.relocateSeconds = seconds;
+	InterlockedCompareExchange(&this_->transport.relocatePending, 1, 0); // full barrier
+}
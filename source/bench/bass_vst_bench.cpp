@@ -0,0 +1,402 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_bench.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Benchmark of the processing and the hot API functions
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the DSP part pulls noise through chains of stub plugins on decode
+ *	channels for all combinations of the sample formats, channel counts,
+ *	block sizes and chain lengths below and reports the time per sample
+ *	(one sample of all channels).  The time of the same channel without any
+ *	plugin is subtracted for the time per plugin, so the numbers are the
+ *	overhead of doEffectProcess() plus the (tiny) work of the stub.
+ *	Instruments (plugins without inputs) are measured as the channel
+ *	created by BASS_VST_ChannelCreate() with some notes held instead; the
+ *	chain is 1 then and there is nothing to subtract.
+ *
+ *	The API part measures the functions called most often while playing:
+ *	BASS_VST_SetParam()/BASS_VST_GetParam() (the handle lookup) and
+ *	BASS_VST_ProcessEvent() (queueing MIDI events).
+ *
+ *	The sandbox part compares the plugin loaded with and without
+ *	BASS_VST_SANDBOX for each block size: the time added per block is the
+ *	latency of the round trip to the child process, the CPU time is given
+ *	for the host thread and the child (the latter includes loading the
+ *	plugin).  Blocks the child did not deliver in time are counted as
+ *	dropouts, they are silence.
+ *
+ *	Usage: bass_vst_bench [-plugin <name>|<file>] [-seconds <s>] [-dsp] [-api]
+ *	                      [-sandbox]
+ *	The plugin defaults to the "gain" stub; -seconds is the time per
+ *	measurement, default 0.05.  Without -dsp, -api or -sandbox, all parts
+ *	are run.
+ *
+ *****************************************************************************/
+
+
+
+#include <sys/resource.h>
+#include "bench_common.h"
+#include "bassmidi.h"
+
+
+
+static const DWORD	s_chans[]		= { 1, 2, 6, 8 };
+static const DWORD	s_blockSizes[]	= { 64, 256, 1024, 4096 };
+static const int	s_chainLengths[]= { 0, 1, 2, 4, 8 };
+
+#define ARRAY_SIZE(a)	(sizeof(a)/sizeof((a)[0]))
+
+
+
+/*****************************************************************************
+ *  the DSP path
+ *****************************************************************************/
+
+
+
+static double measureChain(bool isFloat, DWORD chans, DWORD blockSize, int chainLength, const char* plugin, double seconds)
+{
+	// returns the time per sample in nanoseconds
+	BENCH_SOURCE	src;
+	HSTREAM			stream = benchCreateSource(chans, isFloat, &src);
+	DWORD			bytes = blockSize * chans * (isFloat? sizeof(float) : sizeof(short));
+	void*			buffer = malloc(bytes);
+	QWORD			samples = 0;
+	int				i;
+
+	for( i = 0; i < chainLength; i++ )
+		benchAddPlugin(stream, plugin, 0);
+
+	// warm up, this also allocates everything needed by the plugins
+	for( i = 0; i < 16; i++ )
+		BASS_ChannelGetData(stream, buffer, bytes);
+
+	double start = benchNow(), elapsed;
+	do
+	{
+		for( i = 0; i < 16; i++ )
+			BASS_ChannelGetData(stream, buffer, bytes);
+		samples += 16 * blockSize;
+		elapsed = benchNow() - start;
+	}
+	while( elapsed < seconds );
+
+	BASS_StreamFree(stream); // also frees the plugins
+	free(buffer);
+	return elapsed * 1e9 / samples;
+}
+
+
+
+static double measureInstrument(bool isFloat, DWORD chans, DWORD blockSize, const char* plugin, double seconds)
+{
+	// returns the time per sample in nanoseconds
+	char			buf[1024];
+	DWORD			bytes = blockSize * chans * (isFloat? sizeof(float) : sizeof(short));
+	void*			buffer = malloc(bytes);
+	QWORD			samples = 0;
+	int				i;
+
+	DWORD vstHandle = BASS_VST_ChannelCreate(44100, chans, benchPluginPath(plugin, buf, sizeof(buf)),
+		BASS_STREAM_DECODE | (isFloat? BASS_SAMPLE_FLOAT : 0));
+	if( vstHandle == 0 )
+	{
+		fprintf(stderr, "cannot load %s, error %d\n", buf, BASS_ErrorGetCode());
+		exit(1);
+	}
+
+	// hold some notes so that the instrument cannot go to sleep
+	for( i = 0; i < 8; i++ )
+		BASS_VST_ProcessEvent(vstHandle, 0, MIDI_EVENT_NOTE, MAKEWORD(48 + i * 3, 100));
+
+	for( i = 0; i < 16; i++ )
+		BASS_ChannelGetData(vstHandle, buffer, bytes);
+
+	double start = benchNow(), elapsed;
+	do
+	{
+		for( i = 0; i < 16; i++ )
+			BASS_ChannelGetData(vstHandle, buffer, bytes);
+		samples += 16 * blockSize;
+		elapsed = benchNow() - start;
+	}
+	while( elapsed < seconds );
+
+	BASS_VST_ChannelFree(vstHandle);
+	free(buffer);
+	return elapsed * 1e9 / samples;
+}
+
+
+
+static bool isInstrument(const char* plugin)
+{
+	BENCH_SOURCE	src;
+	char			buf[1024];
+	HSTREAM			stream = benchCreateSource(2, true, &src);
+	bool			ret = BASS_VST_ChannelSetDSP(stream, benchPluginPath(plugin, buf, sizeof(buf)), 0, 0) == 0
+					   && BASS_ErrorGetCode() == BASS_VST_ERROR_NOINPUTS;
+	BASS_StreamFree(stream);
+	return ret;
+}
+
+
+
+static void benchDsp(const char* plugin, double seconds)
+{
+	bool instrument = isInstrument(plugin);
+
+	printf("DSP path, plugin \"%s\", ns per sample of all channels\n\n", plugin);
+	printf("format  chans  block  chain  ns/sample  ns/sample/plugin\n");
+
+	for( int isFloat = 0; isFloat <= 1; isFloat++ )
+	{
+		for( size_t c = 0; c < ARRAY_SIZE(s_chans); c++ )
+		{
+			for( size_t b = 0; b < ARRAY_SIZE(s_blockSizes); b++ )
+			{
+				if( instrument )
+				{
+					double ns = measureInstrument(isFloat? true : false, s_chans[c], s_blockSizes[b], plugin, seconds);
+					printf("%-6s  %5u  %5u  %5d  %9.2f  %16.2f\n", isFloat? "float" : "16-bit",
+						(unsigned)s_chans[c], (unsigned)s_blockSizes[b], 1, ns, ns);
+					continue;
+				}
+
+				double none = 0.0;
+				for( size_t l = 0; l < ARRAY_SIZE(s_chainLengths); l++ )
+				{
+					double ns = measureChain(isFloat? true : false, s_chans[c], s_blockSizes[b], s_chainLengths[l], plugin, seconds);
+					if( s_chainLengths[l] == 0 )
+					{
+						none = ns;
+						continue;
+					}
+					printf("%-6s  %5u  %5u  %5d  %9.2f  %16.2f\n", isFloat? "float" : "16-bit",
+						(unsigned)s_chans[c], (unsigned)s_blockSizes[b], s_chainLengths[l],
+						ns, (ns - none) / s_chainLengths[l]);
+				}
+			}
+		}
+	}
+	printf("\n");
+}
+
+
+
+/*****************************************************************************
+ *  the API functions
+ *****************************************************************************/
+
+
+
+static void benchApi(double seconds)
+{
+	BENCH_SOURCE	src;
+	HSTREAM			stream = benchCreateSource(2, true, &src);
+	DWORD			vstHandle = benchAddPlugin(stream, "heavyparam", 0);
+	DWORD			sink = benchAddPlugin(stream, "midisink", 0);
+	float			buffer[2*64];
+	long			calls = 0, i;
+	double			start, elapsed;
+
+	printf("API functions, ns per call\n\n");
+
+	start = benchNow();
+	do
+	{
+		for( i = 0; i < 1024; i++ )
+			BASS_VST_SetParam(vstHandle, (int)i, (i & 1)? 0.25F : 0.75F);
+		calls += 1024;
+		elapsed = benchNow() - start;
+	}
+	while( elapsed < seconds );
+	printf("BASS_VST_SetParam()      %9.2f\n", elapsed * 1e9 / calls);
+
+	calls = 0;
+	float sum = 0.0F;
+	start = benchNow();
+	do
+	{
+		for( i = 0; i < 1024; i++ )
+			sum += BASS_VST_GetParam(vstHandle, (int)i);
+		calls += 1024;
+		elapsed = benchNow() - start;
+	}
+	while( elapsed < seconds );
+	printf("BASS_VST_GetParam()      %9.2f\n", elapsed * 1e9 / calls);
+
+	// the queue is emptied by rendering a short block after each batch, this is not measured
+	calls = 0;
+	elapsed = 0.0;
+	do
+	{
+		start = benchNow();
+		for( i = 0; i < 64; i++ )
+			BASS_VST_ProcessEvent(sink, 0, MIDI_EVENT_NOTE, MAKEWORD(60 + (i & 15), (i & 16)? 0 : 100));
+		elapsed += benchNow() - start;
+		calls += 64;
+		BASS_ChannelGetData(stream, buffer, sizeof(buffer));
+	}
+	while( elapsed < seconds );
+	printf("BASS_VST_ProcessEvent()  %9.2f\n\n", elapsed * 1e9 / calls);
+
+	BASS_StreamFree(stream);
+	if( sum < 0.0F )
+		printf("%f\n", sum); // never true, keeps the calls from being optimized away
+}
+
+
+
+/*****************************************************************************
+ *  the sandbox
+ *****************************************************************************/
+
+
+
+static double childCpu()
+{
+	// the CPU time of all terminated children, the sandbox processes are reaped when their plugin is freed
+	struct rusage ru;
+	getrusage(RUSAGE_CHILDREN, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+
+
+static void measureBlocks(DWORD flags, DWORD blockSize, const char* plugin, bool instrument, double seconds,
+						  double* wallUs, double* cpuUs, double* childCpuUs, long* dropouts)
+{
+	BENCH_SOURCE	src;
+	HSTREAM			stream;
+	DWORD			bytes = blockSize * 2 * sizeof(float);
+	float*			buffer = (float*)malloc(bytes);
+	long			blocks = 0, i;
+	double			childStart = childCpu();
+
+	if( instrument )
+	{
+		// an instrument is the channel itself, some notes are held so that it is never silent
+		char buf[1024];
+		stream = BASS_VST_ChannelCreate(44100, 2, benchPluginPath(plugin, buf, sizeof(buf)), BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT | flags);
+		if( stream == 0 )
+		{
+			fprintf(stderr, "cannot load %s, error %d\n", buf, BASS_ErrorGetCode());
+			exit(1);
+		}
+		for( i = 0; i < 8; i++ )
+			BASS_VST_ProcessEvent(stream, 0, MIDI_EVENT_NOTE, MAKEWORD(48 + i * 3, 100));
+	}
+	else
+	{
+		stream = benchCreateSource(2, true, &src);
+		benchAddPlugin(stream, plugin, flags);
+	}
+
+	for( i = 0; i < 16; i++ )
+		BASS_ChannelGetData(stream, buffer, bytes);
+
+	*dropouts = 0;
+	double start = benchNow(), cpuStart = benchThreadCpu(), elapsed;
+	do
+	{
+		BASS_ChannelGetData(stream, buffer, bytes);
+		blocks++;
+
+		// the output is never silent, so a silent block is one the child did not deliver in time
+		for( i = 0; i < (long)blockSize * 2 && buffer[i] == 0.0F; i++ )
+			;
+		if( i == (long)blockSize * 2 )
+			(*dropouts)++;
+
+		elapsed = benchNow() - start;
+	}
+	while( elapsed < seconds );
+	double cpu = benchThreadCpu() - cpuStart;
+
+	if( instrument )
+		BASS_VST_ChannelFree(stream);
+	else
+		BASS_StreamFree(stream);
+	free(buffer);
+
+	*wallUs = elapsed * 1e6 / blocks;
+	*cpuUs = cpu * 1e6 / blocks;
+	*childCpuUs = (childCpu() - childStart) * 1e6 / blocks;
+}
+
+
+
+static void benchSandbox(const char* plugin, double seconds)
+{
+	bool instrument = isInstrument(plugin);
+
+	printf("Sandbox, plugin \"%s\", 2 channels float, us per block\n\n", plugin);
+	printf("block  in-process  sandboxed  added  host CPU  child CPU  dropouts\n");
+
+	for( size_t b = 0; b < ARRAY_SIZE(s_blockSizes); b++ )
+	{
+		double inWall, inCpu, sbWall, sbCpu, sbChildCpu, unused;
+		long sbDropouts, unusedDropouts;
+		measureBlocks(0, s_blockSizes[b], plugin, instrument, seconds, &inWall, &inCpu, &unused, &unusedDropouts);
+		measureBlocks(BASS_VST_SANDBOX, s_blockSizes[b], plugin, instrument, seconds, &sbWall, &sbCpu, &sbChildCpu, &sbDropouts);
+		printf("%5u  %10.2f  %9.2f  %5.2f  %8.2f  %9.2f  %8ld\n", (unsigned)s_blockSizes[b],
+			inWall, sbWall, sbWall - inWall, sbCpu, sbChildCpu, sbDropouts);
+	}
+	printf("\n");
+}
+
+
+
+/*****************************************************************************
+ *  main
+ *****************************************************************************/
+
+
+
+int main(int argc, char** argv)
+{
+	const char*	plugin = "gain";
+	double		seconds = 0.05;
+	bool		dsp = false, api = false, sandbox = false;
+
+	for( int a = 1; a < argc; a++ )
+	{
+		if( strcmp(argv[a], "-plugin") == 0 && a + 1 < argc )
+			plugin = argv[++a];
+		else if( strcmp(argv[a], "-seconds") == 0 && a + 1 < argc )
+			seconds = atof(argv[++a]);
+		else if( strcmp(argv[a], "-dsp") == 0 )
+			dsp = true;
+		else if( strcmp(argv[a], "-api") == 0 )
+			api = true;
+		else if( strcmp(argv[a], "-sandbox") == 0 )
+			sandbox = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [-plugin <name>|<file>] [-seconds <s>] [-dsp] [-api] [-sandbox]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if( !dsp && !api && !sandbox )
+		dsp = api = sandbox = true;
+
+	benchInit();
+	if( dsp )
+		benchDsp(plugin, seconds);
+	if( api )
+		benchApi(seconds);
+	if( sandbox )
+		benchSandbox(plugin, seconds);
+	BASS_Free();
+	return 0;
+}
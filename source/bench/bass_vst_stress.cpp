@@ -0,0 +1,331 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bass_vst_stress.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Stress test of the API calls against running channels
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: M decode channels, each with the "heavyparam" and the "midisink"
+ *	stub and registered for the delay compensation, are rendered by one
+ *	thread per channel while N control threads call BASS_VST_SetParam(),
+ *	BASS_VST_GetParam(), BASS_VST_ProcessEvent(), BASS_VST_SetBypass() and
+ *	BASS_VST_SetOption() on random plugins as fast as they can.  Reported are the calls per second, the latency
+ *	distribution of every function and the worst time of a block, which
+ *	shows how long the audio threads wait for the locks.
+ *
+ *	Build with -DBASS_VST_SANITIZE=thread to have ThreadSanitizer check the
+ *	locking at the same time; the numbers are meaningless then.
+ *
+ *	Usage: bass_vst_stress [-threads <n>] [-channels <m>] [-seconds <s>]
+ *	                       [-block <samples>]
+ *	Defaults: 4 control threads, 4 channels, 2 seconds, 512 samples.
+ *
+ *****************************************************************************/
+
+
+
+#include <pthread.h>
+#include "bench_common.h"
+#include "bassmidi.h"
+
+#define STRESS_MAX_THREADS		64
+#define STRESS_MAX_CHANNELS		64
+
+// the latencies are collected in histograms with 16 buckets per power of 2,
+// so nothing is allocated while measuring and the percentiles are exact to 6%
+#define HIST_BUCKETS			976
+
+enum
+{
+	API_SETPARAM = 0,
+	API_GETPARAM,
+	API_PROCESSEVENT,
+	API_SETBYPASS,
+	API_SETOPTION,
+	API_COUNT
+};
+
+static const char* s_apiNames[API_COUNT] =
+{
+	"BASS_VST_SetParam()",
+	"BASS_VST_GetParam()",
+	"BASS_VST_ProcessEvent()",
+	"BASS_VST_SetBypass()",
+	"BASS_VST_SetOption()"
+};
+
+typedef struct
+{
+	unsigned long long	counts[HIST_BUCKETS];
+	unsigned long long	total;
+	unsigned long long	maxNs;
+} HIST;
+
+typedef struct
+{
+	HSTREAM			stream;
+	BENCH_SOURCE	src;
+	DWORD			params;		// the "heavyparam" stub
+	DWORD			sink;		// the "midisink" stub
+	HIST			blocks;
+} STRESS_CHANNEL;
+
+typedef struct
+{
+	int				index;
+	HIST			apis[API_COUNT];
+} STRESS_THREAD;
+
+static STRESS_CHANNEL	s_channels[STRESS_MAX_CHANNELS];
+static int				s_numChannels = 4;
+static DWORD			s_blockSize = 512;
+static long				s_stop;
+
+
+
+/*****************************************************************************
+ *  the histograms
+ *****************************************************************************/
+
+
+
+static int histBucket(unsigned long long ns)
+{
+	if( ns < 16 )
+		return (int)ns;
+	int e = 63 - __builtin_clzll(ns);
+	return (e - 3) * 16 + (int)((ns >> (e - 4)) & 15);
+}
+
+
+
+static unsigned long long histBucketStart(int bucket)
+{
+	if( bucket < 16 )
+		return bucket;
+	int e = bucket / 16 + 3;
+	return (unsigned long long)(16 + bucket % 16) << (e - 4);
+}
+
+
+
+static void histAdd(HIST* hist, double seconds)
+{
+	unsigned long long ns = (unsigned long long)(seconds * 1e9);
+	hist->counts[histBucket(ns)]++;
+	hist->total++;
+	if( ns > hist->maxNs )
+		hist->maxNs = ns;
+}
+
+
+
+static void histMerge(HIST* dest, const HIST* src)
+{
+	for( int b = 0; b < HIST_BUCKETS; b++ )
+		dest->counts[b] += src->counts[b];
+	dest->total += src->total;
+	if( src->maxNs > dest->maxNs )
+		dest->maxNs = src->maxNs;
+}
+
+
+
+static double histPercentile(const HIST* hist, double percent)
+{
+	// returns microseconds
+	unsigned long long want = (unsigned long long)(hist->total * percent / 100.0), seen = 0;
+	for( int b = 0; b < HIST_BUCKETS; b++ )
+	{
+		seen += hist->counts[b];
+		if( seen > want )
+			return histBucketStart(b) / 1000.0;
+	}
+	return hist->maxNs / 1000.0;
+}
+
+
+
+/*****************************************************************************
+ *  the threads
+ *****************************************************************************/
+
+
+
+static void* renderThread(void* param)
+{
+	STRESS_CHANNEL* ch = (STRESS_CHANNEL*)param;
+	float* buffer = (float*)malloc(s_blockSize * 2 * sizeof(float));
+
+	while( !__sync_fetch_and_add(&s_stop, 0) )
+	{
+		double start = benchNow();
+		BASS_ChannelGetData(ch->stream, buffer, s_blockSize * 2 * sizeof(float));
+		histAdd(&ch->blocks, benchNow() - start);
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+
+
+static void* controlThread(void* param)
+{
+	STRESS_THREAD* thread = (STRESS_THREAD*)param;
+	unsigned int seed = 0x9E3779B9u * (thread->index + 1);
+
+	while( !__sync_fetch_and_add(&s_stop, 0) )
+	{
+		seed = seed * 1103515245 + 12345;
+		STRESS_CHANNEL* ch = &s_channels[(seed >> 8) % s_numChannels];
+		int api = (seed >> 16) % API_COUNT;
+		int value = (seed >> 20) & 0x3FF;
+		double start = benchNow();
+		switch( api )
+		{
+			case API_SETPARAM:
+				BASS_VST_SetParam(ch->params, value, (value & 1)? 0.25F : 0.75F);
+				break;
+
+			case API_GETPARAM:
+				BASS_VST_GetParam(ch->params, value);
+				break;
+
+			case API_PROCESSEVENT:
+				BASS_VST_ProcessEvent(ch->sink, value & 15, MIDI_EVENT_NOTE, MAKEWORD(36 + (value & 63), (value & 64)? 0 : 100));
+				break;
+
+			case API_SETBYPASS:
+				// bypass either plugin for a moment, most of the time both are running
+				BASS_VST_SetBypass((value & 1)? ch->params : ch->sink, (value & 6) == 0);
+				break;
+
+			case API_SETOPTION:
+				switch( value & 3 )
+				{
+					case 0: BASS_VST_SetOption(ch->params, BASS_VST_OPTION_FIXEDBLOCK, (value & 4)? 256 : 0); break;
+					case 1: BASS_VST_SetOption(ch->sink, BASS_VST_OPTION_SLEEP, (value & 4)? 1 : 0); break;
+					case 2: BASS_VST_SetOption(ch->params, BASS_VST_OPTION_NANGUARD, (value & 4)? 1 : 0); break;
+					case 3: BASS_VST_SetOption(ch->params, BASS_VST_OPTION_WATCHDOG_BUDGET, (value & 4)? 400 : 0); break;
+				}
+				break;
+		}
+		histAdd(&thread->apis[api], benchNow() - start);
+	}
+
+	return NULL;
+}
+
+
+
+/*****************************************************************************
+ *  main
+ *****************************************************************************/
+
+
+
+static void printHist(const char* name, const HIST* hist, double seconds)
+{
+	printf("%-30s %11.0f %9.2f %9.2f %9.2f %10.2f\n", name, hist->total / seconds,
+		histPercentile(hist, 50.0), histPercentile(hist, 99.0), histPercentile(hist, 99.9),
+		hist->maxNs / 1000.0);
+}
+
+
+
+int main(int argc, char** argv)
+{
+	static STRESS_THREAD	threads[STRESS_MAX_THREADS];
+	pthread_t				controlIds[STRESS_MAX_THREADS], renderIds[STRESS_MAX_CHANNELS];
+	int						numThreads = 4, i;
+	double					seconds = 2.0;
+
+	for( int a = 1; a < argc; a++ )
+	{
+		if( strcmp(argv[a], "-threads") == 0 && a + 1 < argc )
+			numThreads = atoi(argv[++a]);
+		else if( strcmp(argv[a], "-channels") == 0 && a + 1 < argc )
+			s_numChannels = atoi(argv[++a]);
+		else if( strcmp(argv[a], "-seconds") == 0 && a + 1 < argc )
+			seconds = atof(argv[++a]);
+		else if( strcmp(argv[a], "-block") == 0 && a + 1 < argc )
+			s_blockSize = (DWORD)atoi(argv[++a]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-threads <n>] [-channels <m>] [-seconds <s>] [-block <samples>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if( numThreads < 1 || numThreads > STRESS_MAX_THREADS
+	 || s_numChannels < 1 || s_numChannels > STRESS_MAX_CHANNELS
+	 || s_blockSize < 1 )
+	{
+		fprintf(stderr, "1..%d threads, 1..%d channels and a block size > 0, please\n", STRESS_MAX_THREADS, STRESS_MAX_CHANNELS);
+		return 1;
+	}
+
+	benchInit();
+	for( i = 0; i < s_numChannels; i++ )
+	{
+		STRESS_CHANNEL* ch = &s_channels[i];
+		ch->stream = benchCreateSource(2, true, &ch->src);
+		ch->params = benchAddPlugin(ch->stream, "heavyparam", 0);
+		ch->sink = benchAddPlugin(ch->stream, "midisink", 0);
+		BASS_VST_SetCompensation(ch->stream, TRUE);
+		pthread_create(&renderIds[i], NULL, renderThread, ch);
+	}
+	for( i = 0; i < numThreads; i++ )
+	{
+		threads[i].index = i;
+		pthread_create(&controlIds[i], NULL, controlThread, &threads[i]);
+	}
+
+	struct timespec ts;
+	ts.tv_sec = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+
+	__sync_lock_test_and_set(&s_stop, 1);
+	for( i = 0; i < numThreads; i++ )
+		pthread_join(controlIds[i], NULL);
+	for( i = 0; i < s_numChannels; i++ )
+		pthread_join(renderIds[i], NULL);
+
+	printf("%d control threads, %d channels, %u samples per block, %.1f seconds\n\n",
+		numThreads, s_numChannels, (unsigned)s_blockSize, seconds);
+	printf("%-30s %11s %9s %9s %9s %10s\n", "", "calls/s", "p50 us", "p99 us", "p99.9 us", "max us");
+
+	HIST* all = (HIST*)calloc(1, sizeof(HIST));
+	for( int api = 0; api < API_COUNT; api++ )
+	{
+		HIST* hist = (HIST*)calloc(1, sizeof(HIST));
+		for( i = 0; i < numThreads; i++ )
+			histMerge(hist, &threads[i].apis[api]);
+		printHist(s_apiNames[api], hist, seconds);
+		histMerge(all, hist);
+		free(hist);
+	}
+	printHist("all", all, seconds);
+
+	memset(all, 0, sizeof(HIST));
+	for( i = 0; i < s_numChannels; i++ )
+		histMerge(all, &s_channels[i].blocks);
+	printf("\n");
+	printHist("blocks (BASS_ChannelGetData)", all, seconds);
+	printf("\nworst block: %.2f us, the block duration is %.2f us\n",
+		all->maxNs / 1000.0, s_blockSize * 1e6 / 44100.0);
+	free(all);
+
+	for( i = 0; i < s_numChannels; i++ )
+		BASS_StreamFree(s_channels[i].stream);
+	BASS_Free();
+	return 0;
+}
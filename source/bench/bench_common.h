@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       bench_common.h
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Helpers shared by the benchmarks
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: the benchmarks run on BASS' "no sound" device and pull the data
+ *	of decode channels themselves by BASS_ChannelGetData(), so nothing but
+ *	the processing is measured.  The channels are fed with noise by
+ *	benchSourceProc().
+ *
+ *****************************************************************************/
+
+
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bass.h"
+#include "bass_vst.h"
+
+#ifndef BASS_VST_BENCH_PLUGIN_DIR
+#define BASS_VST_BENCH_PLUGIN_DIR		"."
+#endif
+#ifndef BASS_VST_BENCH_PLUGIN_SUFFIX
+#define BASS_VST_BENCH_PLUGIN_SUFFIX	".so"
+#endif
+
+#define BENCH_NOISE_SAMPLES				65536	// a power of 2
+
+
+
+static inline double benchNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+static inline double benchThreadCpu()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+static inline const char* benchPluginPath(const char* nameOrFile, char* buf, size_t bufSize)
+{
+	// "gain" is the stub plugin bass_vst_stub_gain next to the benchmark, anything
+	// containing a slash is used as given
+	if( strchr(nameOrFile, '/') )
+		return nameOrFile;
+	snprintf(buf, bufSize, "%s/bass_vst_stub_%s%s", BASS_VST_BENCH_PLUGIN_DIR, nameOrFile, BASS_VST_BENCH_PLUGIN_SUFFIX);
+	return buf;
+}
+
+
+
+static inline void benchInit()
+{
+	if( !BASS_Init(0/*no sound*/, 44100, 0, NULL, NULL) )
+	{
+		fprintf(stderr, "BASS_Init() failed, error %d\n", BASS_ErrorGetCode());
+		exit(1);
+	}
+}
+
+
+
+typedef struct
+{
+	bool	isFloat;
+	DWORD	pos;		// in samples, wraps around
+} BENCH_SOURCE;
+
+
+
+static float s_benchNoise[BENCH_NOISE_SAMPLES];
+
+
+
+static DWORD CALLBACK benchSourceProc(HSTREAM /*handle*/, void* buffer, DWORD length, void* user)
+{
+	// noise at -12 dB; the table is filled on first use by benchCreateSource()
+	BENCH_SOURCE* src = (BENCH_SOURCE*)user;
+	DWORD i, n = length / (src->isFloat? sizeof(float) : sizeof(short));
+	for( i = 0; i < n; i++, src->pos++ )
+	{
+		float value = s_benchNoise[src->pos & (BENCH_NOISE_SAMPLES-1)];
+		if( src->isFloat )
+			((float*)buffer)[i] = value;
+		else
+			((short*)buffer)[i] = (short)(value * 32767.0F);
+	}
+	return length;
+}
+
+
+
+static inline HSTREAM benchCreateSource(DWORD chans, bool isFloat, BENCH_SOURCE* src)
+{
+	if( s_benchNoise[0] == 0.0F )
+	{
+		unsigned int seed = 1;
+		for( int i = 0; i < BENCH_NOISE_SAMPLES; i++ )
+		{
+			seed = seed * 1103515245 + 12345;
+			s_benchNoise[i] = ((seed >> 8) & 0xFFFF) / 65536.0F * 0.5F - 0.25F;
+		}
+		s_benchNoise[0] = 0.125F;
+	}
+
+	src->isFloat = isFloat;
+	src->pos = 0;
+	HSTREAM stream = BASS_StreamCreate(44100, chans, BASS_STREAM_DECODE | (isFloat? BASS_SAMPLE_FLOAT : 0), benchSourceProc, src);
+	if( stream == 0 )
+	{
+		fprintf(stderr, "BASS_StreamCreate() failed, error %d\n", BASS_ErrorGetCode());
+		exit(1);
+	}
+	return stream;
+}
+
+
+
+static inline DWORD benchAddPlugin(DWORD channel, const char* plugin, DWORD flags)
+{
+	char buf[1024];
+	DWORD vstHandle = BASS_VST_ChannelSetDSP(channel, benchPluginPath(plugin, buf, sizeof(buf)), flags, 0);
+	if( vstHandle == 0 )
+	{
+		fprintf(stderr, "cannot load %s, error %d\n", benchPluginPath(plugin, buf, sizeof(buf)), BASS_ErrorGetCode());
+		exit(1);
+	}
+	return vstHandle;
+}
+
+
+
+#endif // BENCH_COMMON_H
@@ -0,0 +1,385 @@
+/*****************************************************************************
+ *  BASS_VST
+ *****************************************************************************
+ *
+ *  File:       stub_plugin.cpp
+ *  Authors:    BASS_VST contributors
+ *  Purpose:    Minimal VST 2.4 plugins for the benchmarks
+ *
+ *	Version History:
+ *	18.10.2026	Created
+ *
+ *****************************************************************************
+ *
+ *	Hint: this file is compiled once per plugin with STUB_KIND set to one of
+ *	the STUB_* kinds below, see CMakeLists.txt.  The plugins do as little as
+ *	possible so that the benchmarks measure BASS_VST and not the plugins;
+ *	only the SDK's aeffectx.h is needed, not the C++ classes of the SDK.
+ *
+ *	STUB_GAIN			stereo gain, one parameter, float and double
+ *	STUB_PASSTHROUGH	stereo copy, no parameters
+ *	STUB_HEAVYPARAM		stereo gain, 1024 parameters and chunks
+ *	STUB_MIDISINK		stereo copy, accepts and counts MIDI events
+ *	STUB_DOUBLEONLY		stereo copy with processDoubleReplacing() only
+ *	STUB_MONOIN			one input copied to two outputs
+ *	STUB_INSTRUMENT		sine instrument with a short release, no inputs
+ *
+ *****************************************************************************/
+
+
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vstsdk24/aeffectx.h"
+
+#ifdef _WIN32
+#define STUB_EXPORT				extern "C" __declspec(dllexport)
+#else
+#define STUB_EXPORT				extern "C" __attribute__((visibility("default")))
+#endif
+
+#define STUB_GAIN				1
+#define STUB_PASSTHROUGH		2
+#define STUB_HEAVYPARAM			3
+#define STUB_MIDISINK			4
+#define STUB_DOUBLEONLY			5
+#define STUB_MONOIN				6
+#define STUB_INSTRUMENT			7
+
+#ifndef STUB_KIND
+#error "STUB_KIND must be defined, see CMakeLists.txt"
+#endif
+
+#if STUB_KIND == STUB_GAIN
+#define STUB_NAME				"Stub Gain"
+#define STUB_NUM_PARAMS			1
+#elif STUB_KIND == STUB_HEAVYPARAM
+#define STUB_NAME				"Stub Heavy Param"
+#define STUB_NUM_PARAMS			1024
+#elif STUB_KIND == STUB_PASSTHROUGH
+#define STUB_NAME				"Stub Passthrough"
+#elif STUB_KIND == STUB_MIDISINK
+#define STUB_NAME				"Stub MIDI Sink"
+#elif STUB_KIND == STUB_DOUBLEONLY
+#define STUB_NAME				"Stub Double Replacing"
+#elif STUB_KIND == STUB_MONOIN
+#define STUB_NAME				"Stub Mono In"
+#elif STUB_KIND == STUB_INSTRUMENT
+#define STUB_NAME				"Stub Instrument"
+#endif
+
+#ifndef STUB_NUM_PARAMS
+#define STUB_NUM_PARAMS			0
+#endif
+
+#define STUB_PI					3.14159265358979323846
+#define STUB_NUM_VOICES			16
+#define STUB_RELEASE_MS			100
+
+
+
+typedef struct
+{
+	int				key;		// -1 = voice not used
+	double			phase;
+	double			phaseInc;
+	float			amp;
+	float			release;	// decrement of amp per sample after the note is released, 0 while the key is down
+} STUB_VOICE;
+
+
+
+typedef struct
+{
+	AEffect				aeffect;	// must be the first member, the stub is casted from AEffect*
+	audioMasterCallback	host;
+	float				sampleRate;
+	float				params[STUB_NUM_PARAMS > 0? STUB_NUM_PARAMS : 1];
+	long				numEvents;
+	STUB_VOICE			voices[STUB_NUM_VOICES];
+} STUB;
+
+
+
+/*****************************************************************************
+ *  MIDI
+ *****************************************************************************/
+
+
+
+static void stubNoteOn(STUB* stub, int key, int velocity)
+{
+	int v, use = 0;
+	for( v = 0; v < STUB_NUM_VOICES; v++ )
+	{
+		if( stub->voices[v].key < 0 )
+		{
+			use = v;
+			break;
+		}
+		if( stub->voices[v].amp < stub->voices[use].amp )
+			use = v; // all voices in use, steal the quietest one
+	}
+
+	STUB_VOICE* voice = &stub->voices[use];
+	voice->key = key;
+	voice->phase = 0.0;
+	voice->phaseInc = 2.0 * STUB_PI * 440.0 * pow(2.0, (key - 69) / 12.0) / stub->sampleRate;
+	voice->amp = velocity / 127.0F * 0.25F;
+	voice->release = 0.0F;
+}
+
+
+
+static void stubNoteOff(STUB* stub, int key)
+{
+	for( int v = 0; v < STUB_NUM_VOICES; v++ )
+	{
+		STUB_VOICE* voice = &stub->voices[v];
+		if( voice->key == key && voice->release == 0.0F )
+			voice->release = voice->amp / (stub->sampleRate * STUB_RELEASE_MS / 1000.0F) + 1e-9F;
+	}
+}
+
+
+
+static void stubProcessEvents(STUB* stub, const VstEvents* events)
+{
+	for( VstInt32 i = 0; i < events->numEvents; i++ )
+	{
+		stub->numEvents++;
+		if( STUB_KIND != STUB_INSTRUMENT || events->events[i]->type != kVstMidiType )
+			continue;
+
+		// the events are applied at the start of the next block, this is enough for benchmarking
+		const unsigned char* midiData = (const unsigned char*)((const VstMidiEvent*)events->events[i])->midiData;
+		int status = midiData[0] & 0xF0;
+		if( status == 0x90 && midiData[2] != 0 )
+			stubNoteOn(stub, midiData[1] & 0x7F, midiData[2] & 0x7F);
+		else if( status == 0x80 || status == 0x90 )
+			stubNoteOff(stub, midiData[1] & 0x7F);
+		else if( status == 0xB0 && (midiData[1] == 120 || midiData[1] == 123) )
+		{
+			for( int v = 0; v < STUB_NUM_VOICES; v++ )
+				stubNoteOff(stub, stub->voices[v].key);
+		}
+	}
+}
+
+
+
+/*****************************************************************************
+ *  processing
+ *****************************************************************************/
+
+
+
+template<class T> static void stubProcess(STUB* stub, T** inputs, T** outputs, VstInt32 numSamples)
+{
+	VstInt32 i;
+	switch( STUB_KIND )
+	{
+		case STUB_GAIN:
+		case STUB_HEAVYPARAM:
+		{
+			T gain = (T)(stub->params[0] * 2.0F); // 0.5 is unity gain
+			for( int c = 0; c < 2; c++ )
+			{
+				for( i = 0; i < numSamples; i++ )
+					outputs[c][i] = inputs[c][i] * gain;
+			}
+			break;
+		}
+
+		case STUB_MONOIN:
+			memcpy(outputs[0], inputs[0], numSamples*sizeof(T));
+			memcpy(outputs[1], inputs[0], numSamples*sizeof(T));
+			break;
+
+		case STUB_INSTRUMENT:
+			memset(outputs[0], 0, numSamples*sizeof(T));
+			for( int v = 0; v < STUB_NUM_VOICES; v++ )
+			{
+				STUB_VOICE* voice = &stub->voices[v];
+				for( i = 0; i < numSamples && voice->key >= 0; i++ )
+				{
+					outputs[0][i] += (T)(sin(voice->phase) * voice->amp);
+					voice->phase += voice->phaseInc;
+					voice->amp -= voice->release;
+					if( voice->amp <= 0.0F )
+						voice->key = -1;
+				}
+				voice->phase = fmod(voice->phase, 2.0 * STUB_PI);
+			}
+			memcpy(outputs[1], outputs[0], numSamples*sizeof(T));
+			break;
+
+		default:
+			memcpy(outputs[0], inputs[0], numSamples*sizeof(T));
+			memcpy(outputs[1], inputs[1], numSamples*sizeof(T));
+			break;
+	}
+}
+
+
+
+static void stubProcessReplacing(AEffect* aeffect, float** inputs, float** outputs, VstInt32 numSamples)
+{
+	stubProcess((STUB*)aeffect, inputs, outputs, numSamples);
+}
+
+
+
+static void stubProcessDoubleReplacing(AEffect* aeffect, double** inputs, double** outputs, VstInt32 numSamples)
+{
+	stubProcess((STUB*)aeffect, inputs, outputs, numSamples);
+}
+
+
+
+/*****************************************************************************
+ *  parameters and the dispatcher
+ *****************************************************************************/
+
+
+
+static void stubSetParameter(AEffect* aeffect, VstInt32 index, float value)
+{
+	if( index >= 0 && index < STUB_NUM_PARAMS )
+		((STUB*)aeffect)->params[index] = value;
+}
+
+
+
+static float stubGetParameter(AEffect* aeffect, VstInt32 index)
+{
+	return (index >= 0 && index < STUB_NUM_PARAMS)? ((STUB*)aeffect)->params[index] : 0.0F;
+}
+
+
+
+static VstIntPtr stubDispatcher(AEffect* aeffect, VstInt32 opcode, VstInt32 index, VstIntPtr value, void* ptr, float opt)
+{
+	STUB* stub = (STUB*)aeffect;
+	switch( opcode )
+	{
+		case effClose:
+			free(stub);
+			return 1;
+
+		case effSetSampleRate:
+			stub->sampleRate = opt;
+			return 1;
+
+		case effGetParamName:
+			snprintf((char*)ptr, kVstMaxParamStrLen, index == 0? "Gain" : "P%d", (int)index);
+			return 1;
+
+		case effGetParamDisplay:
+			snprintf((char*)ptr, kVstMaxParamStrLen, "%.3f", stubGetParameter(aeffect, index));
+			return 1;
+
+		case effGetParamLabel:
+			((char*)ptr)[0] = 0;
+			return 1;
+
+		case effGetChunk:
+			*(void**)ptr = stub->params;
+			return (STUB_KIND == STUB_HEAVYPARAM)? sizeof(stub->params) : 0;
+
+		case effSetChunk:
+			if( value == sizeof(stub->params) )
+				memcpy(stub->params, ptr, sizeof(stub->params));
+			return 1;
+
+		case effProcessEvents:
+			stubProcessEvents(stub, (const VstEvents*)ptr);
+			return 1;
+
+		case effGetEffectName:
+		case effGetProductString:
+			strncpy((char*)ptr, STUB_NAME, kVstMaxEffectNameLen);
+			return 1;
+
+		case effGetVendorString:
+			strncpy((char*)ptr, "BASS_VST", kVstMaxVendorStrLen);
+			return 1;
+
+		case effGetPlugCategory:
+			return (STUB_KIND == STUB_INSTRUMENT)? kPlugCategSynth : kPlugCategEffect;
+
+		case effCanDo:
+			if( (STUB_KIND == STUB_MIDISINK || STUB_KIND == STUB_INSTRUMENT)
+			 && (strcmp((const char*)ptr, "receiveVstEvents") == 0 || strcmp((const char*)ptr, "receiveVstMidiEvent") == 0) )
+				return 1;
+			return -1;
+
+		case effGetTailSize:
+			return (STUB_KIND == STUB_INSTRUMENT)? (VstIntPtr)(stub->sampleRate * STUB_RELEASE_MS / 1000) : 1/*no tail*/;
+
+		case effGetVstVersion:
+			return kVstVersion;
+
+		case effGetVendorVersion:
+			return 1;
+	}
+	return 0;
+}
+
+
+
+/*****************************************************************************
+ *  the entry point
+ *****************************************************************************/
+
+
+
+STUB_EXPORT AEffect* VSTPluginMain(audioMasterCallback host)
+{
+	if( host == NULL || host(NULL, audioMasterVersion, 0, 0, NULL, 0.0F) == 0 )
+		return NULL;
+
+	STUB* stub = (STUB*)calloc(1, sizeof(STUB));
+	if( stub == NULL )
+		return NULL;
+
+	AEffect* aeffect = &stub->aeffect;
+	aeffect->magic					= kEffectMagic;
+	aeffect->dispatcher				= stubDispatcher;
+	aeffect->setParameter			= stubSetParameter;
+	aeffect->getParameter			= stubGetParameter;
+	aeffect->processReplacing		= stubProcessReplacing;
+	aeffect->processDoubleReplacing	= stubProcessDoubleReplacing;
+	aeffect->numPrograms			= 1;
+	aeffect->numParams				= STUB_NUM_PARAMS;
+	aeffect->numInputs				= (STUB_KIND == STUB_INSTRUMENT)? 0 : ((STUB_KIND == STUB_MONOIN)? 1 : 2);
+	aeffect->numOutputs				= 2;
+	aeffect->flags					= effFlagsCanReplacing | effFlagsCanDoubleReplacing;
+	aeffect->uniqueID				= ('B'<<24) | ('v'<<16) | ('s'<<8) | ('0'+STUB_KIND);
+	aeffect->version				= 1;
+	aeffect->object					= stub;
+
+	if( STUB_KIND == STUB_DOUBLEONLY )
+	{
+		aeffect->processReplacing = NULL;
+		aeffect->flags = effFlagsCanDoubleReplacing;
+	}
+	else if( STUB_KIND == STUB_INSTRUMENT )
+	{
+		aeffect->flags |= effFlagsIsSynth;
+	}
+
+	if( STUB_KIND == STUB_HEAVYPARAM )
+		aeffect->flags |= effFlagsProgramChunks;
+
+	stub->host = host;
+	stub->sampleRate = 44100.0F;
+	for( int p = 0; p < STUB_NUM_PARAMS; p++ )
+		stub->params[p] = 0.5F;
+	for( int v = 0; v < STUB_NUM_VOICES; v++ )
+		stub->voices[v].key = -1;
+
+	return aeffect;
+}